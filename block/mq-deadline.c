@@ -37,6 +37,15 @@ static const int prio_aging_expire = 10 * HZ;
 static const int writes_starved = 2;    /* max times reads can starve a write */
 static const int fifo_batch = 16;       /* # of sequential requests treated as one
 				     by the above parameters. For throughput. */
+/*
+ * Latency target mode: the share of RT/BE reads that completed later than
+ * lat_target_us is measured over windows of DD_LAT_WINDOW_NS. A window with
+ * more than 1% misses raises the throttling level, a window without misses
+ * lowers it again.
+ */
+#define DD_LAT_WINDOW_NS	(100 * NSEC_PER_MSEC)
+#define DD_LAT_MIN_SAMPLES	32
+#define DD_LAT_MAX_LEVEL	4
 
 enum dd_data_dir {
 	DD_READ		= READ,
@@ -100,6 +109,15 @@ struct deadline_data {
 	int front_merges;
 	u32 async_depth;
 	int prio_aging_expire;
+	int lat_target_us;
+
+	/* latency target mode state, see dd_lat_update() */
+	int lat_level;
+	atomic_t lat_samples;
+	atomic_t lat_missed;
+	atomic64_t lat_window_start;
+	/* dispatched BE and IDLE writes that have not completed yet */
+	atomic_t writes_inflight;
 
 	spinlock_t lock;
 	spinlock_t zone_lock;
@@ -128,6 +146,89 @@ static u8 dd_rq_ioclass(struct request *rq)
 	return IOPRIO_PRIO_CLASS(req_get_ioprio(rq));
 }
 
+/*
+ * Returns the expiry time in jiffies of requests with priority @prio. In
+ * latency target mode, RT and BE reads expire no later than the target,
+ * and earlier the more the target is being missed.
+ */
+static int dd_fifo_expire(struct deadline_data *dd, enum dd_prio prio,
+			  enum dd_data_dir data_dir)
+{
+	int target = READ_ONCE(dd->lat_target_us);
+	int expire = dd->fifo_expire[data_dir];
+
+	if (!target || data_dir != DD_READ || prio == DD_IDLE_PRIO)
+		return expire;
+
+	return min_t(unsigned long, expire,
+		     max(1UL, usecs_to_jiffies(target) >>
+			      READ_ONCE(dd->lat_level)));
+}
+
+/* Number of times reads may starve writes at the current throttling level. */
+static int dd_writes_starved(struct deadline_data *dd)
+{
+	int level = READ_ONCE(dd->lat_level);
+
+	if (!READ_ONCE(dd->lat_target_us) || !level || dd->writes_starved < 0)
+		return dd->writes_starved;
+
+	return max(dd->writes_starved, 1) << level;
+}
+
+/*
+ * Returns true if no more writes of priority @prio may be dispatched until
+ * some of those in flight complete. IDLE writes are throttled first, BE
+ * writes from the next level on and RT writes never.
+ */
+static bool dd_write_throttled(struct deadline_data *dd, enum dd_prio prio)
+{
+	int level = READ_ONCE(dd->lat_level);
+
+	if (!READ_ONCE(dd->lat_target_us) || prio == DD_RT_PRIO)
+		return false;
+	if (level < (prio == DD_IDLE_PRIO ? 1 : 2))
+		return false;
+
+	return atomic_read(&dd->writes_inflight) >=
+		max(1U, dd->async_depth >> level);
+}
+
+/*
+ * Called for every completed request in latency target mode. Accounts the
+ * latency of RT and BE reads and adjusts the throttling level at the end of
+ * each window. May be called concurrently and from interrupt context, so
+ * only the caller that wins the window rollover updates the level.
+ */
+static void dd_lat_update(struct deadline_data *dd, struct request *rq,
+			  enum dd_prio prio, int target)
+{
+	u64 now = ktime_get_ns();
+	u64 start = atomic64_read(&dd->lat_window_start);
+	unsigned int samples, missed;
+	int level;
+
+	if (prio != DD_IDLE_PRIO && req_op(rq) == REQ_OP_READ &&
+	    rq->start_time_ns) {
+		atomic_inc(&dd->lat_samples);
+		if (now - rq->start_time_ns > (u64)target * NSEC_PER_USEC)
+			atomic_inc(&dd->lat_missed);
+	}
+
+	if (now - start < DD_LAT_WINDOW_NS ||
+	    atomic64_cmpxchg(&dd->lat_window_start, start, now) != start)
+		return;
+
+	samples = atomic_xchg(&dd->lat_samples, 0);
+	missed = atomic_xchg(&dd->lat_missed, 0);
+	level = READ_ONCE(dd->lat_level);
+	if (samples >= DD_LAT_MIN_SAMPLES && missed * 100 > samples)
+		level = min(level + 1, DD_LAT_MAX_LEVEL);
+	else if (!missed)
+		level = max(level - 1, 0);
+	WRITE_ONCE(dd->lat_level, level);
+}
+
 /*
  * get the request after `rq' in sector-sorted order
  */
@@ -349,9 +450,10 @@ deadline_next_request(struct deadline_data *dd, struct dd_per_prio *per_prio,
 static bool started_after(struct deadline_data *dd, struct request *rq,
 			  unsigned long latest_start)
 {
+	const enum dd_prio prio = ioprio_class_to_prio[dd_rq_ioclass(rq)];
 	unsigned long start_time = (unsigned long)rq->fifo_time;
 
-	start_time -= dd->fifo_expire[rq_data_dir(rq)];
+	start_time -= dd_fifo_expire(dd, prio, rq_data_dir(rq));
 
 	return time_after(start_time, latest_start);
 }
@@ -368,6 +470,7 @@ static struct request *__dd_dispatch_request(struct deadline_data *dd,
 	enum dd_data_dir data_dir;
 	enum dd_prio prio;
 	u8 ioprio_class;
+	bool writes_throttled;
 
 	lockdep_assert_held(&dd->lock);
 
@@ -380,11 +483,14 @@ static struct request *__dd_dispatch_request(struct deadline_data *dd,
 		goto done;
 	}
 
+	writes_throttled = dd_write_throttled(dd, per_prio - dd->per_prio);
+
 	/*
 	 * batches are currently reads XOR writes
 	 */
 	rq = deadline_next_request(dd, per_prio, dd->last_dir);
-	if (rq && dd->batching < dd->fifo_batch)
+	if (rq && dd->batching < dd->fifo_batch &&
+	    !(dd->last_dir == DD_WRITE && writes_throttled))
 		/* we have a next request are still entitled to batch */
 		goto dispatch_request;
 
@@ -397,7 +503,8 @@ static struct request *__dd_dispatch_request(struct deadline_data *dd,
 		BUG_ON(RB_EMPTY_ROOT(&per_prio->sort_list[DD_READ]));
 
 		if (deadline_fifo_request(dd, per_prio, DD_WRITE) &&
-		    (dd->starved++ >= dd->writes_starved))
+		    !writes_throttled &&
+		    (dd->starved++ >= dd_writes_starved(dd)))
 			goto dispatch_writes;
 
 		data_dir = DD_READ;
@@ -409,7 +516,7 @@ static struct request *__dd_dispatch_request(struct deadline_data *dd,
 	 * there are either no reads or writes have been starved
 	 */
 
-	if (!list_empty(&per_prio->fifo_list[DD_WRITE])) {
+	if (!list_empty(&per_prio->fifo_list[DD_WRITE]) && !writes_throttled) {
 dispatch_writes:
 		BUG_ON(RB_EMPTY_ROOT(&per_prio->sort_list[DD_WRITE]));
 
@@ -465,6 +572,11 @@ static struct request *__dd_dispatch_request(struct deadline_data *dd,
 	ioprio_class = dd_rq_ioclass(rq);
 	prio = ioprio_class_to_prio[ioprio_class];
 	dd->per_prio[prio].stats.dispatched++;
+	if (prio != DD_RT_PRIO && rq_data_dir(rq) == DD_WRITE &&
+	    READ_ONCE(dd->lat_target_us) && !rq->elv.priv[1]) {
+		rq->elv.priv[1] = (void *)(uintptr_t)1;
+		atomic_inc(&dd->writes_inflight);
+	}
 	/*
 	 * If the request needs its target zone locked, do it.
 	 */
@@ -531,6 +643,10 @@ static struct request *dd_dispatch_request(struct blk_mq_hw_ctx *hctx)
 			break;
 	}
 
+	/* Throttled writes are dispatched again once some writes complete. */
+	if (!rq && atomic_read(&dd->writes_inflight))
+		blk_mq_sched_mark_restart_hctx(hctx);
+
 unlock:
 	spin_unlock(&dd->lock);
 
@@ -750,7 +866,7 @@ static void dd_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 		/*
 		 * set expire time and add to fifo list
 		 */
-		rq->fifo_time = jiffies + dd->fifo_expire[data_dir];
+		rq->fifo_time = jiffies + dd_fifo_expire(dd, prio, data_dir);
 		list_add_tail(&rq->queuelist, &per_prio->fifo_list[data_dir]);
 	}
 }
@@ -779,6 +895,7 @@ static void dd_insert_requests(struct blk_mq_hw_ctx *hctx,
 static void dd_prepare_request(struct request *rq)
 {
 	rq->elv.priv[0] = NULL;
+	rq->elv.priv[1] = NULL;
 }
 
 /*
@@ -804,6 +921,7 @@ static void dd_finish_request(struct request *rq)
 	const u8 ioprio_class = dd_rq_ioclass(rq);
 	const enum dd_prio prio = ioprio_class_to_prio[ioprio_class];
 	struct dd_per_prio *per_prio = &dd->per_prio[prio];
+	int target;
 
 	/*
 	 * The block layer core may call dd_finish_request() without having
@@ -815,6 +933,12 @@ static void dd_finish_request(struct request *rq)
 
 	atomic_inc(&per_prio->stats.completed);
 
+	if (rq->elv.priv[1])
+		atomic_dec(&dd->writes_inflight);
+	target = READ_ONCE(dd->lat_target_us);
+	if (target)
+		dd_lat_update(dd, rq, prio, target);
+
 	if (blk_queue_is_zoned(q)) {
 		unsigned long flags;
 
@@ -863,6 +987,7 @@ SHOW_INT(deadline_writes_starved_show, dd->writes_starved);
 SHOW_INT(deadline_front_merges_show, dd->front_merges);
 SHOW_INT(deadline_async_depth_show, dd->async_depth);
 SHOW_INT(deadline_fifo_batch_show, dd->fifo_batch);
+SHOW_INT(deadline_lat_target_us_show, dd->lat_target_us);
 #undef SHOW_INT
 #undef SHOW_JIFFIES
 
@@ -893,6 +1018,7 @@ STORE_INT(deadline_writes_starved_store, &dd->writes_starved, INT_MIN, INT_MAX);
 STORE_INT(deadline_front_merges_store, &dd->front_merges, 0, 1);
 STORE_INT(deadline_async_depth_store, &dd->async_depth, 1, INT_MAX);
 STORE_INT(deadline_fifo_batch_store, &dd->fifo_batch, 0, INT_MAX);
+STORE_INT(deadline_lat_target_us_store, &dd->lat_target_us, 0, INT_MAX);
 #undef STORE_FUNCTION
 #undef STORE_INT
 #undef STORE_JIFFIES
@@ -908,6 +1034,7 @@ static struct elv_fs_entry deadline_attrs[] = {
 	DD_ATTR(async_depth),
 	DD_ATTR(fifo_batch),
 	DD_ATTR(prio_aging_expire),
+	DD_ATTR(lat_target_us),
 	__ATTR_NULL
 };
 
@@ -999,6 +1126,24 @@ static int dd_async_depth_show(void *data, struct seq_file *m)
 	return 0;
 }
 
+static int dd_lat_level_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+	struct deadline_data *dd = q->elevator->elevator_data;
+
+	seq_printf(m, "%d\n", READ_ONCE(dd->lat_level));
+	return 0;
+}
+
+static int dd_writes_inflight_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+	struct deadline_data *dd = q->elevator->elevator_data;
+
+	seq_printf(m, "%d\n", atomic_read(&dd->writes_inflight));
+	return 0;
+}
+
 static int dd_queued_show(void *data, struct seq_file *m)
 {
 	struct request_queue *q = data;
@@ -1109,6 +1254,8 @@ static const struct blk_mq_debugfs_attr deadline_queue_debugfs_attrs[] = {
 	{"batching", 0400, deadline_batching_show},
 	{"starved", 0400, deadline_starved_show},
 	{"async_depth", 0400, dd_async_depth_show},
+	{"lat_level", 0400, dd_lat_level_show},
+	{"writes_inflight", 0400, dd_writes_inflight_show},
 	{"dispatch0", 0400, .seq_ops = &deadline_dispatch0_seq_ops},
 	{"dispatch1", 0400, .seq_ops = &deadline_dispatch1_seq_ops},
 	{"dispatch2", 0400, .seq_ops = &deadline_dispatch2_seq_ops},
@@ -53,6 +53,7 @@
 #include <linux/nsproxy.h>
 #include <linux/poll.h>
 #include <linux/debugfs.h>
+#include <linux/eventfd.h>
 #include <linux/rbtree.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/mm.h>
@@ -120,6 +121,11 @@ module_param_named(debug_mask, binder_debug_mask, uint, 0644);
 char *binder_devices_param = CONFIG_ANDROID_BINDER_DEVICES;
 module_param_named(devices, binder_devices_param, charp, 0444);
 
+/* Minimum size of a BINDER_BUFFER_FLAG_ZERO_COPY buffer to map, 0=never */
+static uint binder_zero_copy_threshold = SZ_64K;
+module_param_named(zero_copy_threshold, binder_zero_copy_threshold,
+		   uint, 0644);
+
 static DECLARE_WAIT_QUEUE_HEAD(binder_user_error_wait);
 static int binder_stop_on_user_error;
 
@@ -506,6 +512,59 @@ static struct binder_work *binder_dequeue_work_head_ilocked(
 	return w;
 }
 
+/**
+ * binder_pool_enqueue_ilocked() - queue a transaction for any proc thread
+ * @proc:         binder_proc to queue the transaction to
+ * @t:            transaction no thread of @proc is available for
+ *
+ * Adds @t to @proc->todo and accounts it as waiting for the thread pool.
+ *
+ * Requires the proc->inner_lock to be held.
+ */
+static void binder_pool_enqueue_ilocked(struct binder_proc *proc,
+					struct binder_transaction *t)
+{
+	struct binder_pool_pressure *pool = &proc->pool;
+
+	binder_enqueue_work_ilocked(&t->work, &proc->todo);
+	t->queued_time = ktime_get();
+	pool->queued++;
+	if (pool->eventfd && pool->queued == pool->depth_threshold)
+		eventfd_signal(pool->eventfd, 1);
+}
+
+/**
+ * binder_pool_dequeue_ilocked() - account a transaction taken from proc->todo
+ * @proc:         binder_proc the transaction was queued to
+ * @t:            transaction a thread picked up
+ *
+ * Requires the proc->inner_lock to be held.
+ */
+static void binder_pool_dequeue_ilocked(struct binder_proc *proc,
+					struct binder_transaction *t)
+{
+	struct binder_pool_pressure *pool = &proc->pool;
+	u64 wait_ns = ktime_to_ns(ktime_sub(ktime_get(), t->queued_time));
+	unsigned int bucket, i;
+
+	pool->queued--;
+	pool->max_wait_ns = max(pool->max_wait_ns, wait_ns);
+	bucket = min_t(unsigned int, fls64(div_u64(wait_ns, NSEC_PER_USEC)),
+		       BINDER_POOL_WAIT_BUCKETS - 1);
+	pool->wait_hist[bucket]++;
+	if (++pool->nr_waits >= BINDER_POOL_WAIT_DECAY) {
+		pool->nr_waits = 0;
+		for (i = 0; i < BINDER_POOL_WAIT_BUCKETS; i++) {
+			pool->wait_hist[i] /= 2;
+			pool->nr_waits += pool->wait_hist[i];
+		}
+	}
+
+	if (pool->eventfd && pool->wait_threshold_ns &&
+	    wait_ns > pool->wait_threshold_ns)
+		eventfd_signal(pool->eventfd, 1);
+}
+
 static void
 binder_defer_work(struct binder_proc *proc, enum binder_deferred_state defer);
 static void binder_free_thread(struct binder_thread *thread);
@@ -2477,6 +2536,7 @@ struct binder_ptr_fixup {
  * @offset		offset in target buffer
  * @sender_uaddr	user address in source buffer
  * @length		bytes to copy
+ * @zero_copy		map whole sender pages instead of copying if possible
  * @node		list node
  *
  * This is used for the sg copy list (sgc) which is created and consumed
@@ -2489,6 +2549,7 @@ struct binder_sg_copy {
 	binder_size_t offset;
 	const void __user *sender_uaddr;
 	size_t length;
+	bool zero_copy;
 	struct list_head node;
 };
 
@@ -2522,6 +2583,20 @@ static int binder_do_deferred_txn_copies(struct binder_alloc *alloc,
 	list_for_each_entry_safe(sgc, tmpsgc, sgc_head, node) {
 		size_t bytes_copied = 0;
 
+		/*
+		 * Sender pages mapped into the target cannot be fixed up,
+		 * so only map buffers that have no fixups in them.
+		 */
+		if (sgc->zero_copy &&
+		    (!pf || pf->offset >= sgc->offset + sgc->length)) {
+			if (!ret)
+				ret = binder_alloc_transfer_user_to_buffer(
+						alloc, buffer, sgc->offset,
+						sgc->sender_uaddr,
+						sgc->length);
+			bytes_copied = sgc->length;
+		}
+
 		while (bytes_copied < sgc->length) {
 			size_t copy_size;
 			size_t bytes_left = sgc->length - bytes_copied;
@@ -2609,6 +2684,7 @@ static void binder_cleanup_deferred_txn_lists(struct list_head *sgc_head,
  * @offset:		binder buffer offset in target process
  * @sender_uaddr:	user address in source process
  * @length:		bytes to copy
+ * @zero_copy:		try to map the sender pages instead of copying
  *
  * Specify a scatter-gather block to be copied. The actual copy must
  * be deferred until all the needed fixups are identified and queued.
@@ -2622,7 +2698,8 @@ static void binder_cleanup_deferred_txn_lists(struct list_head *sgc_head,
  * Return: 0=success, else -errno
  */
 static int binder_defer_copy(struct list_head *sgc_head, binder_size_t offset,
-			     const void __user *sender_uaddr, size_t length)
+			     const void __user *sender_uaddr, size_t length,
+			     bool zero_copy)
 {
 	struct binder_sg_copy *bc = kzalloc(sizeof(*bc), GFP_KERNEL);
 
@@ -2632,6 +2709,7 @@ static int binder_defer_copy(struct list_head *sgc_head, binder_size_t offset,
 	bc->offset = offset;
 	bc->sender_uaddr = sender_uaddr;
 	bc->length = length;
+	bc->zero_copy = zero_copy;
 	INIT_LIST_HEAD(&bc->node);
 
 	/*
@@ -2924,7 +3002,7 @@ static int binder_proc_transaction(struct binder_transaction *t,
 		binder_transaction_priority(thread, t, node);
 		binder_enqueue_thread_work_ilocked(thread, &t->work);
 	} else if (!pending_async) {
-		binder_enqueue_work_ilocked(&t->work, &proc->todo);
+		binder_pool_enqueue_ilocked(proc, t);
 	} else {
 		if ((t->flags & TF_UPDATE_TXN) && proc->is_frozen) {
 			t_outdated = binder_find_outdated_transaction_ilocked(t,
@@ -3293,6 +3371,7 @@ static void binder_transaction(struct binder_proc *proc,
 	t->code = tr->code;
 	t->flags = tr->flags;
 	t->is_nested = is_nested;
+	binder_txn_stats_start(t, in_reply_to, proc, target_node);
 	if (!(t->flags & TF_ONE_WAY) &&
 	    binder_supported_policy(current->policy)) {
 		/* Inherit supported policies for synchronous transactions */
@@ -3613,8 +3692,28 @@ static void binder_transaction(struct binder_proc *proc,
 			struct binder_buffer_object *bp =
 				to_binder_buffer_object(hdr);
 			size_t buf_left = sg_buf_end_offset - sg_buf_offset;
+			bool zero_copy = false;
 			size_t num_valid;
 
+			if ((bp->flags & BINDER_BUFFER_FLAG_ZERO_COPY) &&
+			    binder_zero_copy_threshold &&
+			    bp->length >= binder_zero_copy_threshold) {
+				/*
+				 * Place the buffer at the sender's offset in
+				 * a page so whole pages can be mapped. If
+				 * there is no room for the padding, copy.
+				 */
+				size_t pad = (bp->buffer -
+					      ((uintptr_t)t->buffer->user_data +
+					       sg_buf_offset)) & ~PAGE_MASK;
+
+				if (IS_ALIGNED(pad, sizeof(u64)) &&
+				    pad + bp->length <= buf_left) {
+					sg_buf_offset += pad;
+					buf_left -= pad;
+					zero_copy = true;
+				}
+			}
 			if (bp->length > buf_left) {
 				binder_user_error("%d:%d got transaction with too large buffer\n",
 						  proc->pid, thread->pid);
@@ -3625,7 +3724,7 @@ static void binder_transaction(struct binder_proc *proc,
 			}
 			ret = binder_defer_copy(&sgc_head, sg_buf_offset,
 				(const void __user *)(uintptr_t)bp->buffer,
-				bp->length);
+				bp->length, zero_copy);
 			if (ret) {
 				return_error = BR_FAILED_REPLY;
 				return_error_param = ret;
@@ -3878,8 +3977,9 @@ binder_free_buf(struct binder_proc *proc,
 		if (!w) {
 			buf_node->has_async_transaction = false;
 		} else {
-			binder_enqueue_work_ilocked(
-					w, &proc->todo);
+			binder_pool_enqueue_ilocked(proc,
+				container_of(w, struct binder_transaction,
+					     work));
 			binder_wakeup_proc_ilocked(proc);
 		}
 		binder_node_inner_unlock(buf_node);
@@ -4562,8 +4662,10 @@ static int binder_thread_read(struct binder_proc *proc,
 
 		switch (w->type) {
 		case BINDER_WORK_TRANSACTION: {
-			binder_inner_proc_unlock(proc);
 			t = container_of(w, struct binder_transaction, work);
+			if (list == &proc->todo)
+				binder_pool_dequeue_ilocked(proc, t);
+			binder_inner_proc_unlock(proc);
 		} break;
 		case BINDER_WORK_RETURN_ERROR: {
 			struct binder_error *e = container_of(
@@ -4827,6 +4929,7 @@ static int binder_thread_read(struct binder_proc *proc,
 		ptr += trsize;
 
 		trace_binder_transaction_received(t);
+		binder_txn_stats_received(t, cmd);
 		binder_stat_br(proc, thread, cmd);
 		binder_debug(BINDER_DEBUG_TRANSACTION,
 			     "%d:%d %s %d %d:%d, cmd %d size %zd-%zd ptr %016llx-%016llx\n",
@@ -5015,6 +5118,8 @@ static void binder_free_proc(struct binder_proc *proc)
 		kfree(device);
 	}
 	binder_alloc_deferred_release(&proc->alloc);
+	if (proc->pool.eventfd)
+		eventfd_ctx_put(proc->pool.eventfd);
 	put_task_struct(proc->tsk);
 	put_cred(proc->cred);
 	binder_stats_deleted(BINDER_STAT_PROC);
@@ -5414,6 +5519,70 @@ static int binder_ioctl_get_freezer_info(
 	return 0;
 }
 
+static void binder_ioctl_get_pool_info(struct binder_proc *proc,
+				       struct binder_pool_info *info)
+{
+	struct binder_pool_pressure *pool = &proc->pool;
+	struct binder_thread *thread;
+	struct binder_work *w;
+	u32 sum = 0;
+	int i;
+
+	memset(info, 0, sizeof(*info));
+
+	binder_inner_proc_lock(proc);
+	info->queued = pool->queued;
+	list_for_each_entry(thread, &proc->waiting_threads, waiting_thread_node)
+		info->idle_threads++;
+	info->started_threads = proc->requested_threads_started;
+	info->max_threads = proc->max_threads;
+
+	list_for_each_entry(w, &proc->todo, entry) {
+		if (w->type == BINDER_WORK_TRANSACTION) {
+			struct binder_transaction *t =
+				container_of(w, struct binder_transaction, work);
+
+			info->oldest_wait_ns = ktime_to_ns(
+				ktime_sub(ktime_get(), t->queued_time));
+			break;
+		}
+	}
+
+	for (i = 0; i < BINDER_POOL_WAIT_BUCKETS && pool->nr_waits; i++) {
+		sum += pool->wait_hist[i];
+		if ((u64)sum * 100 >= (u64)pool->nr_waits * 99) {
+			info->wait_p99_ns = (u64)NSEC_PER_USEC << i;
+			break;
+		}
+	}
+	info->wait_max_ns = pool->max_wait_ns;
+	pool->max_wait_ns = 0;
+	binder_inner_proc_unlock(proc);
+}
+
+static int binder_ioctl_set_pool_notify(struct binder_proc *proc,
+					struct binder_pool_notify *notify)
+{
+	struct eventfd_ctx *ctx = NULL, *old;
+
+	if (notify->eventfd >= 0) {
+		ctx = eventfd_ctx_fdget(notify->eventfd);
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+	}
+
+	binder_inner_proc_lock(proc);
+	old = proc->pool.eventfd;
+	proc->pool.eventfd = ctx;
+	proc->pool.depth_threshold = notify->queue_depth;
+	proc->pool.wait_threshold_ns = notify->wait_ns;
+	binder_inner_proc_unlock(proc);
+
+	if (old)
+		eventfd_ctx_put(old);
+	return 0;
+}
+
 static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	int ret;
@@ -5622,6 +5791,28 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		binder_inner_proc_unlock(proc);
 		break;
 	}
+	case BINDER_GET_POOL_INFO: {
+		struct binder_pool_info info;
+
+		binder_ioctl_get_pool_info(proc, &info);
+		if (copy_to_user(ubuf, &info, sizeof(info))) {
+			ret = -EFAULT;
+			goto err;
+		}
+		break;
+	}
+	case BINDER_SET_POOL_NOTIFY: {
+		struct binder_pool_notify notify;
+
+		if (copy_from_user(&notify, ubuf, sizeof(notify))) {
+			ret = -EFAULT;
+			goto err;
+		}
+		ret = binder_ioctl_set_pool_notify(proc, &notify);
+		if (ret < 0)
+			goto err;
+		break;
+	}
 	default:
 		ret = -EINVAL;
 		goto err;
@@ -6398,9 +6589,11 @@ static void print_binder_proc_stats(struct seq_file *m,
 	seq_printf(m, "  threads: %d\n", count);
 	seq_printf(m, "  requested threads: %d+%d/%d\n"
 			"  ready threads %d\n"
+			"  queued for pool %u\n"
 			"  free async space %zd\n", proc->requested_threads,
 			proc->requested_threads_started, proc->max_threads,
 			ready_threads,
+			proc->pool.queued,
 			free_async_space);
 	count = 0;
 	for (n = rb_first(&proc->nodes); n != NULL; n = rb_next(n))
@@ -6617,6 +6810,14 @@ const struct binder_debugfs_entry binder_debugfs_entries[] = {
 		.fops = &transaction_log_fops,
 		.data = &binder_transaction_log_failed,
 	},
+#ifdef CONFIG_ANDROID_BINDER_TXN_STATS
+	{
+		.name = "transaction_stats",
+		.mode = 0444,
+		.fops = &binder_txn_stats_fops,
+		.data = NULL,
+	},
+#endif
 	{} /* terminator */
 };
 
@@ -23,6 +23,9 @@
 #include <linux/uaccess.h>
 #include <linux/highmem.h>
 #include <linux/sizes.h>
+#include <linux/memfd.h>
+#include <linux/shmem_fs.h>
+#include <linux/fcntl.h>
 #include "binder_alloc.h"
 #include "binder_trace.h"
 #include <trace/hooks/binder.h>
@@ -66,6 +69,11 @@ static size_t binder_alloc_buffer_size(struct binder_alloc *alloc,
 	return binder_buffer_next(buffer)->user_data - buffer->user_data;
 }
 
+static inline unsigned int binder_alloc_size_class(size_t size)
+{
+	return size / sizeof(void *) - 1;
+}
+
 static void binder_insert_free_buffer(struct binder_alloc *alloc,
 				      struct binder_buffer *new_buffer)
 {
@@ -83,6 +91,14 @@ static void binder_insert_free_buffer(struct binder_alloc *alloc,
 		     "%d: add free buffer, size %zd, at %pK\n",
 		      alloc->pid, new_buffer_size, new_buffer);
 
+	if (new_buffer_size <= BINDER_ALLOC_SMALL_MAX) {
+		unsigned int class = binder_alloc_size_class(new_buffer_size);
+
+		list_add(&new_buffer->free_entry, &alloc->free_small[class]);
+		__set_bit(class, alloc->free_small_map);
+		return;
+	}
+
 	while (*p) {
 		parent = *p;
 		buffer = rb_entry(parent, struct binder_buffer, rb_node);
@@ -99,6 +115,79 @@ static void binder_insert_free_buffer(struct binder_alloc *alloc,
 	rb_insert_color(&new_buffer->rb_node, &alloc->free_buffers);
 }
 
+/*
+ * Must be called before the size of @buffer changes, i.e. before a
+ * neighbouring buffer is split off or merged into it, since the size
+ * decides whether @buffer sits on a size-class list or in the rb tree.
+ */
+static void binder_erase_free_buffer(struct binder_alloc *alloc,
+				     struct binder_buffer *buffer)
+{
+	size_t buffer_size = binder_alloc_buffer_size(alloc, buffer);
+	unsigned int class;
+
+	BUG_ON(!buffer->free);
+
+	if (buffer_size > BINDER_ALLOC_SMALL_MAX) {
+		rb_erase(&buffer->rb_node, &alloc->free_buffers);
+		return;
+	}
+
+	class = binder_alloc_size_class(buffer_size);
+	list_del(&buffer->free_entry);
+	if (list_empty(&alloc->free_small[class]))
+		__clear_bit(class, alloc->free_small_map);
+}
+
+/**
+ * binder_alloc_best_fit() - find the smallest free buffer of at least @size
+ * @alloc:	binder_alloc for this proc
+ * @size:	requested size, a non-zero multiple of sizeof(void *)
+ *
+ * Small requests are served from the first non-empty size-class list at or
+ * above @size. Every small free buffer is smaller than any buffer in the
+ * free_buffers rb tree, so the rb tree is only walked when no small buffer
+ * fits.
+ *
+ * Return:	the best fitting free buffer or %NULL if none is large enough
+ */
+static struct binder_buffer *binder_alloc_best_fit(struct binder_alloc *alloc,
+						   size_t size)
+{
+	struct rb_node *n = alloc->free_buffers.rb_node;
+	struct binder_buffer *buffer;
+	struct binder_buffer *best_fit = NULL;
+	size_t buffer_size;
+
+	if (size <= BINDER_ALLOC_SMALL_MAX) {
+		unsigned long class;
+
+		class = find_next_bit(alloc->free_small_map,
+				      BINDER_ALLOC_NR_SIZE_CLASSES,
+				      binder_alloc_size_class(size));
+		if (class < BINDER_ALLOC_NR_SIZE_CLASSES)
+			return list_first_entry(&alloc->free_small[class],
+						struct binder_buffer,
+						free_entry);
+	}
+
+	while (n) {
+		buffer = rb_entry(n, struct binder_buffer, rb_node);
+		BUG_ON(!buffer->free);
+		buffer_size = binder_alloc_buffer_size(alloc, buffer);
+
+		if (size < buffer_size) {
+			best_fit = buffer;
+			n = n->rb_left;
+		} else if (size > buffer_size) {
+			n = n->rb_right;
+		} else {
+			return buffer;
+		}
+	}
+	return best_fit;
+}
+
 static void binder_insert_allocated_buffer_locked(
 		struct binder_alloc *alloc, struct binder_buffer *new_buffer)
 {
@@ -179,6 +268,72 @@ struct binder_buffer *binder_alloc_prepare_to_free(struct binder_alloc *alloc,
 	return buffer;
 }
 
+/**
+ * binder_alloc_reserve_pages() - allocate pages ahead of taking alloc->mutex
+ * @alloc:	binder_alloc for this proc
+ * @pages:	list to collect the allocated pages on
+ *
+ * Allocates up to @alloc->page_reserve_target minus the pages already in
+ * reserve, so that populating a new buffer range under alloc->mutex does
+ * not have to enter the page allocator (and possibly direct reclaim).
+ * The counters are read without the lock; they are only a hint.
+ */
+static void binder_alloc_reserve_pages(struct binder_alloc *alloc,
+				       struct list_head *pages)
+{
+	size_t target = READ_ONCE(alloc->page_reserve_target);
+	size_t count = READ_ONCE(alloc->page_reserve_count);
+	struct page *page;
+
+	for (; count < target; count++) {
+		page = alloc_page(GFP_KERNEL | __GFP_HIGHMEM | __GFP_ZERO);
+		if (!page)
+			break;
+		list_add(&page->lru, pages);
+	}
+}
+
+/*
+ * Move the pages allocated by binder_alloc_reserve_pages() to the reserve,
+ * leaving any that would exceed BINDER_ALLOC_PAGE_RESERVE on @pages for the
+ * caller to free once alloc->mutex has been dropped.
+ */
+static void binder_alloc_stock_reserve_locked(struct binder_alloc *alloc,
+					      struct list_head *pages)
+{
+	struct page *page, *tmp;
+
+	list_for_each_entry_safe(page, tmp, pages, lru) {
+		if (alloc->page_reserve_count >= BINDER_ALLOC_PAGE_RESERVE)
+			break;
+		list_move(&page->lru, &alloc->page_reserve);
+		alloc->page_reserve_count++;
+	}
+}
+
+static struct page *binder_alloc_get_page_locked(struct binder_alloc *alloc)
+{
+	struct page *page;
+
+	page = list_first_entry_or_null(&alloc->page_reserve, struct page, lru);
+	if (!page)
+		return alloc_page(GFP_KERNEL | __GFP_HIGHMEM | __GFP_ZERO);
+
+	list_del_init(&page->lru);
+	alloc->page_reserve_count--;
+	return page;
+}
+
+static void binder_alloc_free_pages(struct list_head *pages)
+{
+	struct page *page, *tmp;
+
+	list_for_each_entry_safe(page, tmp, pages, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+}
+
 static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 				    void __user *start, void __user *end)
 {
@@ -187,7 +342,7 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 	struct binder_lru_page *page;
 	struct vm_area_struct *vma = NULL;
 	struct mm_struct *mm = NULL;
-	bool need_mm = false;
+	size_t nr_populate = 0;
 
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "%d: %s pages %pK-%pK\n", alloc->pid,
@@ -203,13 +358,19 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 
 	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
 		page = &alloc->pages[(page_addr - alloc->buffer) / PAGE_SIZE];
-		if (!page->page_ptr) {
-			need_mm = true;
-			break;
-		}
+		if (!page->page_ptr)
+			nr_populate++;
 	}
 
-	if (need_mm && mmget_not_zero(alloc->vma_vm_mm))
+	/*
+	 * Buffers tend to be carved out of fresh address space in a row,
+	 * so expect the next allocation to populate as many pages as this
+	 * one and have them allocated before alloc->mutex is taken.
+	 */
+	alloc->page_reserve_target = min_t(size_t, nr_populate,
+					   BINDER_ALLOC_PAGE_RESERVE);
+
+	if (nr_populate && mmget_not_zero(alloc->vma_vm_mm))
 		mm = alloc->vma_vm_mm;
 
 	if (mm) {
@@ -217,7 +378,7 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		vma = alloc->vma;
 	}
 
-	if (!vma && need_mm) {
+	if (!vma && nr_populate) {
 		binder_alloc_debug(BINDER_DEBUG_USER_ERROR,
 				   "%d: binder_alloc_buf failed to map pages in userspace, no vma\n",
 				   alloc->pid);
@@ -246,9 +407,7 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 			goto err_page_ptr_cleared;
 
 		trace_binder_alloc_page_start(alloc, index);
-		page->page_ptr = alloc_page(GFP_KERNEL |
-					    __GFP_HIGHMEM |
-					    __GFP_ZERO);
+		page->page_ptr = binder_alloc_get_page_locked(alloc);
 		if (!page->page_ptr) {
 			pr_err("%d: binder_alloc_buf failed for page at %pK\n",
 				alloc->pid, page_addr);
@@ -384,16 +543,16 @@ static bool debug_low_async_space_locked(struct binder_alloc *alloc, int pid)
 
 static struct binder_buffer *binder_alloc_new_buf_locked(
 				struct binder_alloc *alloc,
+				struct binder_buffer **new_buffer,
 				size_t data_size,
 				size_t offsets_size,
 				size_t extra_buffers_size,
 				int is_async,
 				int pid)
 {
-	struct rb_node *n = alloc->free_buffers.rb_node;
+	struct rb_node *n;
 	struct binder_buffer *buffer;
 	size_t buffer_size;
-	struct rb_node *best_fit = NULL;
 	void __user *has_page_addr;
 	void __user *end_page_addr;
 	size_t size, data_offsets_size;
@@ -434,28 +593,15 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	/* Pad 0-size buffers so they get assigned unique addresses */
 	size = max(size, sizeof(void *));
 
-	while (n) {
-		buffer = rb_entry(n, struct binder_buffer, rb_node);
-		BUG_ON(!buffer->free);
-		buffer_size = binder_alloc_buffer_size(alloc, buffer);
-
-		if (size < buffer_size) {
-			best_fit = n;
-			n = n->rb_left;
-		} else if (size > buffer_size)
-			n = n->rb_right;
-		else {
-			best_fit = n;
-			break;
-		}
-	}
-	if (best_fit == NULL) {
+	buffer = binder_alloc_best_fit(alloc, size);
+	if (buffer == NULL) {
 		size_t allocated_buffers = 0;
 		size_t largest_alloc_size = 0;
 		size_t total_alloc_size = 0;
 		size_t free_buffers = 0;
 		size_t largest_free_size = 0;
 		size_t total_free_size = 0;
+		unsigned int class;
 
 		for (n = rb_first(&alloc->allocated_buffers); n != NULL;
 		     n = rb_next(n)) {
@@ -475,6 +621,18 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 			if (buffer_size > largest_free_size)
 				largest_free_size = buffer_size;
 		}
+		for_each_set_bit(class, alloc->free_small_map,
+				 BINDER_ALLOC_NR_SIZE_CLASSES) {
+			list_for_each_entry(buffer, &alloc->free_small[class],
+					    free_entry) {
+				buffer_size = binder_alloc_buffer_size(alloc,
+								       buffer);
+				free_buffers++;
+				total_free_size += buffer_size;
+				if (buffer_size > largest_free_size)
+					largest_free_size = buffer_size;
+			}
+		}
 		binder_alloc_debug(BINDER_DEBUG_USER_ERROR,
 				   "%d: binder_alloc_buf size %zd failed, no address space\n",
 				   alloc->pid, size);
@@ -485,10 +643,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				   free_buffers, largest_free_size);
 		return ERR_PTR(-ENOSPC);
 	}
-	if (n == NULL) {
-		buffer = rb_entry(best_fit, struct binder_buffer, rb_node);
-		buffer_size = binder_alloc_buffer_size(alloc, buffer);
-	}
+	buffer_size = binder_alloc_buffer_size(alloc, buffer);
 
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "%d: binder_alloc_buf size %zd got buffer %pK size %zd\n",
@@ -496,7 +651,6 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 
 	has_page_addr = (void __user *)
 		(((uintptr_t)buffer->user_data + buffer_size) & PAGE_MASK);
-	WARN_ON(n && buffer_size != size);
 	end_page_addr =
 		(void __user *)PAGE_ALIGN((uintptr_t)buffer->user_data + size);
 	if (end_page_addr > has_page_addr)
@@ -506,22 +660,17 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	if (ret)
 		return ERR_PTR(ret);
 
+	binder_erase_free_buffer(alloc, buffer);
 	if (buffer_size != size) {
-		struct binder_buffer *new_buffer;
+		struct binder_buffer *next = *new_buffer;
 
-		new_buffer = kzalloc(sizeof(*buffer), GFP_KERNEL);
-		if (!new_buffer) {
-			pr_err("%s: %d failed to alloc new buffer struct\n",
-			       __func__, alloc->pid);
-			goto err_alloc_buf_struct_failed;
-		}
-		new_buffer->user_data = (u8 __user *)buffer->user_data + size;
-		list_add(&new_buffer->entry, &buffer->entry);
-		new_buffer->free = 1;
-		binder_insert_free_buffer(alloc, new_buffer);
+		*new_buffer = NULL;
+		next->user_data = (u8 __user *)buffer->user_data + size;
+		list_add(&next->entry, &buffer->entry);
+		next->free = 1;
+		binder_insert_free_buffer(alloc, next);
 	}
 
-	rb_erase(best_fit, &alloc->free_buffers);
 	buffer->free = 0;
 	buffer->allow_user_free = 0;
 	binder_insert_allocated_buffer_locked(alloc, buffer);
@@ -551,12 +700,6 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 		}
 	}
 	return buffer;
-
-err_alloc_buf_struct_failed:
-	binder_update_page_range(alloc, 0, (void __user *)
-				 PAGE_ALIGN((uintptr_t)buffer->user_data),
-				 end_page_addr);
-	return ERR_PTR(-ENOMEM);
 }
 
 /**
@@ -573,6 +716,10 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
  * is the sum of the three given sizes (each rounded up to
  * pointer-sized boundary)
  *
+ * The struct binder_buffer for a split-off remainder and any pages the
+ * previous allocation suggests will be needed are allocated before taking
+ * alloc->mutex, keeping the page allocator out of the critical section.
+ *
  * Return:	The allocated buffer or %NULL if error
  */
 struct binder_buffer *binder_alloc_new_buf(struct binder_alloc *alloc,
@@ -582,12 +729,27 @@ struct binder_buffer *binder_alloc_new_buf(struct binder_alloc *alloc,
 					   int is_async,
 					   int pid)
 {
-	struct binder_buffer *buffer;
+	struct binder_buffer *buffer, *next;
+	LIST_HEAD(pages);
+
+	next = kzalloc(sizeof(*next), GFP_KERNEL);
+	if (!next) {
+		pr_err("%s: %d failed to alloc new buffer struct\n",
+		       __func__, alloc->pid);
+		return ERR_PTR(-ENOMEM);
+	}
+	binder_alloc_reserve_pages(alloc, &pages);
 
 	mutex_lock(&alloc->mutex);
-	buffer = binder_alloc_new_buf_locked(alloc, data_size, offsets_size,
-					     extra_buffers_size, is_async, pid);
+	binder_alloc_stock_reserve_locked(alloc, &pages);
+	buffer = binder_alloc_new_buf_locked(alloc, &next, data_size,
+					     offsets_size, extra_buffers_size,
+					     is_async, pid);
 	mutex_unlock(&alloc->mutex);
+
+	/* Unused if @buffer was an exact fit or the allocation failed */
+	kfree(next);
+	binder_alloc_free_pages(&pages);
 	return buffer;
 }
 
@@ -651,6 +813,66 @@ static void binder_delete_free_buffer(struct binder_alloc *alloc,
 	kfree(buffer);
 }
 
+/**
+ * binder_alloc_unmap_user_pages_locked() - undo zero-copy transfers
+ * @alloc:	binder_alloc for this proc
+ * @buffer:	buffer being freed
+ *
+ * Put the binder pages back in place of any sender pages that were mapped
+ * into @buffer by binder_alloc_transfer_user_to_buffer() and drop the pins
+ * on the sender pages and the references on their memfds. If the vma is
+ * already gone only the pins and references are dropped.
+ */
+static void binder_alloc_unmap_user_pages_locked(struct binder_alloc *alloc,
+						 struct binder_buffer *buffer)
+{
+	size_t buffer_size = binder_alloc_buffer_size(alloc, buffer);
+	void __user *start = (void __user *)
+		PAGE_ALIGN((uintptr_t)buffer->user_data);
+	void __user *end = (void __user *)
+		(((uintptr_t)buffer->user_data + buffer_size) & PAGE_MASK);
+	struct vm_area_struct *vma = NULL;
+	struct mm_struct *mm = NULL;
+	void __user *page_addr;
+
+	if (!alloc->zc_pages || end <= start)
+		return;
+
+	if (mmget_not_zero(alloc->vma_vm_mm)) {
+		mm = alloc->vma_vm_mm;
+		mmap_write_lock(mm);
+		vma = binder_alloc_get_vma(alloc);
+	}
+
+	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
+		struct binder_lru_page *page;
+		size_t index;
+
+		index = (page_addr - alloc->buffer) / PAGE_SIZE;
+		page = &alloc->pages[index];
+		if (!page->zc_page)
+			continue;
+
+		if (vma) {
+			zap_page_range(vma, (uintptr_t)page_addr, PAGE_SIZE);
+			if (vm_insert_page(vma, (uintptr_t)page_addr,
+					   page->page_ptr))
+				pr_err("%d: failed to remap binder page at %pK\n",
+				       alloc->pid, page_addr);
+		}
+		unpin_user_page(page->zc_page);
+		page->zc_page = NULL;
+		fput(page->zc_file);
+		page->zc_file = NULL;
+		alloc->zc_pages--;
+	}
+
+	if (mm) {
+		mmap_write_unlock(mm);
+		mmput(mm);
+	}
+}
+
 static void binder_free_buf_locked(struct binder_alloc *alloc,
 				   struct binder_buffer *buffer)
 {
@@ -680,6 +902,7 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 			      alloc->pid, size, alloc->free_async_space);
 	}
 
+	binder_alloc_unmap_user_pages_locked(alloc, buffer);
 	binder_update_page_range(alloc, 0,
 		(void __user *)PAGE_ALIGN((uintptr_t)buffer->user_data),
 		(void __user *)(((uintptr_t)
@@ -691,7 +914,7 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 		struct binder_buffer *next = binder_buffer_next(buffer);
 
 		if (next->free) {
-			rb_erase(&next->rb_node, &alloc->free_buffers);
+			binder_erase_free_buffer(alloc, next);
 			binder_delete_free_buffer(alloc, next);
 		}
 	}
@@ -699,8 +922,8 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 		struct binder_buffer *prev = binder_buffer_prev(buffer);
 
 		if (prev->free) {
+			binder_erase_free_buffer(alloc, prev);
 			binder_delete_free_buffer(alloc, buffer);
-			rb_erase(&prev->rb_node, &alloc->free_buffers);
 			buffer = prev;
 		}
 	}
@@ -868,6 +1091,8 @@ void binder_alloc_deferred_release(struct binder_alloc *alloc)
 		}
 		kfree(alloc->pages);
 	}
+	binder_alloc_free_pages(&alloc->page_reserve);
+	alloc->page_reserve_count = 0;
 	mutex_unlock(&alloc->mutex);
 	if (alloc->vma_vm_mm)
 		mmdrop(alloc->vma_vm_mm);
@@ -940,6 +1165,8 @@ void binder_alloc_print_pages(struct seq_file *m,
 	mutex_unlock(&alloc->mutex);
 	seq_printf(m, "  pages: %d:%d:%d\n", active, lru, free);
 	seq_printf(m, "  pages high watermark: %zu\n", alloc->pages_high);
+	seq_printf(m, "  pages reserved: %zu\n",
+		   READ_ONCE(alloc->page_reserve_count));
 }
 
 /**
@@ -1080,9 +1307,14 @@ static struct shrinker binder_shrinker = {
  */
 void binder_alloc_init(struct binder_alloc *alloc)
 {
+	int i;
+
 	alloc->pid = current->group_leader->pid;
 	mutex_init(&alloc->mutex);
 	INIT_LIST_HEAD(&alloc->buffers);
+	for (i = 0; i < BINDER_ALLOC_NR_SIZE_CLASSES; i++)
+		INIT_LIST_HEAD(&alloc->free_small[i]);
+	INIT_LIST_HEAD(&alloc->page_reserve);
 }
 
 int binder_alloc_shrinker_init(void)
@@ -1161,7 +1393,39 @@ static struct page *binder_alloc_get_page(struct binder_alloc *alloc,
 
 	lru_page = &alloc->pages[index];
 	*pgoffp = pgoff;
-	return lru_page->page_ptr;
+	return lru_page->zc_page ?: lru_page->page_ptr;
+}
+
+/**
+ * binder_alloc_range_shared() - check for sender pages in a buffer range
+ * @alloc: binder_alloc for this proc
+ * @buffer: binder buffer to be accessed
+ * @buffer_offset: offset into @buffer data
+ * @bytes: length of the range
+ *
+ * Pages mapped by binder_alloc_transfer_user_to_buffer() belong to the
+ * sender and must never be written by the kernel.
+ *
+ * Return: true if any page in the range is a sender page
+ */
+static bool binder_alloc_range_shared(struct binder_alloc *alloc,
+				      struct binder_buffer *buffer,
+				      binder_size_t buffer_offset,
+				      size_t bytes)
+{
+	binder_size_t start = buffer_offset +
+		(buffer->user_data - alloc->buffer);
+	size_t index;
+
+	if (!READ_ONCE(alloc->zc_pages) || !bytes)
+		return false;
+
+	for (index = start >> PAGE_SHIFT;
+	     index <= (start + bytes - 1) >> PAGE_SHIFT; index++) {
+		if (alloc->pages[index].zc_page)
+			return true;
+	}
+	return false;
 }
 
 /**
@@ -1186,9 +1450,13 @@ static void binder_alloc_clear_buf(struct binder_alloc *alloc,
 		page = binder_alloc_get_page(alloc, buffer,
 					     buffer_offset, &pgoff);
 		size = min_t(size_t, bytes, PAGE_SIZE - pgoff);
-		kptr = kmap(page) + pgoff;
-		memset(kptr, 0, size);
-		kunmap(page);
+		/* Sender pages hold no data of this proc to clear */
+		if (!binder_alloc_range_shared(alloc, buffer,
+					       buffer_offset, size)) {
+			kptr = kmap(page) + pgoff;
+			memset(kptr, 0, size);
+			kunmap(page);
+		}
 		bytes -= size;
 		buffer_offset += size;
 	}
@@ -1213,7 +1481,8 @@ binder_alloc_copy_user_to_buffer(struct binder_alloc *alloc,
 				 const void __user *from,
 				 size_t bytes)
 {
-	if (!check_buffer(alloc, buffer, buffer_offset, bytes))
+	if (!check_buffer(alloc, buffer, buffer_offset, bytes) ||
+	    binder_alloc_range_shared(alloc, buffer, buffer_offset, bytes))
 		return bytes;
 
 	while (bytes) {
@@ -1238,6 +1507,200 @@ binder_alloc_copy_user_to_buffer(struct binder_alloc *alloc,
 	return 0;
 }
 
+/*
+ * Only pages of a shared memfd mapping sealed against writes and shrinking
+ * are mapped into the target: neither side can modify them afterwards, so
+ * sharing them is indistinguishable from a copy. hugetlbfs memfds are not
+ * taken, vm_insert_page() can't map their pages.
+ */
+static bool binder_alloc_vma_is_sealed(struct vm_area_struct *vma)
+{
+	const long seals = F_SEAL_WRITE | F_SEAL_SHRINK;
+	long ret;
+
+	if (!vma->vm_file || !(vma->vm_flags & VM_SHARED) ||
+	    !shmem_mapping(vma->vm_file->f_mapping))
+		return false;
+
+	ret = memfd_fcntl(vma->vm_file, F_GET_SEALS, 0);
+	return ret >= 0 && (ret & seals) == seals;
+}
+
+/**
+ * binder_alloc_map_user_pages() - map sender pages into the target
+ * @alloc: binder_alloc for the target proc
+ * @dest: page aligned target address inside a buffer allocated from @alloc
+ * @from: page aligned sender address
+ * @nr_pages: number of pages to map
+ *
+ * Pins @nr_pages pages of the current task at @from and maps them at
+ * @dest in place of the binder pages. Each mapped page also holds a
+ * reference on the memfd, so that the pages aren't truncated away when the
+ * sender closes it. The pins and references are dropped when the buffer
+ * is freed.
+ *
+ * Return: 0 on success, negative error if the pages cannot be mapped, in
+ * which case nothing has been changed
+ */
+static int binder_alloc_map_user_pages(struct binder_alloc *alloc,
+				       void __user *dest,
+				       const void __user *from,
+				       size_t nr_pages)
+{
+	unsigned long src = (uintptr_t)from;
+	struct vm_area_struct *vma;
+	struct file *file = NULL;
+	struct mm_struct *mm;
+	struct page **pages;
+	long pinned = 0;
+	size_t i, index;
+	int ret = 0;
+
+	pages = kvmalloc_array(nr_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	mmap_read_lock(current->mm);
+	vma = find_vma(current->mm, src);
+	if (vma && vma->vm_start <= src &&
+	    vma->vm_end - src >= nr_pages * PAGE_SIZE &&
+	    binder_alloc_vma_is_sealed(vma)) {
+		file = get_file(vma->vm_file);
+		pinned = pin_user_pages(src, nr_pages, FOLL_LONGTERM,
+					pages, NULL);
+	}
+	mmap_read_unlock(current->mm);
+	if (pinned != nr_pages) {
+		ret = pinned < 0 ? pinned : -EINVAL;
+		goto err_unpin;
+	}
+
+	for (i = 0; i < nr_pages; i++) {
+		/* vm_insert_page() only takes non-anonymous pages */
+		if (PageAnon(pages[i])) {
+			ret = -EINVAL;
+			goto err_unpin;
+		}
+	}
+
+	mutex_lock(&alloc->mutex);
+	mm = alloc->vma_vm_mm;
+	if (!mmget_not_zero(mm)) {
+		ret = -ESRCH;
+		goto err_mutex_unlock;
+	}
+	mmap_write_lock(mm);
+	vma = binder_alloc_get_vma(alloc);
+	if (!vma) {
+		ret = -ESRCH;
+		goto err_mmap_unlock;
+	}
+
+	index = (dest - alloc->buffer) / PAGE_SIZE;
+	for (i = 0; i < nr_pages; i++) {
+		unsigned long addr = (uintptr_t)dest + i * PAGE_SIZE;
+
+		zap_page_range(vma, addr, PAGE_SIZE);
+		ret = vm_insert_page(vma, addr, pages[i]);
+		if (ret) {
+			if (vm_insert_page(vma, addr,
+					   alloc->pages[index + i].page_ptr))
+				pr_err("%d: failed to remap binder page at %lx\n",
+				       alloc->pid, addr);
+			goto err_restore;
+		}
+		alloc->pages[index + i].zc_page = pages[i];
+		alloc->pages[index + i].zc_file = get_file(file);
+	}
+	alloc->zc_pages += nr_pages;
+
+	mmap_write_unlock(mm);
+	mmput(mm);
+	mutex_unlock(&alloc->mutex);
+	fput(file);
+	kvfree(pages);
+	return 0;
+
+err_restore:
+	while (i--) {
+		unsigned long addr = (uintptr_t)dest + i * PAGE_SIZE;
+
+		zap_page_range(vma, addr, PAGE_SIZE);
+		if (vm_insert_page(vma, addr, alloc->pages[index + i].page_ptr))
+			pr_err("%d: failed to remap binder page at %lx\n",
+			       alloc->pid, addr);
+		alloc->pages[index + i].zc_page = NULL;
+		fput(alloc->pages[index + i].zc_file);
+		alloc->pages[index + i].zc_file = NULL;
+	}
+err_mmap_unlock:
+	mmap_write_unlock(mm);
+	mmput(mm);
+err_mutex_unlock:
+	mutex_unlock(&alloc->mutex);
+err_unpin:
+	if (pinned > 0)
+		unpin_user_pages(pages, pinned);
+	if (file)
+		fput(file);
+	kvfree(pages);
+	return ret;
+}
+
+/**
+ * binder_alloc_transfer_user_to_buffer() - copy or map src user to tgt user
+ * @alloc: binder_alloc for this proc
+ * @buffer: binder buffer to be accessed
+ * @buffer_offset: offset into @buffer data
+ * @from: userspace pointer to source buffer
+ * @bytes: bytes to transfer
+ *
+ * Like binder_alloc_copy_user_to_buffer(), but the full target pages that
+ * have the same offset within a page as the source are not copied if the
+ * source is a sealed memfd mapping: the source pages are mapped into the
+ * target instead. Partial pages at either end, and everything when the
+ * pages cannot be mapped, are copied.
+ *
+ * Return: bytes remaining to be copied
+ */
+unsigned long
+binder_alloc_transfer_user_to_buffer(struct binder_alloc *alloc,
+				     struct binder_buffer *buffer,
+				     binder_size_t buffer_offset,
+				     const void __user *from,
+				     size_t bytes)
+{
+	void __user *dest = buffer->user_data + buffer_offset;
+	void __user *first = (void __user *)PAGE_ALIGN((uintptr_t)dest);
+	void __user *last = (void __user *)
+		(((uintptr_t)dest + bytes) & PAGE_MASK);
+	size_t head, tail;
+	unsigned long ret;
+
+	if (!check_buffer(alloc, buffer, buffer_offset, bytes) ||
+	    (((uintptr_t)dest ^ (uintptr_t)from) & ~PAGE_MASK) ||
+	    last <= first)
+		return binder_alloc_copy_user_to_buffer(alloc, buffer,
+							buffer_offset,
+							from, bytes);
+
+	head = first - dest;
+	tail = dest + bytes - last;
+	if (binder_alloc_map_user_pages(alloc, first, from + head,
+					(last - first) / PAGE_SIZE))
+		return binder_alloc_copy_user_to_buffer(alloc, buffer,
+							buffer_offset,
+							from, bytes);
+
+	ret = binder_alloc_copy_user_to_buffer(alloc, buffer, buffer_offset,
+					       from, head);
+	if (ret)
+		return ret + tail;
+	return binder_alloc_copy_user_to_buffer(alloc, buffer,
+						buffer_offset + (last - dest),
+						from + (last - dest), tail);
+}
+
 static int binder_alloc_do_buffer_copy(struct binder_alloc *alloc,
 				       bool to_buffer,
 				       struct binder_buffer *buffer,
@@ -1248,6 +1711,9 @@ static int binder_alloc_do_buffer_copy(struct binder_alloc *alloc,
 	/* All copies must be 32-bit aligned and 32-bit size */
 	if (!check_buffer(alloc, buffer, buffer_offset, bytes))
 		return -EINVAL;
+	if (to_buffer &&
+	    binder_alloc_range_shared(alloc, buffer, buffer_offset, bytes))
+		return -EINVAL;
 
 	while (bytes) {
 		unsigned long size;
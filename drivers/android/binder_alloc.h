@@ -13,6 +13,8 @@
 #include <linux/vmalloc.h>
 #include <linux/slab.h>
 #include <linux/list_lru.h>
+#include <linux/sizes.h>
+#include <linux/bitmap.h>
 #include <uapi/linux/android/binder.h>
 
 extern struct list_lru binder_alloc_lru;
@@ -22,6 +24,7 @@ struct binder_transaction;
  * struct binder_buffer - buffer used for binder transactions
  * @entry:              entry alloc->buffers
  * @rb_node:            node for allocated_buffers/free_buffers rb trees
+ * @free_entry:         entry in alloc->free_small[] for small free buffers
  * @free:               %true if buffer is free
  * @clear_on_free:      %true if buffer must be zeroed after use
  * @allow_user_free:    %true if user is allowed to free buffer
@@ -41,8 +44,11 @@ struct binder_transaction;
  */
 struct binder_buffer {
 	struct list_head entry; /* free and allocated entries by address */
-	struct rb_node rb_node; /* free entry by size or allocated entry */
-				/* by address */
+	union {
+		struct rb_node rb_node; /* free entry by size or allocated */
+					/* entry by address */
+		struct list_head free_entry; /* small free entry by size */
+	};
 	unsigned free:1;
 	unsigned clear_on_free:1;
 	unsigned allow_user_free:1;
@@ -60,16 +66,35 @@ struct binder_buffer {
 	int    pid;
 };
 
+/*
+ * Free buffers of up to BINDER_ALLOC_SMALL_MAX bytes are kept on per-size
+ * free lists instead of the free_buffers rb tree. Buffer sizes are always a
+ * multiple of sizeof(void *), so every small size has its own list and the
+ * best fit is the first non-empty list at or above the requested size.
+ */
+#define BINDER_ALLOC_SMALL_MAX		SZ_512
+#define BINDER_ALLOC_NR_SIZE_CLASSES	(BINDER_ALLOC_SMALL_MAX / sizeof(void *))
+
+/*
+ * Upper bound on the number of pages kept on binder_alloc->page_reserve
+ */
+#define BINDER_ALLOC_PAGE_RESERVE	8
+
 /**
  * struct binder_lru_page - page object used for binder shrinker
  * @page_ptr: pointer to physical page in mmap'd space
  * @lru:      entry in binder_alloc_lru
  * @alloc:    binder_alloc for a proc
+ * @zc_page:  pinned sender page mapped in place of @page_ptr by a
+ *            zero-copy transfer, or NULL
+ * @zc_file:  memfd @zc_page belongs to, referenced as long as it is mapped
  */
 struct binder_lru_page {
 	struct list_head lru;
 	struct page *page_ptr;
 	struct binder_alloc *alloc;
+	struct page *zc_page;
+	struct file *zc_file;
 };
 
 /**
@@ -81,8 +106,11 @@ struct binder_lru_page {
  * @vma_vm_mm:          copy of vma->vm_mm (invarient after mmap)
  * @buffer:             base of per-proc address space mapped via mmap
  * @buffers:            list of all buffers for this proc
- * @free_buffers:       rb tree of buffers available for allocation
- *                      sorted by size
+ * @free_buffers:       rb tree of buffers larger than BINDER_ALLOC_SMALL_MAX
+ *                      available for allocation sorted by size
+ * @free_small:         lists of free buffers of up to BINDER_ALLOC_SMALL_MAX
+ *                      bytes, indexed by size class
+ * @free_small_map:     bitmap of non-empty @free_small lists
  * @allocated_buffers:  rb tree of allocated buffers sorted by address
  * @free_async_space:   VA space available for async buffers. This is
  *                      initialized at mmap time to 1/2 the full VA space
@@ -90,6 +118,13 @@ struct binder_lru_page {
  * @buffer_size:        size of address space specified via mmap
  * @pid:                pid for associated binder_proc (invariant after init)
  * @pages_high:         high watermark of offset in @pages
+ * @page_reserve:       zeroed pages allocated outside of @mutex, consumed
+ *                      before falling back to alloc_page() under @mutex
+ * @page_reserve_count: number of pages on @page_reserve
+ * @page_reserve_target: number of pages to allocate ahead for the next
+ *                      buffer, based on how many pages the last buffer
+ *                      allocation had to populate
+ * @zc_pages:           number of @pages currently replaced by sender pages
  * @oneway_spam_detected: %true if oneway spam detection fired, clear that
  * flag once the async buffer has returned to a healthy state
  *
@@ -105,6 +140,8 @@ struct binder_alloc {
 	void __user *buffer;
 	struct list_head buffers;
 	struct rb_root free_buffers;
+	struct list_head free_small[BINDER_ALLOC_NR_SIZE_CLASSES];
+	DECLARE_BITMAP(free_small_map, BINDER_ALLOC_NR_SIZE_CLASSES);
 	struct rb_root allocated_buffers;
 	size_t free_async_space;
 	struct binder_lru_page *pages;
@@ -112,6 +149,10 @@ struct binder_alloc {
 	uint32_t buffer_free;
 	int pid;
 	size_t pages_high;
+	struct list_head page_reserve;
+	size_t page_reserve_count;
+	size_t page_reserve_target;
+	size_t zc_pages;
 	bool oneway_spam_detected;
 };
 
@@ -170,6 +211,13 @@ binder_alloc_copy_user_to_buffer(struct binder_alloc *alloc,
 				 const void __user *from,
 				 size_t bytes);
 
+unsigned long
+binder_alloc_transfer_user_to_buffer(struct binder_alloc *alloc,
+				     struct binder_buffer *buffer,
+				     binder_size_t buffer_offset,
+				     const void __user *from,
+				     size_t bytes);
+
 int binder_alloc_copy_to_buffer(struct binder_alloc *alloc,
 				struct binder_buffer *buffer,
 				binder_size_t buffer_offset,
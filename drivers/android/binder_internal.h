@@ -5,6 +5,8 @@
 
 #include <linux/export.h>
 #include <linux/fs.h>
+#include <linux/jump_label.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/miscdevice.h>
 #include <linux/mutex.h>
@@ -351,6 +353,37 @@ enum binder_prio_state {
 	BINDER_PRIO_ABORT,	/* abort the pending priority restore */
 };
 
+#define BINDER_POOL_WAIT_BUCKETS	24
+#define BINDER_POOL_WAIT_DECAY		1024
+
+struct eventfd_ctx;
+
+/**
+ * struct binder_pool_pressure - thread pool load of a binder process
+ * @queued:            transactions waiting on proc->todo for a thread
+ * @wait_hist:         time transactions spent on proc->todo; bucket i
+ *                     counts waits below 2^i usec
+ * @nr_waits:          sum of @wait_hist, halved together with it every
+ *                     BINDER_POOL_WAIT_DECAY waits so that old samples
+ *                     fade out
+ * @max_wait_ns:       longest wait seen since the last BINDER_GET_POOL_INFO
+ * @eventfd:           signalled when a threshold below is crossed, or NULL
+ * @depth_threshold:   signal @eventfd when @queued reaches this, 0=off
+ * @wait_threshold_ns: signal @eventfd when a transaction waited longer
+ *                     than this, 0=off
+ *
+ * All fields are protected by proc->inner_lock.
+ */
+struct binder_pool_pressure {
+	unsigned int queued;
+	u32 wait_hist[BINDER_POOL_WAIT_BUCKETS];
+	u32 nr_waits;
+	u64 max_wait_ns;
+	struct eventfd_ctx *eventfd;
+	u32 depth_threshold;
+	u64 wait_threshold_ns;
+};
+
 /**
  * struct binder_proc - binder process bookkeeping
  * @proc_node:            element for binder_procs list
@@ -422,6 +455,9 @@ enum binder_prio_state {
  * @binderfs_entry:       process-specific binderfs log file
  * @oneway_spam_detection_enabled: process enabled oneway spam detection
  *                        or not
+ * @pool:                 thread pool load, reported to userspace as a
+ *                        hint to grow or shrink the pool
+ *                        (protected by @inner_lock)
  *
  * Bookkeeping structure for binder processes
  */
@@ -459,6 +495,7 @@ struct binder_proc {
 	spinlock_t outer_lock;
 	struct dentry *binderfs_entry;
 	bool oneway_spam_detection_enabled;
+	struct binder_pool_pressure pool;
 };
 
 /**
@@ -571,6 +608,23 @@ struct binder_transaction {
 	 * during thread teardown
 	 */
 	spinlock_t lock;
+	/**
+	 * @queued_time: time the transaction was queued on @to_proc->todo
+	 *               (protected by @to_proc->inner_lock)
+	 */
+	ktime_t queued_time;
+#ifdef CONFIG_ANDROID_BINDER_TXN_STATS
+	/**
+	 * @stats:        latency histograms this transaction is accounted
+	 *                to, or NULL; replies share the entry of the
+	 *                transaction they answer
+	 * @stats_start:  time the (original) transaction was sent
+	 * @stats_pickup: time the target thread picked up the transaction
+	 */
+	struct binder_txn_stats_entry *stats;
+	ktime_t stats_start;
+	ktime_t stats_pickup;
+#endif
 	ANDROID_VENDOR_DATA(1);
 	ANDROID_OEM_DATA_ARRAY(1, 2);
 };
@@ -595,4 +649,55 @@ struct binder_object {
 	};
 };
 
+#ifdef CONFIG_ANDROID_BINDER_TXN_STATS
+DECLARE_STATIC_KEY_FALSE(binder_txn_stats_enabled);
+extern const struct file_operations binder_txn_stats_fops;
+
+void __binder_txn_stats_start(struct binder_transaction *t,
+			      struct binder_transaction *in_reply_to,
+			      struct binder_proc *proc,
+			      struct binder_node *target_node);
+void __binder_txn_stats_received(struct binder_transaction *t, u32 cmd);
+
+/**
+ * binder_txn_stats_start() - start accounting a new transaction or reply
+ * @t:           newly created transaction
+ * @in_reply_to: transaction @t replies to, or NULL
+ * @proc:        sending binder_proc
+ * @target_node: target node, NULL for replies
+ *
+ * Must be called after @t->to_proc, @t->code and @t->sender_euid are set.
+ */
+static inline void
+binder_txn_stats_start(struct binder_transaction *t,
+		       struct binder_transaction *in_reply_to,
+		       struct binder_proc *proc,
+		       struct binder_node *target_node)
+{
+	if (in_reply_to ? !!in_reply_to->stats :
+	    static_branch_unlikely(&binder_txn_stats_enabled))
+		__binder_txn_stats_start(t, in_reply_to, proc, target_node);
+}
+
+/**
+ * binder_txn_stats_received() - account a transaction read by its target
+ * @t:   transaction handed to userspace
+ * @cmd: BR_TRANSACTION, BR_TRANSACTION_SEC_CTX or BR_REPLY
+ */
+static inline void binder_txn_stats_received(struct binder_transaction *t,
+					     u32 cmd)
+{
+	if (t->stats)
+		__binder_txn_stats_received(t, cmd);
+}
+#else
+static inline void
+binder_txn_stats_start(struct binder_transaction *t,
+		       struct binder_transaction *in_reply_to,
+		       struct binder_proc *proc,
+		       struct binder_node *target_node) {}
+static inline void binder_txn_stats_received(struct binder_transaction *t,
+					     u32 cmd) {}
+#endif
+
 #endif /* _LINUX_BINDER_INTERNAL_H */
@@ -0,0 +1,325 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/* binder_txn_stats.c
+ *
+ * Android IPC Subsystem
+ *
+ * In-kernel aggregation of binder transaction latencies, keyed by
+ * (sender uid, sender pid, target pid, target node, transaction code).
+ *
+ * Each key owns per-cpu log-linear histograms for the queue wait, the
+ * time the target spends handling the transaction and the end-to-end
+ * reply latency. Keys are never removed once created so transactions in
+ * flight can hold on to their entry without taking a reference; the
+ * number of keys is bounded by the max_entries parameter and
+ * transactions for keys beyond that are only counted as dropped.
+ *
+ * Accounting is off by default and enabled through the "enable"
+ * parameter. The histograms are exported in binary form through the
+ * binder_logs/transaction_stats file, see
+ * include/uapi/linux/android/binderfs.h for the layout.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/rculist.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <uapi/linux/android/binder.h>
+#include "binder_internal.h"
+
+#define BINDER_TXN_STATS_HASH_BITS	8
+
+struct binder_txn_stats_key {
+	u32 sender_uid;
+	u32 sender_pid;
+	u32 target_pid;
+	u32 target_node;
+	u32 code;
+};
+
+struct binder_txn_stats_hist {
+	u32 counts[BINDERFS_TXN_STATS_NR_METRICS]
+		  [BINDERFS_TXN_STATS_NR_BUCKETS];
+};
+
+/**
+ * struct binder_txn_stats_entry - aggregation entry for one key
+ * @hnode: entry in binder_txn_stats_table
+ * @key:   sender/target/code this entry accounts
+ * @hist:  per-cpu histograms, summed up when the stats file is opened
+ */
+struct binder_txn_stats_entry {
+	struct hlist_node hnode;
+	struct binder_txn_stats_key key;
+	struct binder_txn_stats_hist __percpu *hist;
+};
+
+DEFINE_STATIC_KEY_FALSE(binder_txn_stats_enabled);
+
+static DEFINE_HASHTABLE(binder_txn_stats_table, BINDER_TXN_STATS_HASH_BITS);
+static DEFINE_SPINLOCK(binder_txn_stats_lock);
+static unsigned int binder_txn_stats_nr_entries;
+static atomic64_t binder_txn_stats_dropped = ATOMIC64_INIT(0);
+
+static uint binder_txn_stats_max_entries = 256;
+module_param_named(max_entries, binder_txn_stats_max_entries, uint, 0644);
+
+static int binder_txn_stats_enable_set(const char *val,
+				       const struct kernel_param *kp)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool(val, &enable);
+	if (ret)
+		return ret;
+
+	if (enable)
+		static_branch_enable(&binder_txn_stats_enabled);
+	else
+		static_branch_disable(&binder_txn_stats_enabled);
+	return 0;
+}
+
+static int binder_txn_stats_enable_get(char *buffer,
+				       const struct kernel_param *kp)
+{
+	return sprintf(buffer, "%c\n",
+		       static_key_enabled(&binder_txn_stats_enabled) ?
+		       'Y' : 'N');
+}
+
+static const struct kernel_param_ops binder_txn_stats_enable_ops = {
+	.set = binder_txn_stats_enable_set,
+	.get = binder_txn_stats_enable_get,
+};
+module_param_cb(enable, &binder_txn_stats_enable_ops, NULL, 0644);
+
+static unsigned int binder_txn_stats_bucket(s64 ns)
+{
+	u64 v = ns > 0 ? (u64)ns >> BINDERFS_TXN_STATS_MIN_SHIFT : 0;
+	unsigned int msb, bucket;
+
+	if (v < (1U << BINDERFS_TXN_STATS_SUB_BITS))
+		return v;
+
+	msb = fls64(v) - 1;
+	bucket = ((msb - BINDERFS_TXN_STATS_SUB_BITS + 1) <<
+		  BINDERFS_TXN_STATS_SUB_BITS) +
+		 ((v >> (msb - BINDERFS_TXN_STATS_SUB_BITS)) &
+		  ((1U << BINDERFS_TXN_STATS_SUB_BITS) - 1));
+	return min_t(unsigned int, bucket, BINDERFS_TXN_STATS_NR_BUCKETS - 1);
+}
+
+static void binder_txn_stats_record(struct binder_txn_stats_entry *e,
+				    enum binderfs_txn_stats_metric metric,
+				    ktime_t start, ktime_t end)
+{
+	unsigned int bucket = binder_txn_stats_bucket(ktime_to_ns(end) -
+						      ktime_to_ns(start));
+
+	this_cpu_inc(e->hist->counts[metric][bucket]);
+}
+
+static u32 binder_txn_stats_hash(const struct binder_txn_stats_key *key)
+{
+	return jhash2((const u32 *)key, sizeof(*key) / sizeof(u32), 0);
+}
+
+static struct binder_txn_stats_entry *
+binder_txn_stats_lookup(const struct binder_txn_stats_key *key, u32 hash)
+{
+	struct binder_txn_stats_entry *e;
+
+	hash_for_each_possible_rcu(binder_txn_stats_table, e, hnode, hash) {
+		if (!memcmp(&e->key, key, sizeof(*key)))
+			return e;
+	}
+	return NULL;
+}
+
+/*
+ * Called from binder_transaction() for every new key. Entries are
+ * allocated with GFP_NOWAIT so that statistics never hold up a
+ * transaction on reclaim; such a transaction is counted as dropped.
+ */
+static struct binder_txn_stats_entry *
+binder_txn_stats_get(const struct binder_txn_stats_key *key)
+{
+	struct binder_txn_stats_entry *e, *new;
+	u32 hash = binder_txn_stats_hash(key);
+
+	rcu_read_lock();
+	e = binder_txn_stats_lookup(key, hash);
+	rcu_read_unlock();
+	if (e)
+		return e;
+
+	if (READ_ONCE(binder_txn_stats_nr_entries) >=
+	    READ_ONCE(binder_txn_stats_max_entries))
+		return NULL;
+
+	new = kzalloc(sizeof(*new), GFP_NOWAIT | __GFP_NOWARN);
+	if (!new)
+		return NULL;
+	new->hist = alloc_percpu_gfp(struct binder_txn_stats_hist,
+				     GFP_NOWAIT | __GFP_NOWARN);
+	if (!new->hist) {
+		kfree(new);
+		return NULL;
+	}
+	new->key = *key;
+
+	spin_lock(&binder_txn_stats_lock);
+	e = binder_txn_stats_lookup(key, hash);
+	if (!e && binder_txn_stats_nr_entries <
+		  READ_ONCE(binder_txn_stats_max_entries)) {
+		hash_add_rcu(binder_txn_stats_table, &new->hnode, hash);
+		WRITE_ONCE(binder_txn_stats_nr_entries,
+			   binder_txn_stats_nr_entries + 1);
+		e = new;
+		new = NULL;
+	}
+	spin_unlock(&binder_txn_stats_lock);
+
+	if (new) {
+		free_percpu(new->hist);
+		kfree(new);
+	}
+	return e;
+}
+
+void __binder_txn_stats_start(struct binder_transaction *t,
+			      struct binder_transaction *in_reply_to,
+			      struct binder_proc *proc,
+			      struct binder_node *target_node)
+{
+	struct binder_txn_stats_key key = {};
+	ktime_t now = ktime_get();
+
+	if (in_reply_to) {
+		binder_txn_stats_record(in_reply_to->stats,
+					BINDERFS_TXN_STATS_HANDLE,
+					in_reply_to->stats_pickup, now);
+		t->stats = in_reply_to->stats;
+		t->stats_start = in_reply_to->stats_start;
+		return;
+	}
+
+	key.sender_uid = from_kuid(&init_user_ns, t->sender_euid);
+	key.sender_pid = proc->pid;
+	key.target_pid = t->to_proc->pid;
+	key.target_node = target_node ? target_node->debug_id : 0;
+	key.code = t->code;
+
+	t->stats = binder_txn_stats_get(&key);
+	if (!t->stats) {
+		atomic64_inc(&binder_txn_stats_dropped);
+		return;
+	}
+	t->stats_start = now;
+}
+
+void __binder_txn_stats_received(struct binder_transaction *t, u32 cmd)
+{
+	ktime_t now = ktime_get();
+
+	if (cmd == BR_REPLY) {
+		binder_txn_stats_record(t->stats, BINDERFS_TXN_STATS_REPLY,
+					t->stats_start, now);
+		return;
+	}
+
+	binder_txn_stats_record(t->stats, BINDERFS_TXN_STATS_QUEUE_WAIT,
+				t->stats_start, now);
+	t->stats_pickup = now;
+}
+
+struct binder_txn_stats_snapshot {
+	size_t size;
+	char data[];
+};
+
+static int binder_txn_stats_open(struct inode *inode, struct file *file)
+{
+	struct binder_txn_stats_snapshot *snap;
+	struct binderfs_txn_stats_header *hdr;
+	struct binderfs_txn_stats_entry *out;
+	struct binder_txn_stats_entry *e;
+	unsigned int nr, i = 0;
+	int bkt, cpu, m, b;
+
+	nr = READ_ONCE(binder_txn_stats_nr_entries);
+	snap = kvzalloc(struct_size(snap, data, sizeof(*hdr) +
+				    (size_t)nr * sizeof(*out)), GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	hdr = (struct binderfs_txn_stats_header *)snap->data;
+	out = (struct binderfs_txn_stats_entry *)(hdr + 1);
+
+	rcu_read_lock();
+	hash_for_each_rcu(binder_txn_stats_table, bkt, e, hnode) {
+		if (i == nr)
+			break;
+		out->sender_uid = e->key.sender_uid;
+		out->sender_pid = e->key.sender_pid;
+		out->target_pid = e->key.target_pid;
+		out->target_node = e->key.target_node;
+		out->code = e->key.code;
+		for_each_possible_cpu(cpu) {
+			struct binder_txn_stats_hist *h;
+
+			h = per_cpu_ptr(e->hist, cpu);
+			for (m = 0; m < BINDERFS_TXN_STATS_NR_METRICS; m++)
+				for (b = 0; b < BINDERFS_TXN_STATS_NR_BUCKETS; b++)
+					out->counts[m][b] +=
+						READ_ONCE(h->counts[m][b]);
+		}
+		out++;
+		i++;
+	}
+	rcu_read_unlock();
+
+	hdr->magic = BINDERFS_TXN_STATS_MAGIC;
+	hdr->version = BINDERFS_TXN_STATS_VERSION;
+	hdr->nr_entries = i;
+	hdr->nr_buckets = BINDERFS_TXN_STATS_NR_BUCKETS;
+	hdr->nr_metrics = BINDERFS_TXN_STATS_NR_METRICS;
+	hdr->min_shift = BINDERFS_TXN_STATS_MIN_SHIFT;
+	hdr->sub_bits = BINDERFS_TXN_STATS_SUB_BITS;
+	hdr->dropped = atomic64_read(&binder_txn_stats_dropped);
+	snap->size = sizeof(*hdr) + (size_t)i * sizeof(*out);
+
+	file->private_data = snap;
+	return 0;
+}
+
+static ssize_t binder_txn_stats_read(struct file *file, char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	struct binder_txn_stats_snapshot *snap = file->private_data;
+
+	return simple_read_from_buffer(buf, count, ppos, snap->data,
+				       snap->size);
+}
+
+static int binder_txn_stats_release(struct inode *inode, struct file *file)
+{
+	kvfree(file->private_data);
+	return 0;
+}
+
+const struct file_operations binder_txn_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = binder_txn_stats_open,
+	.read = binder_txn_stats_read,
+	.llseek = default_llseek,
+	.release = binder_txn_stats_release,
+};
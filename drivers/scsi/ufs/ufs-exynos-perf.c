@@ -12,6 +12,7 @@
 // the Free Software Foundation; either version 2 of the License, or
 // (at your option) any later version.
 #include <linux/of.h>
+#include <linux/seq_file.h>
 #include "ufs-exynos-perf.h"
 #define CREATE_TRACE_POINTS
 #include <trace/events/ufs_exynos_perf.h>
@@ -61,24 +62,58 @@ static void ufs_perf_cp_and_trg(struct ufs_perf_control *perf,
 	spin_unlock_irqrestore(&perf->lock, flags);
 }
 
-static inline void ufs_perf_pm_qos_ctrl(struct ufs_perf_control *perf, int hold)
+static inline void ufs_perf_pm_qos_ctrl(struct ufs_perf_control *perf,
+					enum ufs_perf_level level)
 {
-#ifdef PM_QOS_DEVICE_THROUGHPUT
+	/* INT and MIF from UFS_PERF_LEVEL_IO, CPU clusters at FULL */
 	if (perf->pm_qos_int_value)
-		pm_qos_update_request(&perf->pm_qos_int,
-				      ((hold) ? perf->pm_qos_int_value : 0));
+		exynos_pm_qos_update_request(&perf->pm_qos_int,
+				((level >= UFS_PERF_LEVEL_IO) ?
+				 perf->pm_qos_int_value : 0));
 	if (perf->pm_qos_mif_value)
-		pm_qos_update_request(&perf->pm_qos_mif,
-				      ((hold) ? perf->pm_qos_mif_value : 0));
+		exynos_pm_qos_update_request(&perf->pm_qos_mif,
+				((level >= UFS_PERF_LEVEL_IO) ?
+				 perf->pm_qos_mif_value : 0));
 	if (perf->pm_qos_cluster1_value)
-		pm_qos_update_request(&perf->pm_qos_cluster1,
-				      ((hold) ?
-				       perf->pm_qos_cluster1_value : 0));
+		exynos_pm_qos_update_request(&perf->pm_qos_cluster1,
+				((level >= UFS_PERF_LEVEL_FULL) ?
+				 perf->pm_qos_cluster1_value : 0));
 	if (perf->pm_qos_cluster0_value)
-		pm_qos_update_request(&perf->pm_qos_cluster0,
-				      ((hold) ?
-				       perf->pm_qos_cluster0_value : 0));
-#endif
+		exynos_pm_qos_update_request(&perf->pm_qos_cluster0,
+				((level >= UFS_PERF_LEVEL_FULL) ?
+				 perf->pm_qos_cluster0_value : 0));
+}
+
+/* account the time spent at the current level, with perf->lock held */
+static void ufs_perf_account_level(struct ufs_perf_control *perf, u64 now)
+{
+	perf->level_time_ns[perf->level] += now - perf->level_since_ns;
+	if (perf->level == UFS_PERF_LEVEL_FULL)
+		perf->budget_used_ns += now - max(perf->level_since_ns,
+						  perf->budget_start_ns);
+	perf->level_since_ns = now;
+}
+
+static void ufs_perf_apply_level(struct ufs_perf_control *perf)
+{
+	enum ufs_perf_level level;
+	unsigned long flags;
+
+	spin_lock_irqsave(&perf->lock, flags);
+	level = perf->target_level;
+	spin_unlock_irqrestore(&perf->lock, flags);
+
+	if (level == perf->level)
+		return;
+
+	ufs_perf_pm_qos_ctrl(perf, level);
+
+	spin_lock_irqsave(&perf->lock, flags);
+	ufs_perf_account_level(perf, ktime_get_ns());
+	perf->level = level;
+	perf->level_cnt[level]++;
+	trace_ufs_exynos_perf_lock(10 + level);
+	spin_unlock_irqrestore(&perf->lock, flags);
 }
 
 static int ufs_perf_handler(void *data)
@@ -109,9 +144,11 @@ static int ufs_perf_handler(void *data)
 		is_held = perf->is_held;	//
 		spin_unlock_irqrestore(&perf->lock, flags);
 
-		if (ctrl_flag == UFS_PERF_CTRL_LOCK) {
+		if (ctrl_flag == UFS_PERF_CTRL_LEVEL) {
+			ufs_perf_apply_level(perf);
+		} else if (ctrl_flag == UFS_PERF_CTRL_LOCK) {
 			if (!is_locked) {
-				ufs_perf_pm_qos_ctrl(perf, 1);
+				ufs_perf_pm_qos_ctrl(perf, UFS_PERF_LEVEL_FULL);
 
 				spin_lock_irqsave(&perf->lock, flags);
 				trace_ufs_exynos_perf_lock(1);
@@ -128,7 +165,7 @@ static int ufs_perf_handler(void *data)
 				trace_ufs_exynos_perf_lock(3);
 				spin_unlock_irqrestore(&perf->lock, flags);
 
-				ufs_perf_pm_qos_ctrl(perf, 0);
+				ufs_perf_pm_qos_ctrl(perf, UFS_PERF_LEVEL_NONE);
 			}
 
 			spin_lock_irqsave(&perf->lock, flags);
@@ -158,6 +195,202 @@ static int ufs_perf_handler(void *data)
 	return 0;
 }
 
+/* PREDICTIVE MODE */
+
+/*
+ * Instead of counting requests in fixed periods, the predictive mode keeps
+ * a moving average of the inter-arrival time and of the read share of the
+ * requests, and the number of outstanding requests. It boosts as soon as
+ * those predict a heavy load, e.g. on the first requests of a burst of
+ * reads at application launch, and drops the boost when the prediction
+ * stays lower for a hold time that grows with the inter-arrival time, so
+ * that a boost doesn't linger once a bulk copy is over. The time spent at
+ * UFS_PERF_LEVEL_FULL is bounded by an energy budget per period.
+ */
+#define UFS_PERF_EWMA_SHIFT	3
+#define UFS_PERF_RATIO_ONE	1024
+
+/* thresholds to stay at a level are 3/4 of the ones to enter it */
+static u32 ufs_perf_thld(u32 th, bool in)
+{
+	return in ? th - (th >> 2) : th;
+}
+
+static enum ufs_perf_level ufs_perf_predict_level(
+				struct ufs_perf_control *perf,
+				u64 iat_ns, u32 depth)
+{
+	enum ufs_perf_level cur = perf->target_level;
+	u64 iops = div64_u64(NSEC_PER_SEC, iat_ns ?: 1);
+	u32 read_pct = perf->read_ratio * 100 / UFS_PERF_RATIO_ONE;
+	bool full = cur >= UFS_PERF_LEVEL_FULL;
+	bool io = cur >= UFS_PERF_LEVEL_IO;
+
+	if ((iops >= ufs_perf_thld(perf->th_iops_h, full) &&
+	     read_pct >= perf->th_read_pct) ||
+	    depth >= ufs_perf_thld(perf->th_depth_h, full))
+		return UFS_PERF_LEVEL_FULL;
+
+	if (iops >= ufs_perf_thld(perf->th_iops_l, io) ||
+	    depth >= ufs_perf_thld(perf->th_depth_l, io))
+		return UFS_PERF_LEVEL_IO;
+
+	return UFS_PERF_LEVEL_NONE;
+}
+
+/* cap @target to UFS_PERF_LEVEL_IO once the budget of the period is spent */
+static bool ufs_perf_budget_cap(struct ufs_perf_control *perf,
+				enum ufs_perf_level *target, u64 now)
+{
+	u64 used;
+
+	if (!perf->budget_in_ms || *target != UFS_PERF_LEVEL_FULL)
+		return false;
+
+	if (now - perf->budget_start_ns >=
+	    (u64)perf->budget_period_in_ms * NSEC_PER_MSEC) {
+		perf->budget_start_ns = now;
+		perf->budget_used_ns = 0;
+	}
+
+	used = perf->budget_used_ns;
+	if (perf->level == UFS_PERF_LEVEL_FULL)
+		used += now - max(perf->level_since_ns, perf->budget_start_ns);
+	if (used < (u64)perf->budget_in_ms * NSEC_PER_MSEC)
+		return false;
+
+	if (perf->target_level != UFS_PERF_LEVEL_IO)
+		perf->budget_cap_cnt++;
+	*target = UFS_PERF_LEVEL_IO;
+	return true;
+}
+
+static u64 ufs_perf_hold_ns(struct ufs_perf_control *perf)
+{
+	/* reads come in bursts, hold longer through their gaps */
+	u64 hold = ((perf->iat_ns << 4) *
+		    (UFS_PERF_RATIO_ONE + perf->read_ratio)) >> 10;
+
+	return clamp_t(u64, hold,
+		       (u64)perf->th_hold_min_in_ms * NSEC_PER_MSEC,
+		       (u64)perf->th_hold_max_in_ms * NSEC_PER_MSEC);
+}
+
+static void ufs_perf_set_target(struct ufs_perf_control *perf,
+				enum ufs_perf_level target)
+{
+	perf->drop_since_ns = 0;
+	if (target == perf->target_level)
+		return;
+
+	perf->target_level = target;
+	perf->ctrl_flag = UFS_PERF_CTRL_LEVEL;
+	if (!perf->is_active)
+		complete(&perf->completion);
+}
+
+static void ufs_perf_predict(struct ufs_perf_control *perf,
+			     enum ufs_perf_op op)
+{
+	u32 depth = atomic_inc_return(&perf->inflight);
+	u64 now = ktime_get_ns();
+	enum ufs_perf_level target;
+	unsigned long flags;
+	bool boosted;
+	u64 dt, hold;
+
+	spin_lock_irqsave(&perf->lock, flags);
+	dt = min_t(u64, now - perf->last_issue_ns, NSEC_PER_SEC);
+	perf->last_issue_ns = now;
+	perf->iat_ns += (dt >> UFS_PERF_EWMA_SHIFT) -
+			(perf->iat_ns >> UFS_PERF_EWMA_SHIFT);
+	perf->read_ratio -= perf->read_ratio >> UFS_PERF_EWMA_SHIFT;
+	if (op == UFS_PERF_OP_R)
+		perf->read_ratio += UFS_PERF_RATIO_ONE >> UFS_PERF_EWMA_SHIFT;
+
+	target = ufs_perf_predict_level(perf, perf->iat_ns, depth);
+	hold = ufs_perf_hold_ns(perf);
+
+	/* boost at once, but drop only after the prediction held low */
+	if (ufs_perf_budget_cap(perf, &target, now) ||
+	    target > perf->target_level)
+		ufs_perf_set_target(perf, target);
+	else if (target == perf->target_level)
+		perf->drop_since_ns = 0;
+	else if (!perf->drop_since_ns)
+		perf->drop_since_ns = now;
+	else if (now - perf->drop_since_ns >= hold)
+		ufs_perf_set_target(perf, target);
+
+	boosted = perf->target_level != UFS_PERF_LEVEL_NONE;
+	spin_unlock_irqrestore(&perf->lock, flags);
+
+	if (boosted)
+		mod_timer(&perf->hold_timer,
+			  jiffies + nsecs_to_jiffies(hold) + 1);
+}
+
+/* no request came for a hold time */
+static void ufs_perf_hold_timer(struct timer_list *t)
+{
+	struct ufs_perf_control *perf = from_timer(perf, t, hold_timer);
+	u64 now = ktime_get_ns();
+	enum ufs_perf_level target;
+	unsigned long flags;
+	bool boosted;
+	u64 hold;
+
+	spin_lock_irqsave(&perf->lock, flags);
+	target = ufs_perf_predict_level(perf,
+				max(perf->iat_ns, now - perf->last_issue_ns),
+				atomic_read(&perf->inflight));
+	ufs_perf_budget_cap(perf, &target, now);
+	if (target < perf->target_level)
+		ufs_perf_set_target(perf, target);
+
+	boosted = perf->target_level != UFS_PERF_LEVEL_NONE;
+	hold = ufs_perf_hold_ns(perf);
+	spin_unlock_irqrestore(&perf->lock, flags);
+
+	if (boosted)
+		mod_timer(&perf->hold_timer,
+			  jiffies + nsecs_to_jiffies(hold) + 1);
+}
+
+static int ufs_perf_stat_show(struct seq_file *s, void *unused)
+{
+	struct ufs_perf_control *perf = s->private;
+	u64 level_time_ns[UFS_PERF_LEVEL_MAX];
+	u32 level_cnt[UFS_PERF_LEVEL_MAX];
+	enum ufs_perf_level level;
+	u32 read_ratio, budget_cap_cnt;
+	unsigned long flags;
+	u64 iat_ns;
+	int i;
+
+	spin_lock_irqsave(&perf->lock, flags);
+	memcpy(level_time_ns, perf->level_time_ns, sizeof(level_time_ns));
+	memcpy(level_cnt, perf->level_cnt, sizeof(level_cnt));
+	level = perf->level;
+	level_time_ns[level] += ktime_get_ns() - perf->level_since_ns;
+	iat_ns = perf->iat_ns;
+	read_ratio = perf->read_ratio;
+	budget_cap_cnt = perf->budget_cap_cnt;
+	spin_unlock_irqrestore(&perf->lock, flags);
+
+	for (i = 0; i < UFS_PERF_LEVEL_MAX; i++)
+		seq_printf(s, "level%d: %llu ms, %u times\n", i,
+			   div_u64(level_time_ns[i], NSEC_PER_MSEC),
+			   level_cnt[i]);
+	seq_printf(s, "level: %d\n", level);
+	seq_printf(s, "iops: %llu\n", div64_u64(NSEC_PER_SEC, iat_ns ?: 1));
+	seq_printf(s, "read: %u%%\n", read_ratio * 100 / UFS_PERF_RATIO_ONE);
+	seq_printf(s, "depth: %d\n", atomic_read(&perf->inflight));
+	seq_printf(s, "budget_cap: %u\n", budget_cap_cnt);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ufs_perf_stat);
+
 /* EXTERNAL FUNCTIONS */
 
 static void ufs_perf_reset_timer(struct timer_list *t)
@@ -184,6 +417,17 @@ void ufs_perf_reset(void *data, bool boot)
 	if (!perf || IS_ERR(perf->handler))
 		return;
 
+	/*
+	 * The predictive mode drops boosts with its own hold timer. Nothing
+	 * is outstanding at a check point, so resync the depth in case a
+	 * completion was missed, e.g. for a request cleared by error handling.
+	 */
+	if (perf->predict) {
+		if (!boot)
+			atomic_set(&perf->inflight, 0);
+		return;
+	}
+
 	spin_lock_irqsave(&perf->lock, flags);
 	perf->ctrl_flag_in_transit = ctrl_flag;
 	perf->is_held = false;
@@ -217,6 +461,11 @@ void ufs_perf_update_stat(void *data, unsigned int len, enum ufs_perf_op op)
 	is_big = (len >= perf->th_chunk_in_kb * 1024);
 	trace_ufs_exynos_perf_issue((int)is_big, (int)op, (int)len);
 
+	if (perf->predict) {
+		ufs_perf_predict(perf, op);
+		return;
+	}
+
 	/* Once triggered, lock state is hold right before idle */
 	if (perf->is_held)
 		return;
@@ -259,6 +508,17 @@ void ufs_perf_update_stat(void *data, unsigned int len, enum ufs_perf_op op)
 	ufs_perf_cp_and_trg(perf, is_big, is_cp_time, time, ctrl_flag);
 }
 
+/* completion of a request passed to ufs_perf_update_stat() */
+void ufs_perf_update_compl(void *data)
+{
+	struct ufs_perf_control *perf = (struct ufs_perf_control *)data;
+
+	if (!perf || IS_ERR(perf->handler) || !perf->predict)
+		return;
+
+	atomic_dec_if_positive(&perf->inflight);
+}
+
 void ufs_perf_populate_dt(void *data, struct device_node *np)
 {
 	struct ufs_perf_control *perf = (struct ufs_perf_control *)data;
@@ -308,11 +568,55 @@ void ufs_perf_populate_dt(void *data, struct device_node *np)
 	if (of_property_read_u32(np, "perf-reset-delay-in-ms",
 				 &perf->th_reset_in_ms))
 		perf->th_reset_in_ms = 30;
+
+	/* Predictive mode, ufs_perf_update_compl() must be called */
+	perf->predict = of_property_read_bool(np, "perf-predict");
+
+	if (of_property_read_u32(np, "perf-iops-l", &perf->th_iops_l))
+		perf->th_iops_l = 2000;
+
+	if (of_property_read_u32(np, "perf-iops-h", &perf->th_iops_h))
+		perf->th_iops_h = 8000;
+
+	if (of_property_read_u32(np, "perf-depth-l", &perf->th_depth_l))
+		perf->th_depth_l = 4;
+
+	if (of_property_read_u32(np, "perf-depth-h", &perf->th_depth_h))
+		perf->th_depth_h = 16;
+
+	if (of_property_read_u32(np, "perf-read-pct", &perf->th_read_pct))
+		perf->th_read_pct = 70;
+
+	if (of_property_read_u32(np, "perf-hold-min-in-ms",
+				 &perf->th_hold_min_in_ms))
+		perf->th_hold_min_in_ms = 10;
+
+	if (of_property_read_u32(np, "perf-hold-max-in-ms",
+				 &perf->th_hold_max_in_ms))
+		perf->th_hold_max_in_ms = 200;
+
+	/* Default, at most 2 seconds of CPU boost every 10 seconds */
+	if (of_property_read_u32(np, "perf-budget-in-ms",
+				 &perf->budget_in_ms))
+		perf->budget_in_ms = 2000;
+
+	if (of_property_read_u32(np, "perf-budget-period-in-ms",
+				 &perf->budget_period_in_ms))
+		perf->budget_period_in_ms = 10000;
+}
+
+static void ufs_perf_remove_pm_qos(struct ufs_perf_control *perf)
+{
+	exynos_pm_qos_remove_request(&perf->pm_qos_int);
+	exynos_pm_qos_remove_request(&perf->pm_qos_mif);
+	exynos_pm_qos_remove_request(&perf->pm_qos_cluster1);
+	exynos_pm_qos_remove_request(&perf->pm_qos_cluster0);
 }
 
 bool ufs_perf_init(void **data, struct device *dev)
 {
 	struct ufs_perf_control *perf;
+	char name[32];
 	bool ret = false;
 
 	/* perf and perf->handler is used to check using performance mode */
@@ -323,19 +627,33 @@ bool ufs_perf_init(void **data, struct device *dev)
 	perf = (struct ufs_perf_control *)(*data);
 
 	spin_lock_init(&perf->lock);
+	atomic_set(&perf->inflight, 0);
+	perf->iat_ns = NSEC_PER_SEC;
+	perf->level_since_ns = ktime_get_ns();
+	perf->budget_start_ns = perf->level_since_ns;
+
+	exynos_pm_qos_add_request(&perf->pm_qos_int,
+				  PM_QOS_DEVICE_THROUGHPUT, 0);
+	exynos_pm_qos_add_request(&perf->pm_qos_mif,
+				  PM_QOS_BUS_THROUGHPUT, 0);
+	exynos_pm_qos_add_request(&perf->pm_qos_cluster0,
+				  PM_QOS_CLUSTER0_FREQ_MIN, 0);
+	exynos_pm_qos_add_request(&perf->pm_qos_cluster1,
+				  PM_QOS_CLUSTER1_FREQ_MIN, 0);
 
 	perf->handler = kthread_run(ufs_perf_handler, perf,
 				    "ufs_perf_%d", 0);
-	if (IS_ERR(perf->handler))
+	if (IS_ERR(perf->handler)) {
+		ufs_perf_remove_pm_qos(perf);
 		goto out;
+	}
 
 	timer_setup(&perf->reset_timer, ufs_perf_reset_timer, 0);
-#ifdef PM_QOS_DEVICE_THROUGHPUT
-	pm_qos_add_request(&perf->pm_qos_int, PM_QOS_DEVICE_THROUGHPUT, 0);
-	pm_qos_add_request(&perf->pm_qos_mif, PM_QOS_BUS_THROUGHPUT, 0);
-	pm_qos_add_request(&perf->pm_qos_cluster0, PM_QOS_CLUSTER0_FREQ_MIN, 0);
-	pm_qos_add_request(&perf->pm_qos_cluster1, PM_QOS_CLUSTER1_FREQ_MIN, 0);
-#endif
+	timer_setup(&perf->hold_timer, ufs_perf_hold_timer, 0);
+	snprintf(name, sizeof(name), "ufs_perf-%s", dev_name(dev));
+	perf->debugfs = debugfs_create_dir(name, NULL);
+	debugfs_create_file("stat", 0444, perf->debugfs, perf,
+			    &ufs_perf_stat_fops);
 
 	ret = true;
 out:
@@ -347,18 +665,13 @@ void ufs_perf_exit(void *data)
 	struct ufs_perf_control *perf = (struct ufs_perf_control *)data;
 
 	if (perf && !IS_ERR(perf->handler)) {
-#ifdef PM_QOS_DEVICE_THROUGHPUT
-		pm_qos_remove_request(&perf->pm_qos_int);
-		pm_qos_remove_request(&perf->pm_qos_mif);
-		pm_qos_remove_request(&perf->pm_qos_cluster1);
-		pm_qos_remove_request(&perf->pm_qos_cluster0);
-#endif
+		debugfs_remove_recursive(perf->debugfs);
+		del_timer_sync(&perf->reset_timer);
+		del_timer_sync(&perf->hold_timer);
 		perf->will_stop = true;
 		complete(&perf->completion);
 		kthread_stop(perf->handler);
+		/* nothing can update the requests anymore */
+		ufs_perf_remove_pm_qos(perf);
 	}
 }
-MODULE_AUTHOR("Kiwoong Kim <kwmad.kim@samsung.com>");
-MODULE_DESCRIPTION("Exynos UFS performance booster");
-MODULE_LICENSE("GPL");
-MODULE_VERSION("0.1");
@@ -15,11 +15,13 @@
 #define _UFS_PERF_H_
 
 #include <linux/types.h>
-#include <linux/pm_qos.h>
+#include <soc/google/exynos_pm_qos.h>
 #include <linux/kthread.h>
 #include <linux/completion.h>
 #include <linux/spinlock.h>
 #include <linux/sched/clock.h>
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
 
 enum ufs_perf_op {
 	UFS_PERF_OP_NONE = 0,
@@ -32,6 +34,14 @@ enum ufs_perf_ctrl {
 	UFS_PERF_CTRL_NONE = 0,	/* Not used to run handler */
 	UFS_PERF_CTRL_LOCK,
 	UFS_PERF_CTRL_RELEASE,
+	UFS_PERF_CTRL_LEVEL,	/* apply target_level, predictive mode */
+};
+
+enum ufs_perf_level {
+	UFS_PERF_LEVEL_NONE = 0,
+	UFS_PERF_LEVEL_IO,	/* INT and MIF */
+	UFS_PERF_LEVEL_FULL,	/* INT, MIF and CPU clusters */
+	UFS_PERF_LEVEL_MAX,
 };
 
 struct ufs_perf_control {
@@ -43,14 +53,26 @@ struct ufs_perf_control {
 	u32 th_period_in_ms_l;	/* period for little chunk */
 	u32 th_reset_in_ms;	/* timeout for reset */
 
-	struct pm_qos_request	pm_qos_int;
-	s32			pm_qos_int_value;
-	struct pm_qos_request	pm_qos_mif;
-	s32			pm_qos_mif_value;
-	struct pm_qos_request	pm_qos_cluster1;
-	s32			pm_qos_cluster1_value;
-	struct pm_qos_request	pm_qos_cluster0;
-	s32			pm_qos_cluster0_value;
+	/* from device tree, predictive mode */
+	bool predict;
+	u32 th_iops_l;		/* arrival rate for UFS_PERF_LEVEL_IO */
+	u32 th_iops_h;		/* arrival rate for UFS_PERF_LEVEL_FULL */
+	u32 th_depth_l;		/* outstanding for UFS_PERF_LEVEL_IO */
+	u32 th_depth_h;		/* outstanding for UFS_PERF_LEVEL_FULL */
+	u32 th_read_pct;	/* read share to get FULL by rate */
+	u32 th_hold_min_in_ms;
+	u32 th_hold_max_in_ms;
+	u32 budget_in_ms;	/* time at FULL allowed per budget period */
+	u32 budget_period_in_ms;
+
+	struct exynos_pm_qos_request	pm_qos_int;
+	s32				pm_qos_int_value;
+	struct exynos_pm_qos_request	pm_qos_mif;
+	s32				pm_qos_mif_value;
+	struct exynos_pm_qos_request	pm_qos_cluster1;
+	s32				pm_qos_cluster1_value;
+	struct exynos_pm_qos_request	pm_qos_cluster0;
+	s32				pm_qos_cluster0_value;
 
 	/* spin lock */
 	spinlock_t lock;
@@ -73,11 +95,29 @@ struct ufs_perf_control {
 	bool is_active;			/* handler status */
 	struct completion completion;	/* wake-up source */
 	struct timer_list reset_timer;	/* stat reset timer */
+
+	/* Predictive mode, protected by lock */
+	u64 last_issue_ns;
+	u64 iat_ns;			/* average inter-arrival time */
+	u32 read_ratio;			/* average read share, in 1/1024 */
+	atomic_t inflight;
+	enum ufs_perf_level level;	/* applied by handler */
+	enum ufs_perf_level target_level;
+	u64 level_since_ns;
+	u64 level_time_ns[UFS_PERF_LEVEL_MAX];
+	u32 level_cnt[UFS_PERF_LEVEL_MAX];
+	u64 budget_start_ns;
+	u64 drop_since_ns;		/* target above prediction since */
+	u64 budget_used_ns;		/* at FULL in the current period */
+	u32 budget_cap_cnt;
+	struct timer_list hold_timer;	/* level drop timer */
+	struct dentry *debugfs;
 };
 
 /* EXTERNAL FUNCTIONS */
 void ufs_perf_reset(void *data, bool boot);
 void ufs_perf_update_stat(void *data, unsigned int len, enum ufs_perf_op op);
+void ufs_perf_update_compl(void *data);
 void ufs_perf_populate_dt(void *data, struct device_node *np);
 bool ufs_perf_init(void **data, struct device *dev);
 void ufs_perf_exit(void *data);
@@ -26,6 +26,7 @@
 #include <linux/spinlock.h>
 #include <soc/google/exynos-pmu-if.h>
 #include <soc/google/exynos-cpupm.h>
+#include <trace/hooks/ufshcd.h>
 
 #define IS_C_STATE_ON(h) ((h)->c_state == C_ON)
 #define PRINT_STATES(h)						\
@@ -462,6 +463,88 @@ static void exynos_ufs_set_features(struct ufs_hba *hba)
 				UFSHCI_QUIRK_SKIP_RESET_INTR_AGGR);
 }
 
+static void exynos_ufs_perf_send_command(void *data, struct ufs_hba *hba,
+					 struct ufshcd_lrb *lrbp)
+{
+	struct exynos_ufs *ufs = to_exynos_ufs(hba);
+	struct scsi_cmnd *cmd = lrbp->cmd;
+	enum ufs_perf_op op;
+
+	if (!cmd)
+		return;
+
+	if (cmd->sc_data_direction == DMA_FROM_DEVICE)
+		op = UFS_PERF_OP_R;
+	else if (cmd->sc_data_direction == DMA_TO_DEVICE)
+		op = UFS_PERF_OP_W;
+	else
+		op = UFS_PERF_OP_NONE;
+
+	ufs_perf_update_stat(ufs->perf, scsi_bufflen(cmd), op);
+}
+
+static void exynos_ufs_perf_compl_command(void *data, struct ufs_hba *hba,
+					  struct ufshcd_lrb *lrbp)
+{
+	struct exynos_ufs *ufs = to_exynos_ufs(hba);
+
+	/* only SCSI commands are passed to ufs_perf_update_stat() */
+	if (lrbp->cmd)
+		ufs_perf_update_compl(ufs->perf);
+}
+
+static int exynos_ufs_perf_init(struct exynos_ufs *ufs)
+{
+	struct device_node *np;
+	int ret;
+
+	/* performance mode is optional, only with a ufs-perf node */
+	np = of_get_child_by_name(ufs->dev->of_node, "ufs-perf");
+	if (!np)
+		return 0;
+
+	if (!ufs_perf_init(&ufs->perf, ufs->dev)) {
+		ufs->perf = NULL;
+		of_node_put(np);
+		return 0;
+	}
+	ufs_perf_populate_dt(ufs->perf, np);
+	of_node_put(np);
+
+	ret = register_trace_android_vh_ufs_send_command(
+				exynos_ufs_perf_send_command, NULL);
+	if (ret)
+		goto err_perf;
+
+	ret = register_trace_android_vh_ufs_compl_command(
+				exynos_ufs_perf_compl_command, NULL);
+	if (ret)
+		goto err_send;
+	return 0;
+
+err_send:
+	unregister_trace_android_vh_ufs_send_command(
+				exynos_ufs_perf_send_command, NULL);
+	tracepoint_synchronize_unregister();
+err_perf:
+	ufs_perf_exit(ufs->perf);
+	ufs->perf = NULL;
+	return ret;
+}
+
+static void exynos_ufs_perf_exit(struct exynos_ufs *ufs)
+{
+	if (!ufs->perf)
+		return;
+
+	unregister_trace_android_vh_ufs_compl_command(
+				exynos_ufs_perf_compl_command, NULL);
+	unregister_trace_android_vh_ufs_send_command(
+				exynos_ufs_perf_send_command, NULL);
+	tracepoint_synchronize_unregister();
+	ufs_perf_exit(ufs->perf);
+}
+
 /*
  * Exynos-specific callback functions
  */
@@ -504,6 +587,12 @@ static int exynos_ufs_init(struct ufs_hba *hba)
 
 	pixel_init_io_stats(hba);
 
+	pixel_init_lat_hist(hba);
+
+	ret = exynos_ufs_perf_init(ufs);
+	if (ret)
+		return ret;
+
 	// disable hpb1.0 support
 	hba->ufshpb_dev.hpb_disabled = true;
 
@@ -852,6 +941,9 @@ static void exynos_ufs_hibern8_notify(struct ufs_hba *hba,
 			ufs->h_state_prev = ufs->h_state;
 			ufs->h_state = H_HIBERN8;
 
+			/* idle, check point of the perf stat */
+			ufs_perf_reset(ufs->perf, false);
+
 			pixel_ufs_record_hibern8(hba, 1);
 		}
 	} else {
@@ -1550,6 +1642,8 @@ static int exynos_ufs_remove(struct platform_device *pdev)
 	disable_irq(hba->irq);
 	ufshcd_remove(hba);
 
+	exynos_ufs_perf_exit(ufs);
+
 	exynos_pm_qos_remove_request(&ufs->pm_qos_int);
 
 	exynos_ufs_ctrl_phy_pwr(ufs, false);
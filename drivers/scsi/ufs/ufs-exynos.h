@@ -17,6 +17,7 @@
 #include "ufs-vs-regs.h"
 #include "ufs-cal-if.h"
 #include "ufs-pixel.h"
+#include "ufs-exynos-perf.h"
 
 #define UFS_VER_0004	4
 #define UFS_VER_0005	5
@@ -162,6 +163,10 @@ struct exynos_ufs {
 	u64 slowio_min_us;
 	u64 slowio[PIXEL_SLOWIO_OP_MAX][PIXEL_SLOWIO_SYS_MAX];
 
+	/* pixel ufs latency histograms */
+	struct pixel_lat_hist __percpu *lat_hist;
+	u8 lat_hist_qd[PIXEL_LAT_HIST_MAX_TAGS];
+
 	/* pixel ufs power related statistics */
 	struct pixel_power_stats power_stats;
 
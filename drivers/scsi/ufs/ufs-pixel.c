@@ -342,6 +342,58 @@ static void pixel_ufs_update_io_stats(struct ufs_hba *hba,
 	record_ufs_stats(hba);
 }
 
+static unsigned int pixel_ufs_lat_hist_bucket(u64 us)
+{
+	unsigned int shift, idx;
+
+	if (us < (2 << PIXEL_LAT_HIST_SUB_BITS))
+		return us;
+
+	shift = fls64(us) - PIXEL_LAT_HIST_SUB_BITS - 1;
+	idx = (shift << PIXEL_LAT_HIST_SUB_BITS) + (us >> shift);
+	return min_t(unsigned int, idx, PIXEL_LAT_HIST_BUCKETS - 1);
+}
+
+static void pixel_ufs_lat_hist_issue(struct ufs_hba *hba,
+		struct ufshcd_lrb *lrbp)
+{
+	struct exynos_ufs *ufs = to_exynos_ufs(hba);
+	unsigned int qd;
+
+	if (!ufs->lat_hist || lrbp->task_tag >= PIXEL_LAT_HIST_MAX_TAGS)
+		return;
+
+	/* the doorbell of this request is not rung yet */
+	qd = hweight_long(READ_ONCE(hba->outstanding_reqs)) + 1;
+	qd = min_t(unsigned int, qd, PIXEL_LAT_HIST_MAX_TAGS);
+	ufs->lat_hist_qd[lrbp->task_tag] = fls(qd - 1);
+}
+
+/* lock-free: completions only touch the histograms of the local cpu */
+static void pixel_ufs_update_lat_hist(struct ufs_hba *hba,
+		struct ufshcd_lrb *lrbp)
+{
+	struct exynos_ufs *ufs = to_exynos_ufs(hba);
+	enum pixel_slowio_optype optype;
+	unsigned int idx;
+
+	if (!ufs->lat_hist || !lrbp->cmd ||
+	    lrbp->task_tag >= PIXEL_LAT_HIST_MAX_TAGS)
+		return;
+
+	optype = pixel_ufs_get_slowio_optype((u8)(*lrbp->cmd->cmnd));
+	if (optype >= PIXEL_SLOWIO_OP_MAX)
+		return;
+
+	idx = pixel_ufs_lat_hist_bucket((u64)ktime_us_delta(
+			lrbp->compl_time_stamp, lrbp->issue_time_stamp));
+
+	this_cpu_inc(ufs->lat_hist->opcode[optype][idx]);
+	if (lrbp->lun < PIXEL_LAT_HIST_LUNS)
+		this_cpu_inc(ufs->lat_hist->lun[lrbp->lun][idx]);
+	this_cpu_inc(ufs->lat_hist->qd[ufs->lat_hist_qd[lrbp->task_tag]][idx]);
+}
+
 void pixel_ufs_record_hibern8(struct ufs_hba *hba, bool is_enter_h8)
 {
 	struct exynos_ufs *ufs = to_exynos_ufs(hba);
@@ -692,6 +744,7 @@ static void pixel_ufs_send_command(void *data, struct ufs_hba *hba,
 					struct ufshcd_lrb *lrbp)
 {
 	pixel_ufs_update_io_stats(hba, lrbp, true);
+	pixel_ufs_lat_hist_issue(hba, lrbp);
 	pixel_ufs_trace_upiu_cmd(hba, lrbp, true);
 }
 
@@ -721,6 +774,7 @@ static void pixel_ufs_compl_command(void *data, struct ufs_hba *hba,
 
 	pixel_ufs_update_io_stats(hba, lrbp, false);
 	pixel_ufs_update_req_stats(hba, lrbp);
+	pixel_ufs_update_lat_hist(hba, lrbp);
 	pixel_ufs_trace_upiu_cmd(hba, lrbp, false);
 
 	if (!lrbp->cmd)
@@ -1500,6 +1554,106 @@ static const struct attribute_group pixel_sysfs_io_stats_group = {
 	.attrs = ufs_sysfs_io_stats,
 };
 
+void pixel_init_lat_hist(struct ufs_hba *hba)
+{
+	struct exynos_ufs *ufs = to_exynos_ufs(hba);
+
+	ufs->lat_hist = alloc_percpu(struct pixel_lat_hist);
+	if (!ufs->lat_hist)
+		dev_err(hba->dev, "%s: failed on lat_hist alloc_percpu()\n",
+			__func__);
+}
+
+/*
+ * Sum a histogram array of struct pixel_lat_hist over all cpus. Readers may
+ * see a few counts of the running completions missing.
+ */
+static ssize_t pixel_ufs_lat_hist_read(struct ufs_hba *hba, size_t field,
+		size_t size, char *buf, loff_t off, size_t count)
+{
+	struct exynos_ufs *ufs = to_exynos_ufs(hba);
+	u64 *sum;
+	size_t i;
+	int cpu;
+
+	if (!ufs->lat_hist)
+		return -ENODEV;
+
+	sum = kzalloc(size, GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		u64 *h = (void *)per_cpu_ptr(ufs->lat_hist, cpu) + field;
+
+		for (i = 0; i < size / sizeof(u64); i++)
+			sum[i] += READ_ONCE(h[i]);
+	}
+	memcpy(buf, (void *)sum + off, count);
+	kfree(sum);
+
+	return count;
+}
+
+#define PIXEL_LAT_HIST_ATTR(_name)					\
+static ssize_t lat_hist_##_name##_read(struct file *file,		\
+		struct kobject *kobj, struct bin_attribute *attr,	\
+		char *buf, loff_t off, size_t count)			\
+{									\
+	struct ufs_hba *hba = dev_get_drvdata(kobj_to_dev(kobj));	\
+									\
+	return pixel_ufs_lat_hist_read(hba,				\
+			offsetof(struct pixel_lat_hist, _name),		\
+			attr->size, buf, off, count);			\
+}									\
+static struct bin_attribute bin_attr_lat_hist_##_name =		\
+	__BIN_ATTR(_name, 0444, lat_hist_##_name##_read, NULL,		\
+		   sizeof_field(struct pixel_lat_hist, _name))
+
+static ssize_t reset_lat_hist_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	return 0;
+}
+
+static ssize_t reset_lat_hist_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct exynos_ufs *ufs = to_exynos_ufs(hba);
+	int cpu;
+
+	if (ufs->lat_hist)
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(ufs->lat_hist, cpu), 0,
+				sizeof(struct pixel_lat_hist));
+
+	return count;
+}
+
+PIXEL_LAT_HIST_ATTR(opcode);
+PIXEL_LAT_HIST_ATTR(lun);
+PIXEL_LAT_HIST_ATTR(qd);
+static DEVICE_ATTR_RW(reset_lat_hist);
+
+static struct attribute *ufs_sysfs_lat_hist[] = {
+	&dev_attr_reset_lat_hist.attr,
+	NULL,
+};
+
+static struct bin_attribute *ufs_sysfs_lat_hist_bin[] = {
+	&bin_attr_lat_hist_opcode,
+	&bin_attr_lat_hist_lun,
+	&bin_attr_lat_hist_qd,
+	NULL,
+};
+
+static const struct attribute_group pixel_sysfs_lat_hist_group = {
+	.name = "lat_hist",
+	.attrs = ufs_sysfs_lat_hist,
+	.bin_attrs = ufs_sysfs_lat_hist_bin,
+};
+
 #define PIXEL_ERR_STATS_ATTR(_name, _err_name, _type)			\
 static ssize_t _name##_show(struct device *dev,				\
 		struct device_attribute *attr, char *buf)		\
@@ -1772,6 +1926,7 @@ static const struct attribute_group *pixel_ufs_sysfs_groups[] = {
 	&pixel_sysfs_group,
 	&pixel_sysfs_req_stats_group,
 	&pixel_sysfs_io_stats_group,
+	&pixel_sysfs_lat_hist_group,
 	&pixel_sysfs_err_stats_group,
 	&pixel_sysfs_ufs_stats_group,
 	&pixel_sysfs_hc_register_ifc_group,
@@ -197,6 +197,39 @@ struct slowio_attr {
 
 extern void pixel_init_slowio(struct ufs_hba *hba);
 
+/*
+ * Log-linear latency histogram buckets, in usec: values below
+ * 2 << PIXEL_LAT_HIST_SUB_BITS have a bucket each, then each power of two
+ * is split in 1 << PIXEL_LAT_HIST_SUB_BITS buckets, i.e. the lower bound of
+ * a bucket is accurate to 12.5%. The last bucket also counts everything
+ * above 2^25 usec (33.5 seconds).
+ */
+#define PIXEL_LAT_HIST_SUB_BITS		3
+#define PIXEL_LAT_HIST_BUCKETS		184
+/* general LUNs; well known LUNs are not accounted */
+#define PIXEL_LAT_HIST_LUNS		8
+/* queue depth buckets at issue: 1, 2, 3-4, 5-8, 9-16, 17-32 */
+#define PIXEL_LAT_HIST_QD_BUCKETS	6
+#define PIXEL_LAT_HIST_MAX_TAGS		32
+
+/**
+ * struct pixel_lat_hist - per-cpu completion latency histograms
+ * @opcode: by enum pixel_slowio_optype
+ * @lun: by LUN
+ * @qd: by number of outstanding requests when the request was issued
+ *
+ * Only the commands which have an enum pixel_slowio_optype are accounted.
+ * Each of @opcode, @lun and @qd is exported as is by a binary sysfs file
+ * in the lat_hist group, summed over all cpus.
+ */
+struct pixel_lat_hist {
+	u64 opcode[PIXEL_SLOWIO_OP_MAX][PIXEL_LAT_HIST_BUCKETS];
+	u64 lun[PIXEL_LAT_HIST_LUNS][PIXEL_LAT_HIST_BUCKETS];
+	u64 qd[PIXEL_LAT_HIST_QD_BUCKETS][PIXEL_LAT_HIST_BUCKETS];
+};
+
+extern void pixel_init_lat_hist(struct ufs_hba *hba);
+
 /* UFS err_stats type */
 enum pixel_err_systype {
 	PIXEL_ERR_COUNT = 0,
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * KUnit tests of the UFS HPB heat tracker, run against a fake HPB LU that
+ * loads and drops maps synchronously.
+ *
+ * Copyright 2026 Google LLC
+ */
+
+#include <kunit/test.h>
+#include <linux/bitmap.h>
+
+#include "ufshpb-heat.h"
+
+#define FAKE_RGNS		8
+#define FAKE_SRGNS_PER_RGN	4
+#define FAKE_SRGNS		(FAKE_RGNS * FAKE_SRGNS_PER_RGN)
+
+struct fake_hpb_lu {
+	struct ufshpb_heat heat;
+	DECLARE_BITMAP(valid, FAKE_SRGNS);
+	unsigned int nr_activate;
+	unsigned int nr_inactivate;
+};
+
+static void fake_activate(void *priv, int rgn_idx, int srgn_idx)
+{
+	struct fake_hpb_lu *lu = priv;
+
+	set_bit(rgn_idx * FAKE_SRGNS_PER_RGN + srgn_idx, lu->valid);
+	lu->nr_activate++;
+}
+
+/* like __ufshpb_evict_region(), drop all maps and tell the tracker */
+static void fake_evict(struct fake_hpb_lu *lu, int rgn_idx)
+{
+	bitmap_clear(lu->valid, rgn_idx * FAKE_SRGNS_PER_RGN,
+		     FAKE_SRGNS_PER_RGN);
+	ufshpb_heat_evicted(&lu->heat, rgn_idx);
+}
+
+static void fake_inactivate(void *priv, int rgn_idx)
+{
+	struct fake_hpb_lu *lu = priv;
+
+	fake_evict(lu, rgn_idx);
+	lu->nr_inactivate++;
+}
+
+static const struct ufshpb_heat_ops fake_heat_ops = {
+	.activate = fake_activate,
+	.inactivate = fake_inactivate,
+};
+
+static bool fake_valid(struct fake_hpb_lu *lu, int rgn_idx, int srgn_idx)
+{
+	return test_bit(rgn_idx * FAKE_SRGNS_PER_RGN + srgn_idx, lu->valid);
+}
+
+static void fake_read(struct fake_hpb_lu *lu, int rgn_idx, int srgn_idx,
+		      unsigned int n)
+{
+	while (n--)
+		ufshpb_heat_read(&lu->heat, rgn_idx, srgn_idx);
+}
+
+static int ufshpb_heat_test_init(struct kunit *test)
+{
+	struct fake_hpb_lu *lu;
+
+	lu = kunit_kzalloc(test, sizeof(*lu), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, lu);
+	KUNIT_ASSERT_EQ(test, 0, ufshpb_heat_init(&lu->heat, FAKE_RGNS,
+						  FAKE_SRGNS_PER_RGN,
+						  &fake_heat_ops, lu));
+	ufshpb_heat_set_budget(&lu->heat, FAKE_SRGNS);
+	test->priv = lu;
+	return 0;
+}
+
+static void ufshpb_heat_test_exit(struct kunit *test)
+{
+	struct fake_hpb_lu *lu = test->priv;
+
+	ufshpb_heat_destroy(&lu->heat);
+}
+
+static void ufshpb_heat_test_disabled(struct kunit *test)
+{
+	struct fake_hpb_lu *lu = test->priv;
+
+	ufshpb_heat_set_budget(&lu->heat, 0);
+	fake_read(lu, 0, 0, 10 * HPB_HEAT_HOT_THLD);
+	ufshpb_heat_tick(&lu->heat);
+	KUNIT_EXPECT_EQ(test, 0U, lu->nr_activate);
+}
+
+static void ufshpb_heat_test_load_hot(struct kunit *test)
+{
+	struct fake_hpb_lu *lu = test->priv;
+
+	fake_read(lu, 1, 2, HPB_HEAT_HOT_THLD - 1);
+	KUNIT_EXPECT_FALSE(test, fake_valid(lu, 1, 2));
+
+	fake_read(lu, 1, 2, 1);
+	KUNIT_EXPECT_TRUE(test, fake_valid(lu, 1, 2));
+	KUNIT_EXPECT_EQ(test, 1U, lu->heat.nr_loaded);
+
+	/* further reads and ticks don't load the map again */
+	fake_read(lu, 1, 2, HPB_HEAT_HOT_THLD);
+	ufshpb_heat_tick(&lu->heat);
+	KUNIT_EXPECT_EQ(test, 1U, lu->nr_activate);
+}
+
+static void ufshpb_heat_test_budget(struct kunit *test)
+{
+	struct fake_hpb_lu *lu = test->priv;
+	int rgn;
+
+	ufshpb_heat_set_budget(&lu->heat, 2);
+	for (rgn = 0; rgn < 4; rgn++)
+		fake_read(lu, rgn, 0, HPB_HEAT_HOT_THLD);
+	ufshpb_heat_tick(&lu->heat);
+
+	KUNIT_EXPECT_EQ(test, 2U, lu->heat.nr_loaded);
+	KUNIT_EXPECT_EQ(test, 2, bitmap_weight(lu->valid, FAKE_SRGNS));
+}
+
+static void ufshpb_heat_test_evict_cold(struct kunit *test)
+{
+	struct fake_hpb_lu *lu = test->priv;
+	int i;
+
+	fake_read(lu, 3, 1, HPB_HEAT_HOT_THLD);
+	fake_read(lu, 5, 0, HPB_HEAT_HOT_THLD);
+	KUNIT_ASSERT_EQ(test, 2U, lu->heat.nr_loaded);
+
+	/* region 5 keeps being read while region 3 cools down */
+	for (i = 0; i < 64 && fake_valid(lu, 3, 1); i++) {
+		fake_read(lu, 5, 0, 1);
+		ufshpb_heat_tick(&lu->heat);
+	}
+
+	KUNIT_EXPECT_FALSE(test, fake_valid(lu, 3, 1));
+	KUNIT_EXPECT_TRUE(test, fake_valid(lu, 5, 0));
+	KUNIT_EXPECT_EQ(test, 1U, lu->nr_inactivate);
+	KUNIT_EXPECT_EQ(test, 1U, lu->heat.nr_loaded);
+}
+
+static void ufshpb_heat_test_replace(struct kunit *test)
+{
+	struct fake_hpb_lu *lu = test->priv;
+
+	ufshpb_heat_set_budget(&lu->heat, 1);
+	fake_read(lu, 0, 0, HPB_HEAT_HOT_THLD);
+	KUNIT_ASSERT_TRUE(test, fake_valid(lu, 0, 0));
+
+	/* much hotter than region 0, but the budget is full */
+	fake_read(lu, 6, 3, 4 * HPB_HEAT_HOT_THLD);
+	KUNIT_EXPECT_FALSE(test, fake_valid(lu, 6, 3));
+
+	ufshpb_heat_tick(&lu->heat);
+	KUNIT_EXPECT_FALSE(test, fake_valid(lu, 0, 0));
+	KUNIT_EXPECT_TRUE(test, fake_valid(lu, 6, 3));
+	KUNIT_EXPECT_EQ(test, 1U, lu->heat.nr_loaded);
+}
+
+static void ufshpb_heat_test_shrink_budget(struct kunit *test)
+{
+	struct fake_hpb_lu *lu = test->priv;
+
+	fake_read(lu, 2, 0, HPB_HEAT_HOT_THLD);
+	fake_read(lu, 4, 0, 2 * HPB_HEAT_HOT_THLD);
+	KUNIT_ASSERT_EQ(test, 2U, lu->heat.nr_loaded);
+
+	ufshpb_heat_set_budget(&lu->heat, 1);
+	ufshpb_heat_tick(&lu->heat);
+
+	/* the colder region goes first */
+	KUNIT_EXPECT_FALSE(test, fake_valid(lu, 2, 0));
+	KUNIT_EXPECT_TRUE(test, fake_valid(lu, 4, 0));
+	KUNIT_EXPECT_EQ(test, 1U, lu->heat.nr_loaded);
+}
+
+static void ufshpb_heat_test_evicted_by_lu(struct kunit *test)
+{
+	struct fake_hpb_lu *lu = test->priv;
+
+	fake_read(lu, 7, 3, HPB_HEAT_HOT_THLD);
+	KUNIT_ASSERT_TRUE(test, fake_valid(lu, 7, 3));
+
+	/* e.g. an inactivation hint from the device */
+	fake_evict(lu, 7);
+	KUNIT_EXPECT_EQ(test, 0U, lu->heat.nr_loaded);
+
+	/* the subregion is still hot, so the next read loads it again */
+	fake_read(lu, 7, 3, 1);
+	KUNIT_EXPECT_TRUE(test, fake_valid(lu, 7, 3));
+	KUNIT_EXPECT_EQ(test, 2U, lu->nr_activate);
+}
+
+static struct kunit_case ufshpb_heat_test_cases[] = {
+	KUNIT_CASE(ufshpb_heat_test_disabled),
+	KUNIT_CASE(ufshpb_heat_test_load_hot),
+	KUNIT_CASE(ufshpb_heat_test_budget),
+	KUNIT_CASE(ufshpb_heat_test_evict_cold),
+	KUNIT_CASE(ufshpb_heat_test_replace),
+	KUNIT_CASE(ufshpb_heat_test_shrink_budget),
+	KUNIT_CASE(ufshpb_heat_test_evicted_by_lu),
+	{}
+};
+
+static struct kunit_suite ufshpb_heat_test_suite = {
+	.name = "ufshpb-heat",
+	.init = ufshpb_heat_test_init,
+	.exit = ufshpb_heat_test_exit,
+	.test_cases = ufshpb_heat_test_cases,
+};
+
+kunit_test_suite(ufshpb_heat_test_suite);
+
+MODULE_LICENSE("GPL");
@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Universal Flash Storage Host Performance Booster - access heat tracking
+ *
+ * In host control mode, the host decides which L2P maps are cached. The
+ * heat tracker keeps an exponentially decayed read count per subregion and
+ * loads the maps of subregions that turn hot, e.g. the working set of an
+ * application being launched, without waiting for the device or for the
+ * plain read counters of ufshpb.c. Regions that have cooled down are
+ * dropped again, and the number of maps loaded by the tracker is bounded
+ * by a memory budget.
+ *
+ * The tracker does not know about the UFS device: it only acts through
+ * struct ufshpb_heat_ops, so that it can be tested against a fake one.
+ *
+ * Copyright 2026 Google LLC
+ */
+
+#include <linux/bitmap.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+
+#include "ufshpb-heat.h"
+
+static u32 ufshpb_heat_idx(struct ufshpb_heat *heat, int rgn_idx,
+			   int srgn_idx)
+{
+	return rgn_idx * heat->srgns_per_rgn + srgn_idx;
+}
+
+int ufshpb_heat_init(struct ufshpb_heat *heat, u32 rgns, u32 srgns_per_rgn,
+		     const struct ufshpb_heat_ops *ops, void *priv)
+{
+	u32 srgns = rgns * srgns_per_rgn;
+
+	heat->heat = kvcalloc(srgns, sizeof(*heat->heat), GFP_KERNEL);
+	if (!heat->heat)
+		return -ENOMEM;
+
+	heat->loaded = bitmap_zalloc(srgns, GFP_KERNEL);
+	if (!heat->loaded) {
+		kvfree(heat->heat);
+		heat->heat = NULL;
+		return -ENOMEM;
+	}
+
+	heat->ops = ops;
+	heat->priv = priv;
+	heat->rgns = rgns;
+	heat->srgns_per_rgn = srgns_per_rgn;
+	heat->nr_loaded = 0;
+	heat->budget = 0;
+	heat->hot_thld = HPB_HEAT_HOT_THLD;
+	heat->cold_thld = HPB_HEAT_COLD_THLD;
+	heat->decay_shift = HPB_HEAT_DECAY_SHIFT;
+	spin_lock_init(&heat->lock);
+	return 0;
+}
+
+void ufshpb_heat_destroy(struct ufshpb_heat *heat)
+{
+	bitmap_free(heat->loaded);
+	heat->loaded = NULL;
+	kvfree(heat->heat);
+	heat->heat = NULL;
+}
+
+/*
+ * Set the maximum number of subregion maps loaded by the tracker. Maps
+ * beyond a lowered budget are dropped, coldest region first, by the
+ * following ticks.
+ */
+void ufshpb_heat_set_budget(struct ufshpb_heat *heat, u32 budget)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&heat->lock, flags);
+	WRITE_ONCE(heat->budget, budget);
+	spin_unlock_irqrestore(&heat->lock, flags);
+}
+
+/* Account a read of a subregion, and load its map if it just turned hot. */
+void ufshpb_heat_read(struct ufshpb_heat *heat, int rgn_idx, int srgn_idx)
+{
+	u32 idx = ufshpb_heat_idx(heat, rgn_idx, srgn_idx);
+	unsigned long flags;
+	u32 h;
+
+	if (!READ_ONCE(heat->budget))
+		return;
+
+	/* racing readers may lose an increment, which is fine for a heat */
+	h = min_t(u32, READ_ONCE(heat->heat[idx]) + HPB_HEAT_UNIT,
+		  HPB_HEAT_MAX);
+	WRITE_ONCE(heat->heat[idx], h);
+
+	if (h < (heat->hot_thld << HPB_HEAT_UNIT_SHIFT) ||
+	    test_bit(idx, heat->loaded))
+		return;
+
+	spin_lock_irqsave(&heat->lock, flags);
+	if (test_bit(idx, heat->loaded) || heat->nr_loaded >= heat->budget) {
+		spin_unlock_irqrestore(&heat->lock, flags);
+		return;
+	}
+	__set_bit(idx, heat->loaded);
+	heat->nr_loaded++;
+	spin_unlock_irqrestore(&heat->lock, flags);
+
+	heat->ops->activate(heat->priv, rgn_idx, srgn_idx);
+}
+
+static void __ufshpb_heat_evicted(struct ufshpb_heat *heat, int rgn_idx)
+{
+	u32 idx = ufshpb_heat_idx(heat, rgn_idx, 0);
+	u32 i;
+
+	for (i = 0; i < heat->srgns_per_rgn; i++)
+		if (__test_and_clear_bit(idx + i, heat->loaded))
+			heat->nr_loaded--;
+}
+
+/*
+ * Called when a region was dropped by the LU for any reason, so that its
+ * subregions can be loaded again once they are hot.
+ */
+void ufshpb_heat_evicted(struct ufshpb_heat *heat, int rgn_idx)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&heat->lock, flags);
+	__ufshpb_heat_evicted(heat, rgn_idx);
+	spin_unlock_irqrestore(&heat->lock, flags);
+}
+
+/*
+ * Decay the heat of all subregions, then:
+ * - drop the regions whose loaded maps are all colder than cold_thld,
+ * - drop the coldest region while over budget,
+ * - load the maps of subregions hotter than hot_thld while within budget,
+ * - once the budget is full, replace the coldest region by the hottest
+ *   unloaded subregion if that is more than twice as hot.
+ *
+ * At most HPB_HEAT_BATCH maps are loaded and regions dropped per tick.
+ * Must not be called concurrently for the same tracker.
+ */
+void ufshpb_heat_tick(struct ufshpb_heat *heat)
+{
+	u32 srgns = heat->rgns * heat->srgns_per_rgn;
+	u32 hot = heat->hot_thld << HPB_HEAT_UNIT_SHIFT;
+	u32 cold = heat->cold_thld << HPB_HEAT_UNIT_SHIFT;
+	u32 coldest = U32_MAX, coldest_heat = U32_MAX;
+	u32 hottest = U32_MAX, hottest_heat = 0;
+	u32 nr_load = 0, nr_evict = 0;
+	unsigned long flags;
+	u32 rgn, i;
+
+	spin_lock_irqsave(&heat->lock, flags);
+	if (!heat->budget && !heat->nr_loaded) {
+		spin_unlock_irqrestore(&heat->lock, flags);
+		return;
+	}
+
+	for (rgn = 0; rgn < heat->rgns; rgn++) {
+		u32 idx = ufshpb_heat_idx(heat, rgn, 0);
+		bool loaded = false;
+		u32 rgn_heat = 0;
+
+		for (i = idx; i < idx + heat->srgns_per_rgn; i++) {
+			u32 h = READ_ONCE(heat->heat[i]);
+
+			h -= DIV_ROUND_UP(h, 1 << heat->decay_shift);
+			WRITE_ONCE(heat->heat[i], h);
+			rgn_heat = max(rgn_heat, h);
+			loaded |= test_bit(i, heat->loaded);
+		}
+		if (!loaded)
+			continue;
+
+		if (rgn_heat < cold && nr_evict < HPB_HEAT_BATCH) {
+			__ufshpb_heat_evicted(heat, rgn);
+			heat->evict[nr_evict++] = rgn;
+		} else if (rgn_heat < coldest_heat) {
+			coldest = rgn;
+			coldest_heat = rgn_heat;
+		}
+	}
+
+	if (heat->nr_loaded > heat->budget && coldest != U32_MAX &&
+	    nr_evict < HPB_HEAT_BATCH) {
+		__ufshpb_heat_evicted(heat, coldest);
+		heat->evict[nr_evict++] = coldest;
+		coldest = U32_MAX;
+	}
+
+	for (i = 0; i < srgns; i++) {
+		u32 h = READ_ONCE(heat->heat[i]);
+
+		if (h < hot || test_bit(i, heat->loaded))
+			continue;
+
+		if (heat->nr_loaded < heat->budget &&
+		    nr_load < HPB_HEAT_BATCH) {
+			__set_bit(i, heat->loaded);
+			heat->nr_loaded++;
+			heat->load[nr_load++] = i;
+		} else if (h > hottest_heat) {
+			hottest = i;
+			hottest_heat = h;
+		}
+	}
+
+	if (hottest != U32_MAX && coldest != U32_MAX &&
+	    hottest_heat > 2 * coldest_heat &&
+	    hottest / heat->srgns_per_rgn != coldest &&
+	    nr_evict < HPB_HEAT_BATCH && nr_load < HPB_HEAT_BATCH) {
+		__ufshpb_heat_evicted(heat, coldest);
+		heat->evict[nr_evict++] = coldest;
+		__set_bit(hottest, heat->loaded);
+		heat->nr_loaded++;
+		heat->load[nr_load++] = hottest;
+	}
+	spin_unlock_irqrestore(&heat->lock, flags);
+
+	for (i = 0; i < nr_evict; i++)
+		heat->ops->inactivate(heat->priv, heat->evict[i]);
+	for (i = 0; i < nr_load; i++)
+		heat->ops->activate(heat->priv,
+				    heat->load[i] / heat->srgns_per_rgn,
+				    heat->load[i] % heat->srgns_per_rgn);
+}
+
+#if IS_MODULE(CONFIG_SCSI_UFS_HPB_KUNIT_TEST)
+EXPORT_SYMBOL_GPL(ufshpb_heat_init);
+EXPORT_SYMBOL_GPL(ufshpb_heat_destroy);
+EXPORT_SYMBOL_GPL(ufshpb_heat_set_budget);
+EXPORT_SYMBOL_GPL(ufshpb_heat_read);
+EXPORT_SYMBOL_GPL(ufshpb_heat_evicted);
+EXPORT_SYMBOL_GPL(ufshpb_heat_tick);
+#endif
@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Universal Flash Storage Host Performance Booster - access heat tracking
+ *
+ * Copyright 2026 Google LLC
+ */
+
+#ifndef _UFSHPB_HEAT_H_
+#define _UFSHPB_HEAT_H_
+
+#include <linux/spinlock.h>
+#include <linux/types.h>
+
+/* heat added by one read, the low bits are a fraction for the decay */
+#define HPB_HEAT_UNIT_SHIFT			4
+#define HPB_HEAT_UNIT				(1 << HPB_HEAT_UNIT_SHIFT)
+#define HPB_HEAT_MAX				U16_MAX
+/* maximum number of loads and evictions decided by one tick */
+#define HPB_HEAT_BATCH				32
+
+#define HPB_HEAT_HOT_THLD			8 /* reads */
+#define HPB_HEAT_COLD_THLD			1 /* reads */
+#define HPB_HEAT_DECAY_SHIFT			4
+
+/**
+ * struct ufshpb_heat_ops - actions of the heat tracker on the HPB LU
+ * @activate: request the L2P map of a subregion to be loaded
+ * @inactivate: request a region and the maps of all of its subregions to be
+ *	dropped
+ *
+ * Both are called without any lock of the heat tracker held.
+ */
+struct ufshpb_heat_ops {
+	void (*activate)(void *priv, int rgn_idx, int srgn_idx);
+	void (*inactivate)(void *priv, int rgn_idx);
+};
+
+/**
+ * struct ufshpb_heat - per subregion read heat of an HPB LU
+ * @ops: actions on the LU
+ * @priv: argument of @ops
+ * @rgns: number of regions
+ * @srgns_per_rgn: number of subregions per region
+ * @heat: decayed read count of each subregion, in HPB_HEAT_UNIT
+ * @loaded: subregions whose map was loaded by the heat tracker
+ * @nr_loaded: number of bits set in @loaded
+ * @budget: maximum of @nr_loaded, 0 disables the heat tracker
+ * @hot_thld: reads of an unloaded subregion to load its map
+ * @cold_thld: reads of a region below which its maps are dropped
+ * @decay_shift: share of the heat lost on each tick
+ * @lock: protects @loaded and @nr_loaded; @heat is updated locklessly
+ * @load: subregions to load, filled by ufshpb_heat_tick()
+ * @evict: regions to drop, filled by ufshpb_heat_tick()
+ */
+struct ufshpb_heat {
+	const struct ufshpb_heat_ops *ops;
+	void *priv;
+
+	u32 rgns;
+	u32 srgns_per_rgn;
+	u16 *heat;
+	unsigned long *loaded;
+	u32 nr_loaded;
+
+	u32 budget;
+	u32 hot_thld;
+	u32 cold_thld;
+	unsigned int decay_shift;
+
+	spinlock_t lock;
+	u32 load[HPB_HEAT_BATCH];
+	u32 evict[HPB_HEAT_BATCH];
+};
+
+int ufshpb_heat_init(struct ufshpb_heat *heat, u32 rgns, u32 srgns_per_rgn,
+		     const struct ufshpb_heat_ops *ops, void *priv);
+void ufshpb_heat_destroy(struct ufshpb_heat *heat);
+void ufshpb_heat_set_budget(struct ufshpb_heat *heat, u32 budget);
+void ufshpb_heat_read(struct ufshpb_heat *heat, int rgn_idx, int srgn_idx);
+void ufshpb_heat_evicted(struct ufshpb_heat *heat, int rgn_idx);
+void ufshpb_heat_tick(struct ufshpb_heat *heat);
+
+#endif /* _UFSHPB_HEAT_H_ */
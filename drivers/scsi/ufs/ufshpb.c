@@ -20,6 +20,8 @@
 #define READ_TO_EXPIRIES 100
 #define POLLING_INTERVAL_MS 200
 #define THROTTLE_MAP_REQ_DEFAULT 1
+#define HEAT_BUDGET_KB_DEFAULT 0
+#define MAP_REQ_BATCH_DEFAULT 1
 
 /* memory management */
 static struct kmem_cache *ufshpb_mctx_cache;
@@ -188,6 +190,9 @@ static void ufshpb_iterate_rgn(struct ufshpb_lu *hpb, int rgn_idx, int srgn_idx,
 		}
 		spin_unlock(&rgn->rgn_lock);
 
+		if (!set_dirty && !ufshpb_is_pinned_region(hpb, rgn_idx))
+			ufshpb_heat_read(&hpb->heat, rgn_idx, srgn_idx);
+
 		if (activate ||
 		    test_and_clear_bit(RGN_FLAG_UPDATE, &rgn->rgn_flags)) {
 			spin_lock_irqsave(&hpb->rsp_list_lock, flags);
@@ -423,6 +428,42 @@ int ufshpb_prep(struct ufs_hba *hba, struct ufshcd_lrb *lrbp)
 	return 0;
 }
 
+/*
+ * Take a request from the pool of the local CPU. Only the owning CPU takes
+ * requests from a pool, with preemption disabled, while completions on any
+ * CPU may put them back: this is the single consumer, multiple producers
+ * case that llist handles without a lock.
+ */
+static struct ufshpb_req *ufshpb_alloc_req(struct ufshpb_lu *hpb)
+{
+	struct llist_node *node;
+	struct ufshpb_req *rq;
+
+	preempt_disable();
+	node = llist_del_first(this_cpu_ptr(hpb->req_free));
+	preempt_enable();
+	if (node)
+		return llist_entry(node, struct ufshpb_req, free_node);
+
+	rq = kmem_cache_alloc(hpb->map_req_cache, GFP_KERNEL);
+	if (!rq)
+		return NULL;
+
+	rq->pool_cpu = -1;
+	rq->bio = NULL;
+	return rq;
+}
+
+static void ufshpb_free_req(struct ufshpb_lu *hpb, struct ufshpb_req *rq)
+{
+	if (rq->pool_cpu < 0) {
+		kmem_cache_free(hpb->map_req_cache, rq);
+		return;
+	}
+
+	llist_add(&rq->free_node, per_cpu_ptr(hpb->req_free, rq->pool_cpu));
+}
+
 static struct ufshpb_req *ufshpb_get_req(struct ufshpb_lu *hpb,
 					 int rgn_idx, enum req_opf dir,
 					 bool atomic)
@@ -431,7 +472,7 @@ static struct ufshpb_req *ufshpb_get_req(struct ufshpb_lu *hpb,
 	struct request *req;
 	int retries = HPB_MAP_REQ_RETRIES;
 
-	rq = kmem_cache_alloc(hpb->map_req_cache, GFP_KERNEL);
+	rq = ufshpb_alloc_req(hpb);
 	if (!rq)
 		return NULL;
 
@@ -454,18 +495,19 @@ static struct ufshpb_req *ufshpb_get_req(struct ufshpb_lu *hpb,
 	return rq;
 
 free_rq:
-	kmem_cache_free(hpb->map_req_cache, rq);
+	ufshpb_free_req(hpb, rq);
 	return NULL;
 }
 
 static void ufshpb_put_req(struct ufshpb_lu *hpb, struct ufshpb_req *rq)
 {
 	blk_put_request(rq->req);
-	kmem_cache_free(hpb->map_req_cache, rq);
+	ufshpb_free_req(hpb, rq);
 }
 
 static struct ufshpb_req *ufshpb_get_map_req(struct ufshpb_lu *hpb,
-					     struct ufshpb_subregion *srgn)
+					     struct ufshpb_subregion *srgn,
+					     int nr_srgns)
 {
 	struct ufshpb_req *map_req;
 	struct bio *bio;
@@ -483,16 +525,20 @@ static struct ufshpb_req *ufshpb_get_map_req(struct ufshpb_lu *hpb,
 	if (!map_req)
 		return NULL;
 
-	bio = bio_alloc(GFP_KERNEL, hpb->pages_per_srgn);
-	if (!bio) {
-		ufshpb_put_req(hpb, map_req);
-		return NULL;
+	if (map_req->pool_cpu < 0) {
+		bio = bio_alloc(GFP_KERNEL, hpb->pages_per_srgn * nr_srgns);
+		if (!bio) {
+			ufshpb_put_req(hpb, map_req);
+			return NULL;
+		}
+		map_req->bio = bio;
+	} else {
+		/* pooled requests keep a bio for HPB_MAP_REQ_BATCH_MAX */
+		bio_reset(map_req->bio);
 	}
 
-	map_req->bio = bio;
-
 	map_req->rb.srgn_idx = srgn->srgn_idx;
-	map_req->rb.mctx = srgn->mctx;
+	map_req->rb.nr_srgns = nr_srgns;
 	hpb->num_inflight_map_req++;
 
 	return map_req;
@@ -501,7 +547,8 @@ static struct ufshpb_req *ufshpb_get_map_req(struct ufshpb_lu *hpb,
 static void ufshpb_put_map_req(struct ufshpb_lu *hpb,
 			       struct ufshpb_req *map_req)
 {
-	bio_put(map_req->bio);
+	if (map_req->pool_cpu < 0)
+		bio_put(map_req->bio);
 	ufshpb_put_req(hpb, map_req);
 	hpb->num_inflight_map_req--;
 }
@@ -564,6 +611,45 @@ static void ufshpb_update_inactive_info(struct ufshpb_lu *hpb, int rgn_idx)
 	hpb->stats.rb_inactive_cnt++;
 }
 
+static void ufshpb_heat_activate(void *priv, int rgn_idx, int srgn_idx)
+{
+	struct ufshpb_lu *hpb = priv;
+	struct ufshpb_region *rgn = hpb->rgn_tbl + rgn_idx;
+	struct ufshpb_subregion *srgn = rgn->srgn_tbl + srgn_idx;
+	unsigned long flags;
+	bool valid;
+
+	spin_lock_irqsave(&hpb->rgn_state_lock, flags);
+	valid = ufshpb_is_valid_srgn(rgn, srgn);
+	spin_unlock_irqrestore(&hpb->rgn_state_lock, flags);
+	if (valid)
+		return;
+
+	spin_lock_irqsave(&hpb->rsp_list_lock, flags);
+	ufshpb_update_active_info(hpb, rgn_idx, srgn_idx);
+	spin_unlock_irqrestore(&hpb->rsp_list_lock, flags);
+	hpb->stats.heat_load_cnt++;
+
+	/* don't wait for the next read timeout poll */
+	ufshpb_kick_map_work(hpb);
+}
+
+static void ufshpb_heat_inactivate(void *priv, int rgn_idx)
+{
+	struct ufshpb_lu *hpb = priv;
+	unsigned long flags;
+
+	spin_lock_irqsave(&hpb->rsp_list_lock, flags);
+	ufshpb_update_inactive_info(hpb, rgn_idx);
+	spin_unlock_irqrestore(&hpb->rsp_list_lock, flags);
+	hpb->stats.heat_evict_cnt++;
+}
+
+static const struct ufshpb_heat_ops ufshpb_heat_ops = {
+	.activate = ufshpb_heat_activate,
+	.inactivate = ufshpb_heat_inactivate,
+};
+
 static void ufshpb_activate_subregion(struct ufshpb_lu *hpb,
 				      struct ufshpb_subregion *srgn)
 {
@@ -608,14 +694,17 @@ static void ufshpb_map_req_compl_fn(struct request *req, blk_status_t error)
 	struct ufshpb_lu *hpb = map_req->hpb;
 	struct ufshpb_subregion *srgn;
 	unsigned long flags;
+	int i;
 
 	srgn = hpb->rgn_tbl[map_req->rb.rgn_idx].srgn_tbl +
 		map_req->rb.srgn_idx;
 
-	ufshpb_clear_dirty_bitmap(hpb, srgn);
-	spin_lock_irqsave(&hpb->rgn_state_lock, flags);
-	ufshpb_activate_subregion(hpb, srgn);
-	spin_unlock_irqrestore(&hpb->rgn_state_lock, flags);
+	for (i = 0; i < map_req->rb.nr_srgns; i++, srgn++) {
+		ufshpb_clear_dirty_bitmap(hpb, srgn);
+		spin_lock_irqsave(&hpb->rgn_state_lock, flags);
+		ufshpb_activate_subregion(hpb, srgn);
+		spin_unlock_irqrestore(&hpb->rgn_state_lock, flags);
+	}
 
 	ufshpb_put_map_req(map_req->hpb, map_req);
 }
@@ -662,25 +751,35 @@ static void ufshpb_execute_umap_req(struct ufshpb_lu *hpb,
 	hpb->stats.umap_req_cnt++;
 }
 
+/*
+ * Read the maps of rb.nr_srgns adjacent subregions with one HPB_READ_BUFFER.
+ * The last subregion of the LU can only be the last one of a batch.
+ */
 static int ufshpb_execute_map_req(struct ufshpb_lu *hpb,
 				  struct ufshpb_req *map_req, bool last)
 {
+	struct ufshpb_subregion *srgn;
 	struct request_queue *q;
 	struct request *req;
 	struct scsi_request *rq;
-	int mem_size = hpb->srgn_mem_size;
+	int mem_size = hpb->srgn_mem_size * map_req->rb.nr_srgns;
 	int ret = 0;
-	int i;
+	int i, j;
 
 	q = hpb->sdev_ufs_lu->request_queue;
-	for (i = 0; i < hpb->pages_per_srgn; i++) {
-		ret = bio_add_pc_page(q, map_req->bio, map_req->rb.mctx->m_page[i],
-				      PAGE_SIZE, 0);
-		if (ret != PAGE_SIZE) {
-			dev_err(&hpb->sdev_ufs_lu->sdev_dev,
-				   "bio_add_pc_page fail %d - %d\n",
-				   map_req->rb.rgn_idx, map_req->rb.srgn_idx);
-			return ret;
+	srgn = hpb->rgn_tbl[map_req->rb.rgn_idx].srgn_tbl +
+		map_req->rb.srgn_idx;
+	for (j = 0; j < map_req->rb.nr_srgns; j++, srgn++) {
+		for (i = 0; i < hpb->pages_per_srgn; i++) {
+			ret = bio_add_pc_page(q, map_req->bio,
+					      srgn->mctx->m_page[i],
+					      PAGE_SIZE, 0);
+			if (ret != PAGE_SIZE) {
+				dev_err(&hpb->sdev_ufs_lu->sdev_dev,
+					   "bio_add_pc_page fail %d - %d\n",
+					   map_req->rb.rgn_idx, srgn->srgn_idx);
+				return ret;
+			}
 		}
 	}
 
@@ -693,7 +792,8 @@ static int ufshpb_execute_map_req(struct ufshpb_lu *hpb,
 	rq = scsi_req(req);
 
 	if (unlikely(last))
-		mem_size = hpb->last_srgn_entries * HPB_ENTRY_SIZE;
+		mem_size -= hpb->srgn_mem_size -
+			    hpb->last_srgn_entries * HPB_ENTRY_SIZE;
 
 	ufshpb_set_read_buf_cmd(rq->cmd, map_req->rb.rgn_idx,
 				map_req->rb.srgn_idx, mem_size);
@@ -814,6 +914,8 @@ static void ufshpb_read_to_handler(struct work_struct *work)
 		spin_unlock_irqrestore(&hpb->rsp_list_lock, flags);
 	}
 
+	ufshpb_heat_tick(&hpb->heat);
+
 	ufshpb_kick_map_work(hpb);
 
 	clear_bit(TIMEOUT_WORK_RUNNING, &hpb->work_data_bits);
@@ -934,6 +1036,9 @@ static void __ufshpb_evict_region(struct ufshpb_lu *hpb,
 
 	for_each_sub_region(rgn, srgn_idx, srgn)
 		ufshpb_purge_active_subregion(hpb, srgn);
+
+	if (hpb->is_hcm)
+		ufshpb_heat_evicted(&hpb->heat, rgn->rgn_idx);
 }
 
 static int ufshpb_evict_region(struct ufshpb_lu *hpb, struct ufshpb_region *rgn)
@@ -969,16 +1074,21 @@ static int ufshpb_evict_region(struct ufshpb_lu *hpb, struct ufshpb_region *rgn)
 	return ret;
 }
 
+/*
+ * Issue one map request for up to *@nr adjacent subregions starting at
+ * @srgn. The batch ends before the first subregion that doesn't need a map
+ * request, and *@nr is set to the number of subregions it consumed: those
+ * are the ones the caller has to retry on error.
+ */
 static int ufshpb_issue_map_req(struct ufshpb_lu *hpb,
 				struct ufshpb_region *rgn,
-				struct ufshpb_subregion *srgn)
+				struct ufshpb_subregion *srgn, int *nr)
 {
 	struct ufshpb_req *map_req;
 	unsigned long flags;
 	int ret;
 	int err = -EAGAIN;
-	bool alloc_required = false;
-	enum HPB_SRGN_STATE state = HPB_SRGN_INVALID;
+	int i, cnt;
 
 	spin_lock_irqsave(&hpb->rgn_state_lock, flags);
 
@@ -988,46 +1098,54 @@ static int ufshpb_issue_map_req(struct ufshpb_lu *hpb,
 		goto unlock_out;
 	}
 
-	if ((rgn->rgn_state == HPB_RGN_INACTIVE) &&
-	    (srgn->srgn_state == HPB_SRGN_INVALID)) {
-		err = 0;
-		goto unlock_out;
-	}
+	for (cnt = 0; cnt < *nr; cnt++) {
+		if ((rgn->rgn_state == HPB_RGN_INACTIVE) &&
+		    (srgn[cnt].srgn_state == HPB_SRGN_INVALID))
+			break;
 
-	if (srgn->srgn_state == HPB_SRGN_UNUSED)
-		alloc_required = true;
+		/*
+		 * If the subregion is already ISSUED state,
+		 * a specific event (e.g., GC or wear-leveling, etc.) occurs in
+		 * the device and HPB response for map loading is received.
+		 * In this case, after finishing the HPB_READ_BUFFER,
+		 * the next HPB_READ_BUFFER is performed again to obtain the
+		 * latest map data.
+		 */
+		if (srgn[cnt].srgn_state == HPB_SRGN_ISSUED)
+			break;
+	}
 
-	/*
-	 * If the subregion is already ISSUED state,
-	 * a specific event (e.g., GC or wear-leveling, etc.) occurs in
-	 * the device and HPB response for map loading is received.
-	 * In this case, after finishing the HPB_READ_BUFFER,
-	 * the next HPB_READ_BUFFER is performed again to obtain the latest
-	 * map data.
-	 */
-	if (srgn->srgn_state == HPB_SRGN_ISSUED)
+	if (!cnt) {
+		*nr = 1;
+		if (srgn->srgn_state != HPB_SRGN_ISSUED)
+			err = 0;
 		goto unlock_out;
+	}
 
-	srgn->srgn_state = HPB_SRGN_ISSUED;
+	*nr = cnt;
+	for (i = 0; i < cnt; i++)
+		srgn[i].srgn_state = HPB_SRGN_ISSUED;
 	spin_unlock_irqrestore(&hpb->rgn_state_lock, flags);
 
-	if (alloc_required) {
-		srgn->mctx = ufshpb_get_map_ctx(hpb, srgn->is_last);
-		if (!srgn->mctx) {
+	for (i = 0; i < cnt; i++) {
+		if (srgn[i].mctx)
+			continue;
+
+		srgn[i].mctx = ufshpb_get_map_ctx(hpb, srgn[i].is_last);
+		if (!srgn[i].mctx) {
 			dev_err(&hpb->sdev_ufs_lu->sdev_dev,
 			    "get map_ctx failed. region %d - %d\n",
-			    rgn->rgn_idx, srgn->srgn_idx);
-			state = HPB_SRGN_UNUSED;
+			    rgn->rgn_idx, srgn[i].srgn_idx);
 			goto change_srgn_state;
 		}
 	}
 
-	map_req = ufshpb_get_map_req(hpb, srgn);
+	map_req = ufshpb_get_map_req(hpb, srgn, cnt);
 	if (!map_req)
 		goto change_srgn_state;
 
 
-	ret = ufshpb_execute_map_req(hpb, map_req, srgn->is_last);
+	ret = ufshpb_execute_map_req(hpb, map_req, srgn[cnt - 1].is_last);
 	if (ret) {
 		dev_err(&hpb->sdev_ufs_lu->sdev_dev,
 			   "%s: issue map_req failed: %d, region %d - %d\n",
@@ -1040,7 +1158,9 @@ static int ufshpb_issue_map_req(struct ufshpb_lu *hpb,
 	ufshpb_put_map_req(hpb, map_req);
 change_srgn_state:
 	spin_lock_irqsave(&hpb->rgn_state_lock, flags);
-	srgn->srgn_state = state;
+	for (i = 0; i < cnt; i++)
+		srgn[i].srgn_state = srgn[i].mctx ? HPB_SRGN_INVALID :
+						    HPB_SRGN_UNUSED;
 unlock_out:
 	spin_unlock_irqrestore(&hpb->rgn_state_lock, flags);
 	return err;
@@ -1353,12 +1473,36 @@ static void ufshpb_add_pending_evict_list(struct ufshpb_lu *hpb,
 	list_add_tail(&rgn->list_inact_rgn, pending_list);
 }
 
+/*
+ * Take the subregions following @srgn in its region off the active list, as
+ * long as they are on it, so that their maps are read along with that of
+ * @srgn. Returns the number of subregions taken, including @srgn.
+ */
+static int ufshpb_take_adjacent_srgns(struct ufshpb_lu *hpb,
+				      struct ufshpb_region *rgn,
+				      struct ufshpb_subregion *srgn)
+{
+	int max = min_t(int, hpb->params.map_req_batch,
+			rgn->srgn_cnt - srgn->srgn_idx);
+	int nr = 1;
+
+	lockdep_assert_held(&hpb->rsp_list_lock);
+
+	while (nr < max && !list_empty(&srgn[nr].list_act_srgn)) {
+		list_del_init(&srgn[nr].list_act_srgn);
+		nr++;
+	}
+
+	return nr;
+}
+
 static void ufshpb_run_active_subregion_list(struct ufshpb_lu *hpb)
 {
 	struct ufshpb_region *rgn;
 	struct ufshpb_subregion *srgn;
 	unsigned long flags;
 	int ret = 0;
+	int i, nr, taken;
 
 	spin_lock_irqsave(&hpb->rsp_list_lock, flags);
 	while ((srgn = list_first_entry_or_null(&hpb->lh_act_srgn,
@@ -1368,21 +1512,26 @@ static void ufshpb_run_active_subregion_list(struct ufshpb_lu *hpb)
 			break;
 
 		list_del_init(&srgn->list_act_srgn);
+		rgn = hpb->rgn_tbl + srgn->rgn_idx;
+		nr = taken = ufshpb_take_adjacent_srgns(hpb, rgn, srgn);
 		spin_unlock_irqrestore(&hpb->rsp_list_lock, flags);
 
-		rgn = hpb->rgn_tbl + srgn->rgn_idx;
 		ret = ufshpb_add_region(hpb, rgn);
 		if (ret)
 			goto active_failed;
 
-		ret = ufshpb_issue_map_req(hpb, rgn, srgn);
+		ret = ufshpb_issue_map_req(hpb, rgn, srgn, &nr);
 		if (ret) {
 			dev_err(&hpb->sdev_ufs_lu->sdev_dev,
 			    "issue map_req failed. ret %d, region %d - %d\n",
 			    ret, rgn->rgn_idx, srgn->srgn_idx);
 			goto active_failed;
 		}
+
+		/* the batch ended early, queue the rest again */
 		spin_lock_irqsave(&hpb->rsp_list_lock, flags);
+		for (i = taken - 1; i >= nr; i--)
+			ufshpb_add_active_list(hpb, rgn, srgn + i);
 	}
 	spin_unlock_irqrestore(&hpb->rsp_list_lock, flags);
 	return;
@@ -1391,7 +1540,8 @@ static void ufshpb_run_active_subregion_list(struct ufshpb_lu *hpb)
 	dev_err(&hpb->sdev_ufs_lu->sdev_dev, "failed to activate region %d - %d, will retry\n",
 		   rgn->rgn_idx, srgn->srgn_idx);
 	spin_lock_irqsave(&hpb->rsp_list_lock, flags);
-	ufshpb_add_active_list(hpb, rgn, srgn);
+	for (i = taken - 1; i >= 0; i--)
+		ufshpb_add_active_list(hpb, rgn, srgn + i);
 	spin_unlock_irqrestore(&hpb->rsp_list_lock, flags);
 }
 
@@ -1707,6 +1857,8 @@ ufshpb_sysfs_attr_show_func(rb_active_cnt);
 ufshpb_sysfs_attr_show_func(rb_inactive_cnt);
 ufshpb_sysfs_attr_show_func(map_req_cnt);
 ufshpb_sysfs_attr_show_func(umap_req_cnt);
+ufshpb_sysfs_attr_show_func(heat_load_cnt);
+ufshpb_sysfs_attr_show_func(heat_evict_cnt);
 
 static struct attribute *hpb_dev_stat_attrs[] = {
 	&dev_attr_hit_cnt.attr,
@@ -1716,6 +1868,8 @@ static struct attribute *hpb_dev_stat_attrs[] = {
 	&dev_attr_rb_inactive_cnt.attr,
 	&dev_attr_map_req_cnt.attr,
 	&dev_attr_umap_req_cnt.attr,
+	&dev_attr_heat_load_cnt.attr,
+	&dev_attr_heat_evict_cnt.attr,
 	NULL,
 };
 
@@ -1981,6 +2135,55 @@ static ssize_t inflight_map_req_store(struct device *dev,
 }
 static DEVICE_ATTR_RW(inflight_map_req);
 
+ufshpb_sysfs_param_show_func(heat_budget_kb);
+static ssize_t heat_budget_kb_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct scsi_device *sdev = to_scsi_device(dev);
+	struct ufshpb_lu *hpb = ufshpb_get_hpb_data(sdev);
+	unsigned int val;
+
+	if (!hpb)
+		return -ENODEV;
+
+	if (!hpb->is_hcm)
+		return -EOPNOTSUPP;
+
+	if (kstrtouint(buf, 0, &val))
+		return -EINVAL;
+
+	hpb->params.heat_budget_kb = val;
+	ufshpb_heat_set_budget(&hpb->heat,
+			       div_u64((u64)val * SZ_1K, hpb->srgn_mem_size));
+
+	return count;
+}
+static DEVICE_ATTR_RW(heat_budget_kb);
+
+ufshpb_sysfs_param_show_func(map_req_batch);
+static ssize_t map_req_batch_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct scsi_device *sdev = to_scsi_device(dev);
+	struct ufshpb_lu *hpb = ufshpb_get_hpb_data(sdev);
+	unsigned int val;
+
+	if (!hpb)
+		return -ENODEV;
+
+	if (kstrtouint(buf, 0, &val))
+		return -EINVAL;
+
+	if (val < 1 || val > HPB_MAP_REQ_BATCH_MAX)
+		return -EINVAL;
+
+	hpb->params.map_req_batch = val;
+
+	return count;
+}
+static DEVICE_ATTR_RW(map_req_batch);
 
 static void ufshpb_hcm_param_init(struct ufshpb_lu *hpb)
 {
@@ -1992,6 +2195,7 @@ static void ufshpb_hcm_param_init(struct ufshpb_lu *hpb)
 	hpb->params.read_timeout_expiries = READ_TO_EXPIRIES;
 	hpb->params.timeout_polling_interval_ms = POLLING_INTERVAL_MS;
 	hpb->params.inflight_map_req = THROTTLE_MAP_REQ_DEFAULT;
+	hpb->params.heat_budget_kb = HEAT_BUDGET_KB_DEFAULT;
 }
 
 static struct attribute *hpb_dev_param_attrs[] = {
@@ -2004,6 +2208,8 @@ static struct attribute *hpb_dev_param_attrs[] = {
 	&dev_attr_read_timeout_expiries.attr,
 	&dev_attr_timeout_polling_interval_ms.attr,
 	&dev_attr_inflight_map_req.attr,
+	&dev_attr_heat_budget_kb.attr,
+	&dev_attr_map_req_batch.attr,
 	NULL,
 };
 
@@ -2073,6 +2279,60 @@ static void ufshpb_pre_req_mempool_destroy(struct ufshpb_lu *hpb)
 	kfree(hpb->pre_req);
 }
 
+static int ufshpb_req_pool_init(struct ufshpb_lu *hpb)
+{
+	struct ufshpb_req *rq;
+	int cpu, i;
+
+	hpb->req_free = alloc_percpu(struct llist_head);
+	if (!hpb->req_free)
+		return -ENOMEM;
+
+	hpb->req_pool = kcalloc(nr_cpu_ids * HPB_REQ_POOL_PER_CPU,
+				sizeof(struct ufshpb_req), GFP_KERNEL);
+	if (!hpb->req_pool)
+		goto release_mem;
+
+	for_each_possible_cpu(cpu) {
+		init_llist_head(per_cpu_ptr(hpb->req_free, cpu));
+
+		for (i = 0; i < HPB_REQ_POOL_PER_CPU; i++) {
+			rq = hpb->req_pool + cpu * HPB_REQ_POOL_PER_CPU + i;
+			rq->bio = bio_alloc(GFP_KERNEL, hpb->pages_per_srgn *
+					    HPB_MAP_REQ_BATCH_MAX);
+			if (!rq->bio)
+				goto release_mem;
+
+			rq->pool_cpu = cpu;
+			llist_add(&rq->free_node, per_cpu_ptr(hpb->req_free,
+							      cpu));
+		}
+	}
+
+	return 0;
+release_mem:
+	if (hpb->req_pool) {
+		for (i = 0; i < nr_cpu_ids * HPB_REQ_POOL_PER_CPU; i++)
+			if (hpb->req_pool[i].bio)
+				bio_put(hpb->req_pool[i].bio);
+		kfree(hpb->req_pool);
+	}
+	free_percpu(hpb->req_free);
+	return -ENOMEM;
+}
+
+static void ufshpb_req_pool_destroy(struct ufshpb_lu *hpb)
+{
+	int i;
+
+	for (i = 0; i < nr_cpu_ids * HPB_REQ_POOL_PER_CPU; i++)
+		if (hpb->req_pool[i].bio)
+			bio_put(hpb->req_pool[i].bio);
+
+	kfree(hpb->req_pool);
+	free_percpu(hpb->req_free);
+}
+
 static void ufshpb_stat_init(struct ufshpb_lu *hpb)
 {
 	hpb->stats.hit_cnt = 0;
@@ -2082,11 +2342,14 @@ static void ufshpb_stat_init(struct ufshpb_lu *hpb)
 	hpb->stats.rb_inactive_cnt = 0;
 	hpb->stats.map_req_cnt = 0;
 	hpb->stats.umap_req_cnt = 0;
+	hpb->stats.heat_load_cnt = 0;
+	hpb->stats.heat_evict_cnt = 0;
 }
 
 static void ufshpb_param_init(struct ufshpb_lu *hpb)
 {
 	hpb->params.requeue_timeout_ms = HPB_REQUEUE_TIME_MS;
+	hpb->params.map_req_batch = MAP_REQ_BATCH_DEFAULT;
 	if (hpb->is_hcm)
 		ufshpb_hcm_param_init(hpb);
 }
@@ -2129,17 +2392,31 @@ static int ufshpb_lu_hpb_init(struct ufs_hba *hba, struct ufshpb_lu *hpb)
 		goto release_req_cache;
 	}
 
+	ret = ufshpb_req_pool_init(hpb);
+	if (ret) {
+		dev_err(hba->dev, "ufshpb(%d) req_pool init fail", hpb->lun);
+		goto release_m_page_cache;
+	}
+
 	ret = ufshpb_pre_req_mempool_init(hpb);
 	if (ret) {
 		dev_err(hba->dev, "ufshpb(%d) pre_req_mempool init fail",
 			hpb->lun);
-		goto release_m_page_cache;
+		goto release_req_pool;
 	}
 
 	ret = ufshpb_alloc_region_tbl(hba, hpb);
 	if (ret)
 		goto release_pre_req_mempool;
 
+	if (hpb->is_hcm) {
+		ret = ufshpb_heat_init(&hpb->heat, hpb->rgns_per_lu,
+				       hpb->srgns_per_rgn, &ufshpb_heat_ops,
+				       hpb);
+		if (ret)
+			goto release_rgn_table;
+	}
+
 	ufshpb_stat_init(hpb);
 	ufshpb_param_init(hpb);
 
@@ -2153,8 +2430,12 @@ static int ufshpb_lu_hpb_init(struct ufs_hba *hba, struct ufshpb_lu *hpb)
 
 	return 0;
 
+release_rgn_table:
+	ufshpb_destroy_region_tbl(hpb);
 release_pre_req_mempool:
 	ufshpb_pre_req_mempool_destroy(hpb);
+release_req_pool:
+	ufshpb_req_pool_destroy(hpb);
 release_m_page_cache:
 	kmem_cache_destroy(hpb->m_page_cache);
 release_req_cache:
@@ -2400,7 +2681,10 @@ void ufshpb_destroy_lu(struct ufs_hba *hba, struct scsi_device *sdev)
 	ufshpb_cancel_jobs(hpb);
 
 	ufshpb_pre_req_mempool_destroy(hpb);
+	ufshpb_req_pool_destroy(hpb);
 	ufshpb_destroy_region_tbl(hpb);
+	if (hpb->is_hcm)
+		ufshpb_heat_destroy(&hpb->heat);
 
 	kmem_cache_destroy(hpb->map_req_cache);
 	kmem_cache_destroy(hpb->m_page_cache);
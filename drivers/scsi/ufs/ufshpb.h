@@ -12,6 +12,8 @@
 #ifndef _UFSHPB_H_
 #define _UFSHPB_H_
 
+#include "ufshpb-heat.h"
+
 /* hpb response UPIU macro */
 #define HPB_RSP_NONE				0x0
 #define HPB_RSP_REQ_REGION_UPDATE		0x1
@@ -49,6 +51,10 @@
 #define HPB_RESET_REQ_RETRIES			10
 #define HPB_MAP_REQ_RETRIES			5
 #define HPB_REQUEUE_TIME_MS			0
+/* preallocated ufshpb_req per CPU */
+#define HPB_REQ_POOL_PER_CPU			4
+/* max subregions read by one HPB_READ_BUFFER */
+#define HPB_MAP_REQ_BATCH_MAX			8
 
 #define HPB_SUPPORT_VERSION			0x200
 #define HPB_SUPPORT_LEGACY_VERSION		0x100
@@ -149,10 +155,12 @@ struct ufshpb_region {
  * @bio: bio for this request
  * @hpb: ufshpb_lu structure that related to
  * @list_req: ufshpb_req mempool list
+ * @free_node: entry in the per-cpu free list of the request pool
+ * @pool_cpu: CPU whose pool this request belongs to, -1 if not pooled
  * @sense: store its sense data
- * @mctx: L2P map information
  * @rgn_idx: target region index
- * @srgn_idx: target sub-region index
+ * @srgn_idx: first target sub-region index
+ * @nr_srgns: number of sub-regions read from @srgn_idx on
  * @lun: target logical unit number
  * @m_page: L2P map information data for pre-request
  * @len: length of host-side cached L2P map in m_page
@@ -163,11 +171,13 @@ struct ufshpb_req {
 	struct bio *bio;
 	struct ufshpb_lu *hpb;
 	struct list_head list_req;
+	struct llist_node free_node;
+	int pool_cpu;
 	union {
 		struct {
-			struct ufshpb_map_ctx *mctx;
 			unsigned int rgn_idx;
 			unsigned int srgn_idx;
+			unsigned int nr_srgns;
 			unsigned int lun;
 		} rb;
 		struct {
@@ -195,6 +205,8 @@ struct victim_select_info {
  * @read_timeout_expiries - amount of allowable timeout expireis
  * @timeout_polling_interval_ms - frequency in which timeouts are checked
  * @inflight_map_req - number of inflight map requests
+ * @heat_budget_kb - memory for maps loaded by the heat tracker, 0 disables it
+ * @map_req_batch - max adjacent subregions read by one map request
  */
 struct ufshpb_params {
 	unsigned int requeue_timeout_ms;
@@ -206,6 +218,8 @@ struct ufshpb_params {
 	unsigned int read_timeout_expiries;
 	unsigned int timeout_polling_interval_ms;
 	unsigned int inflight_map_req;
+	unsigned int heat_budget_kb;
+	unsigned int map_req_batch;
 };
 
 struct ufshpb_stats {
@@ -217,6 +231,8 @@ struct ufshpb_stats {
 	u64 map_req_cnt;
 	u64 pre_req_cnt;
 	u64 umap_req_cnt;
+	u64 heat_load_cnt;
+	u64 heat_evict_cnt;
 };
 
 struct ufshpb_lu {
@@ -249,6 +265,8 @@ struct ufshpb_lu {
 	struct delayed_work ufshpb_read_to_work;
 	unsigned long work_data_bits;
 #define TIMEOUT_WORK_RUNNING 0
+	/* host control mode only */
+	struct ufshpb_heat heat;
 
 	/* pinned region information */
 	u32 lu_pinned_start;
@@ -274,6 +292,9 @@ struct ufshpb_lu {
 
 	struct kmem_cache *map_req_cache;
 	struct kmem_cache *m_page_cache;
+	/* preallocated requests, map_req_cache is used once they run out */
+	struct ufshpb_req *req_pool;
+	struct llist_head __percpu *req_free;
 
 	struct list_head list_hpb_lu;
 };
@@ -12,5 +12,10 @@ void vh_zap_pte_range_tlb_start(void *data, void *preempt_off);
 void vh_zap_pte_range_tlb_force_flush(void *data, struct page *page, bool *flush);
 void vh_zap_pte_range_tlb_end(void *data, void *preempt_off);
 void vh_skip_lru_disable(void *data, bool *skip);
+void vh_compaction_cma_alloc_start(void *data, s64 *ts);
+void vh_compaction_cma_alloc_prepare(void *data, struct cma *cma);
+void vh_compaction_cma_alloc_finish(void *data, struct cma *cma,
+				    struct page *page, unsigned long count,
+				    unsigned int align, gfp_t gfp_mask, s64 ts);
 
 #endif
@@ -0,0 +1,444 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/* compaction.c
+ *
+ * Android Vendor Hook Support
+ *
+ * Background compaction of CMA areas.
+ *
+ * CMA areas are shared with movable allocations while their owners
+ * (camera, codecs, ...) are idle, so a cma_alloc() first has to migrate
+ * those pages out, which is where the long tail of CMA allocation latency
+ * comes from. Areas that were allocated from recently are expected to be
+ * allocated from again soon; for those, a background worker migrates
+ * movable pages out ahead of time, one pageblock per round, and only when
+ * the CPUs are mostly idle and no cma_alloc() is in progress.
+ *
+ * The pageblocks are drained with cma_alloc() so that the owner of the area
+ * is never raced, and kept allocated ("parked") so that movable allocations
+ * don't borrow them again and the next round drains another pageblock. The
+ * parked pageblocks of an area are released as soon as a cma_alloc() from
+ * that area starts, which then finds them free and empty, or when the area
+ * is no longer expected to be used.
+ *
+ * The worker also samples the free page fragmentation of each zone so
+ * userspace can correlate it with the pixel_stat compaction and CMA
+ * latency data.
+ *
+ * Copyright 2026 Google LLC
+ */
+
+#include <linux/cma.h>
+#include <linux/gfp.h>
+#include <linux/jiffies.h>
+#include <linux/kobject.h>
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/sysfs.h>
+#include <linux/tick.h>
+#include <linux/workqueue.h>
+#include "../../include/mm.h"
+
+#define COMPACTION_ATTR_RW(_name) \
+	static struct kobj_attribute _name##_attr = __ATTR_RW(_name)
+#define COMPACTION_ATTR_RO(_name) \
+	static struct kobj_attribute _name##_attr = __ATTR_RO(_name)
+
+#define DEF_INTERVAL_MS		500
+#define DEF_IDLE_PCT		70
+#define DEF_PREDICT_WINDOW_MS	(10 * 60 * MSEC_PER_SEC)
+/* upper bound of the pageblocks parked per area */
+#define MAX_PARKED		8
+
+struct drain_area {
+	struct cma *cma;
+	unsigned long nr_pages;
+	unsigned long last_alloc;	/* jiffies */
+	unsigned long nr_allocs;
+	unsigned long nr_drained;
+	unsigned long nr_busy;
+	/* drained pageblocks, protected by compaction.lock */
+	struct page *parked[MAX_PARKED];
+	int nr_parked;
+};
+
+static struct drain_area areas[MAX_CMA_AREAS];
+static int nr_areas;
+
+static struct {
+	bool enabled;
+	unsigned int interval_ms;
+	unsigned int idle_pct;
+	unsigned int predict_window_ms;
+	/* number of cma_alloc() calls in progress, not counting ours */
+	atomic_t cma_busy;
+	/* task doing our own cma_alloc(), ignored by the hooks */
+	struct task_struct *drainer;
+	struct mutex lock;
+	/* per-cpu idle/wall time at the previous round */
+	u64 idle_us;
+	u64 wall_us;
+	int next_area;
+	struct delayed_work work;
+	struct kobject kobj;
+} compaction = {
+	.enabled = true,
+	.interval_ms = DEF_INTERVAL_MS,
+	.idle_pct = DEF_IDLE_PCT,
+	.predict_window_ms = DEF_PREDICT_WINDOW_MS,
+	.cma_busy = ATOMIC_INIT(0),
+	.lock = __MUTEX_INITIALIZER(compaction.lock),
+};
+
+static void release_area(struct drain_area *area);
+
+/*****************************************************************************/
+/*                       Modified Code Section                               */
+/*****************************************************************************/
+/*
+ * This part of code is vendor hook functions, which modify or extend the
+ * original functions.
+ */
+
+/* A tracepoint, runs with preemption disabled */
+void vh_compaction_cma_alloc_start(void *data, s64 *ts)
+{
+	if (current == READ_ONCE(compaction.drainer))
+		return;
+
+	atomic_inc(&compaction.cma_busy);
+}
+
+/* A restricted hook, may sleep */
+void vh_compaction_cma_alloc_prepare(void *data, struct cma *cma)
+{
+	int i;
+
+	if (current == READ_ONCE(compaction.drainer))
+		return;
+
+	/* Hand the drained pageblocks over before the bitmap is searched */
+	for (i = 0; i < nr_areas; i++) {
+		if (areas[i].cma == cma) {
+			release_area(&areas[i]);
+			break;
+		}
+	}
+}
+
+void vh_compaction_cma_alloc_finish(void *data, struct cma *cma,
+				    struct page *page, unsigned long count,
+				    unsigned int align, gfp_t gfp_mask, s64 ts)
+{
+	int i;
+
+	if (current == READ_ONCE(compaction.drainer))
+		return;
+
+	for (i = 0; i < nr_areas; i++) {
+		if (areas[i].cma != cma)
+			continue;
+		WRITE_ONCE(areas[i].last_alloc, jiffies);
+		areas[i].nr_allocs++;
+		break;
+	}
+	/* The start of this allocation may predate the module loading */
+	atomic_add_unless(&compaction.cma_busy, -1, 0);
+}
+
+/*****************************************************************************/
+/*                         New Code Section                                  */
+/*****************************************************************************/
+/*
+ * This part of code is new code for the vendor background compaction.
+ */
+
+/* Return true if the CPUs were at least idle_pct idle since the last call */
+static bool cpus_idle(void)
+{
+	u64 idle_us = 0, wall_us = 0, wall;
+	bool idle = true;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		u64 us = get_cpu_idle_time_us(cpu, &wall);
+
+		/* NOHZ idle accounting is off, don't hold back */
+		if (us == -1ULL)
+			return true;
+		idle_us += us;
+		wall_us += wall;
+	}
+
+	if (wall_us > compaction.wall_us)
+		idle = (idle_us - compaction.idle_us) * 100 >=
+			(wall_us - compaction.wall_us) * compaction.idle_pct;
+	compaction.idle_us = idle_us;
+	compaction.wall_us = wall_us;
+	return idle;
+}
+
+static bool area_expected(struct drain_area *area)
+{
+	unsigned long last = READ_ONCE(area->last_alloc);
+
+	return area->nr_allocs &&
+		time_before(jiffies, last +
+			    msecs_to_jiffies(compaction.predict_window_ms));
+}
+
+static unsigned long drain_size(struct drain_area *area)
+{
+	return min_t(unsigned long, pageblock_nr_pages, area->nr_pages);
+}
+
+static void __release_area(struct drain_area *area)
+{
+	lockdep_assert_held(&compaction.lock);
+
+	while (area->nr_parked)
+		cma_release(area->cma, area->parked[--area->nr_parked],
+			    drain_size(area));
+}
+
+static void release_area(struct drain_area *area)
+{
+	mutex_lock(&compaction.lock);
+	__release_area(area);
+	mutex_unlock(&compaction.lock);
+}
+
+/*
+ * Migrate the movable pages of the first free pageblock of @area out, and
+ * park it. cma_alloc() skips the pageblocks that are allocated by the owner
+ * of the area or already parked.
+ */
+static void drain_one(struct drain_area *area)
+{
+	unsigned long count = drain_size(area);
+	struct page *page;
+
+	WRITE_ONCE(compaction.drainer, current);
+	page = cma_alloc(area->cma, count, pageblock_order,
+			 GFP_KERNEL | __GFP_NORETRY | __GFP_NOWARN);
+	WRITE_ONCE(compaction.drainer, NULL);
+	if (!page) {
+		area->nr_busy++;
+		return;
+	}
+
+	mutex_lock(&compaction.lock);
+	/* The owner may have started allocating in the meantime */
+	if (atomic_read(&compaction.cma_busy) ||
+	    area->nr_parked == MAX_PARKED) {
+		cma_release(area->cma, page, count);
+	} else {
+		area->parked[area->nr_parked++] = page;
+		area->nr_drained++;
+	}
+	mutex_unlock(&compaction.lock);
+}
+
+static void compaction_work(struct work_struct *work)
+{
+	int i;
+
+	mutex_lock(&compaction.lock);
+	for (i = 0; i < nr_areas; i++)
+		if (!READ_ONCE(compaction.enabled) || !area_expected(&areas[i]))
+			__release_area(&areas[i]);
+	mutex_unlock(&compaction.lock);
+
+	if (!READ_ONCE(compaction.enabled) || !cpus_idle() ||
+	    atomic_read(&compaction.cma_busy))
+		goto out;
+
+	for (i = 0; i < nr_areas; i++) {
+		struct drain_area *area;
+
+		area = &areas[(compaction.next_area + i) % nr_areas];
+		if (!area_expected(area) ||
+		    READ_ONCE(area->nr_parked) == MAX_PARKED)
+			continue;
+
+		drain_one(area);
+		/* Round robin between areas that are due */
+		compaction.next_area = (area - areas + 1) % nr_areas;
+		break;
+	}
+
+out:
+	if (READ_ONCE(compaction.enabled))
+		queue_delayed_work(system_freezable_power_efficient_wq,
+				   &compaction.work,
+				   msecs_to_jiffies(compaction.interval_ms));
+}
+
+static int add_drain_area(struct cma *cma, void *data)
+{
+	struct drain_area *area = &areas[nr_areas++];
+
+	area->cma = cma;
+	area->nr_pages = cma_get_size(cma) >> PAGE_SHIFT;
+	return 0;
+}
+
+/*
+ * Unusable free space index of @zone for @order in permille: the share of
+ * free pages that cannot be used for an allocation of that order.
+ */
+static unsigned int zone_unusable_index(struct zone *zone, unsigned int order,
+					unsigned long free)
+{
+	unsigned long suitable = 0;
+	unsigned int o;
+
+	if (!free)
+		return 0;
+
+	for (o = order; o < MAX_ORDER; o++)
+		suitable += READ_ONCE(zone->free_area[o].nr_free) << o;
+
+	return div64_u64((u64)(free - min(free, suitable)) * 1000, free);
+}
+
+/********** sysfs *****************************/
+static ssize_t enabled_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%d\n", READ_ONCE(compaction.enabled));
+}
+
+static ssize_t enabled_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t len)
+{
+	bool val;
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	WRITE_ONCE(compaction.enabled, val);
+	/* When disabling, the work releases the parked pageblocks and stops */
+	mod_delayed_work(system_freezable_power_efficient_wq,
+			 &compaction.work, 0);
+	return len;
+}
+COMPACTION_ATTR_RW(enabled);
+
+#define COMPACTION_UINT_ATTR(_name, _min, _max)				\
+static ssize_t _name##_show(struct kobject *kobj,			\
+		struct kobj_attribute *attr, char *buf)			\
+{									\
+	return sysfs_emit(buf, "%u\n", READ_ONCE(compaction._name));	\
+}									\
+									\
+static ssize_t _name##_store(struct kobject *kobj,			\
+		struct kobj_attribute *attr, const char *buf, size_t len)\
+{									\
+	unsigned int val;						\
+									\
+	if (kstrtouint(buf, 10, &val) || val < (_min) || val > (_max))	\
+		return -EINVAL;						\
+									\
+	WRITE_ONCE(compaction._name, val);				\
+	return len;							\
+}									\
+COMPACTION_ATTR_RW(_name)
+
+COMPACTION_UINT_ATTR(interval_ms, 10, UINT_MAX);
+COMPACTION_UINT_ATTR(idle_pct, 0, 100);
+COMPACTION_UINT_ATTR(predict_window_ms, 0, UINT_MAX);
+
+static ssize_t cma_drain_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	int i, n = 0;
+
+	for (i = 0; i < nr_areas; i++) {
+		struct drain_area *area = &areas[i];
+
+		n += sysfs_emit_at(buf, n, "%s %d %lu %lu %lu %d\n",
+				   cma_get_name(area->cma),
+				   area_expected(area),
+				   area->nr_allocs,
+				   area->nr_drained,
+				   area->nr_busy,
+				   READ_ONCE(area->nr_parked));
+	}
+	return n;
+}
+COMPACTION_ATTR_RO(cma_drain);
+
+/* One line per zone: node, zone and unusable index in permille per order */
+static ssize_t fragmentation_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	int nid, n = 0;
+
+	for_each_online_node(nid) {
+		pg_data_t *pgdat = NODE_DATA(nid);
+		int z;
+
+		for (z = 0; z < MAX_NR_ZONES; z++) {
+			struct zone *zone = &pgdat->node_zones[z];
+			unsigned long free;
+			unsigned int order;
+
+			if (!populated_zone(zone))
+				continue;
+
+			free = zone_page_state(zone, NR_FREE_PAGES);
+			n += sysfs_emit_at(buf, n, "%d %s", nid, zone->name);
+			for (order = 0; order < MAX_ORDER; order++)
+				n += sysfs_emit_at(buf, n, " %u",
+					zone_unusable_index(zone, order, free));
+			n += sysfs_emit_at(buf, n, "\n");
+		}
+	}
+	return n;
+}
+COMPACTION_ATTR_RO(fragmentation);
+
+static struct attribute *compaction_attrs[] = {
+	&enabled_attr.attr,
+	&interval_ms_attr.attr,
+	&idle_pct_attr.attr,
+	&predict_window_ms_attr.attr,
+	&cma_drain_attr.attr,
+	&fragmentation_attr.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(compaction);
+
+static struct kobj_type compaction_ktype = {
+	.release = NULL,
+	.sysfs_ops = &kobj_sysfs_ops,
+	.default_groups = compaction_groups,
+};
+
+int pixel_mm_compaction_init(struct kobject *parent)
+{
+	int ret;
+
+	cma_for_each_area(add_drain_area, NULL);
+
+	ret = kobject_init_and_add(&compaction.kobj, &compaction_ktype,
+				   parent, "compaction");
+	if (ret) {
+		kobject_put(&compaction.kobj);
+		return ret;
+	}
+
+	INIT_DEFERRABLE_WORK(&compaction.work, compaction_work);
+	return 0;
+}
+
+/* Called once the cma_alloc() hooks are registered */
+void pixel_mm_compaction_start(void)
+{
+	if (nr_areas)
+		queue_delayed_work(system_freezable_power_efficient_wq,
+				   &compaction.work,
+				   msecs_to_jiffies(compaction.interval_ms));
+}
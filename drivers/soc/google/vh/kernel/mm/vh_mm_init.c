@@ -19,6 +19,8 @@ struct kobject *vendor_mm_kobj;
 EXPORT_SYMBOL_GPL(vendor_mm_kobj);
 
 extern int pixel_mm_cma_sysfs(struct kobject *parent);
+extern int pixel_mm_compaction_init(struct kobject *parent);
+extern void pixel_mm_compaction_start(void);
 
 static int vh_mm_init(void)
 {
@@ -34,6 +36,12 @@ static int vh_mm_init(void)
 		return ret;
 	}
 
+	ret = pixel_mm_compaction_init(vendor_mm_kobj);
+	if (ret) {
+		kobject_put(vendor_mm_kobj);
+		return ret;
+	}
+
 	/*
 	 * Not sure this error handling is meaningful for vendor hook.
 	 * Maybe better to rely on the just BUG_ON?
@@ -104,8 +112,23 @@ static int vh_mm_init(void)
 		return ret;
 	ret = register_trace_android_vh_reclaim_pages_plug(
 			vh_reclaim_pages_plug, NULL);
+	if (ret)
+		return ret;
+	ret = register_trace_android_vh_cma_alloc_start(
+			vh_compaction_cma_alloc_start, NULL);
+	if (ret)
+		return ret;
+	ret = register_trace_android_vh_cma_alloc_finish(
+			vh_compaction_cma_alloc_finish, NULL);
+	if (ret)
+		return ret;
+	ret = register_trace_android_rvh_cma_alloc_prepare(
+			vh_compaction_cma_alloc_prepare, NULL);
+	if (ret)
+		return ret;
 
-	return ret;
+	pixel_mm_compaction_start();
+	return 0;
 }
 module_init(vh_mm_init);
 MODULE_LICENSE("GPL v2");
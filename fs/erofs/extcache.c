@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Decompressed extent cache
+ *
+ * Keeps recently decompressed extents around so that page cache misses
+ * on hot compressed data (e.g. random reads of large shared libraries)
+ * don't have to decompress the whole pcluster again.
+ *
+ * An extent is only cached when its pcluster is decompressed for the
+ * second time while a "ghost" (an XArray value entry left behind by the
+ * first decompression) is still present, which keeps streaming reads
+ * from flushing the cache. Cached extents are reclaimed in LRU order
+ * (with a second chance for extents hit since the last scan) either when
+ * the per-filesystem budget is exceeded or by the EROFS shrinker.
+ */
+#include "internal.h"
+#include <linux/highmem.h>
+
+struct erofs_extcache_entry {
+	/* LRU list of the filesystem, protected by its extcache xa_lock */
+	struct list_head lru;
+	refcount_t refcount;
+	/* hit since the last time the LRU tail was scanned */
+	bool referenced;
+
+	/* physical block number of the pcluster, i.e. the XArray index */
+	pgoff_t index;
+	/* decompressed data starts at @pageofs of the first page */
+	unsigned short pageofs;
+	unsigned int length;
+	unsigned int nr_pages;
+
+	struct rcu_head rcu;
+	struct page *pages[];
+};
+
+/* cached pages of all mounted instances, reported to the shrinker */
+static atomic_long_t erofs_extcache_nr_pages;
+
+static unsigned long erofs_extcache_max_pages(struct erofs_sb_info *sbi)
+{
+	return READ_ONCE(sbi->extcache_max_kb) >> (PAGE_SHIFT - 10);
+}
+
+void erofs_extcache_init(struct erofs_sb_info *sbi)
+{
+	xa_init(&sbi->extcache);
+	INIT_LIST_HEAD(&sbi->extcache_lru);
+	sbi->extcache_max_kb = EROFS_EXTCACHE_DEFAULT_KB;
+}
+
+void erofs_extcache_put(struct erofs_extcache_entry *e)
+{
+	unsigned int i;
+
+	if (!e || !refcount_dec_and_test(&e->refcount))
+		return;
+
+	for (i = 0; i < e->nr_pages; ++i)
+		__free_page(e->pages[i]);
+	/* lookups may still be checking the refcount under RCU */
+	kfree_rcu(e, rcu);
+}
+
+struct erofs_extcache_entry *erofs_extcache_get(struct erofs_sb_info *sbi,
+						struct erofs_map_blocks *map)
+{
+	struct erofs_extcache_entry *e;
+
+	if (map->m_algorithmformat == Z_EROFS_COMPRESSION_SHIFTED ||
+	    !erofs_extcache_max_pages(sbi))
+		return NULL;
+
+	rcu_read_lock();
+	e = xa_load(&sbi->extcache, map->m_pa >> PAGE_SHIFT);
+	if (e && (xa_is_value(e) || !refcount_inc_not_zero(&e->refcount)))
+		e = NULL;
+	rcu_read_unlock();
+
+	/* the pcluster and thus the extent is the same, but be paranoid */
+	if (e && (e->pageofs != (map->m_la & ~PAGE_MASK) ||
+		  e->length < map->m_llen)) {
+		DBG_BUGON(1);
+		erofs_extcache_put(e);
+		e = NULL;
+	}
+
+	if (!e) {
+		atomic_long_inc(&sbi->extcache_misses);
+		return NULL;
+	}
+	if (!READ_ONCE(e->referenced))
+		WRITE_ONCE(e->referenced, true);
+	atomic_long_inc(&sbi->extcache_hits);
+	return e;
+}
+
+/* copy @len bytes at @pos of the extent to @pageofs of @page */
+void erofs_extcache_read(struct erofs_extcache_entry *e, struct page *page,
+			 unsigned int pageofs, erofs_off_t pos,
+			 unsigned int len)
+{
+	DBG_BUGON(pos + len > e->length);
+
+	pos += e->pageofs;
+	while (len) {
+		unsigned int cnt = min_t(unsigned int, len,
+					 PAGE_SIZE - offset_in_page(pos));
+		void *src = kmap_atomic(e->pages[pos >> PAGE_SHIFT]);
+		void *dst = kmap_atomic(page);
+
+		memcpy(dst + pageofs, src + offset_in_page(pos), cnt);
+		kunmap_atomic(dst);
+		kunmap_atomic(src);
+
+		pos += cnt;
+		pageofs += cnt;
+		len -= cnt;
+	}
+	flush_dcache_page(page);
+}
+
+static void erofs_extcache_remove(struct erofs_sb_info *sbi,
+				  struct erofs_extcache_entry *e)
+{
+	list_del(&e->lru);
+	DBG_BUGON(__xa_erase(&sbi->extcache, e->index) != e);
+	atomic_long_sub(e->nr_pages, &sbi->extcache_pages);
+	atomic_long_sub(e->nr_pages, &erofs_extcache_nr_pages);
+	atomic_long_inc(&sbi->extcache_evictions);
+	/* drop the reference held by the cache itself */
+	erofs_extcache_put(e);
+}
+
+/* evict extents from the LRU tail until @nr pages are freed */
+static unsigned long __erofs_extcache_evict(struct erofs_sb_info *sbi,
+					    unsigned long nr)
+{
+	unsigned long freed = 0;
+
+	while (freed < nr && !list_empty(&sbi->extcache_lru)) {
+		struct erofs_extcache_entry *e =
+			list_last_entry(&sbi->extcache_lru,
+					struct erofs_extcache_entry, lru);
+
+		if (READ_ONCE(e->referenced)) {
+			WRITE_ONCE(e->referenced, false);
+			list_move(&e->lru, &sbi->extcache_lru);
+			continue;
+		}
+		freed += e->nr_pages;
+		erofs_extcache_remove(sbi, e);
+	}
+	return freed;
+}
+
+/*
+ * Called before a pcluster at @index is decompressed. Returns true if the
+ * whole extent should be decompressed and then cached; otherwise leaves a
+ * ghost behind so that the next decompression of it does so.
+ */
+bool erofs_extcache_admit(struct erofs_sb_info *sbi, pgoff_t index,
+			  unsigned char algorithmformat)
+{
+	unsigned long max_pages = erofs_extcache_max_pages(sbi);
+	bool admit = false;
+	void *cur;
+
+	if (algorithmformat == Z_EROFS_COMPRESSION_SHIFTED || !max_pages)
+		return false;
+
+	xa_lock(&sbi->extcache);
+	cur = xa_load(&sbi->extcache, index);
+	if (xa_is_value(cur)) {
+		admit = true;
+	} else if (!cur) {
+		/* forget all ghosts at once rather than keeping an LRU */
+		if (sbi->extcache_nr_ghosts >= max_pages) {
+			unsigned long i;
+
+			xa_for_each(&sbi->extcache, i, cur)
+				if (xa_is_value(cur))
+					__xa_erase(&sbi->extcache, i);
+			sbi->extcache_nr_ghosts = 0;
+		}
+		if (!xa_is_err(__xa_store(&sbi->extcache, index, xa_mk_value(0),
+					  GFP_NOWAIT | __GFP_NOWARN)))
+			++sbi->extcache_nr_ghosts;
+	}
+	xa_unlock(&sbi->extcache);
+	return admit;
+}
+
+/*
+ * Cache a copy of a decompressed extent of @length bytes starting at
+ * @pageofs of @pages[0]. Allocations are opportunistic: the cache is
+ * simply skipped rather than putting more pressure on reclaim.
+ */
+void erofs_extcache_insert(struct erofs_sb_info *sbi, pgoff_t index,
+			   struct page **pages, unsigned int pageofs,
+			   unsigned int length)
+{
+	const gfp_t gfp = GFP_NOFS | __GFP_NORETRY | __GFP_NOWARN;
+	unsigned int i, nr_pages = PAGE_ALIGN(pageofs + length) >> PAGE_SHIFT;
+	unsigned long max_pages = erofs_extcache_max_pages(sbi);
+	struct erofs_extcache_entry *e;
+	void *cur;
+
+	if (nr_pages > max_pages)
+		return;
+
+	e = kmalloc(struct_size(e, pages, nr_pages), gfp);
+	if (!e)
+		return;
+
+	for (i = 0; i < nr_pages; ++i) {
+		e->pages[i] = alloc_page(gfp);
+		if (!e->pages[i])
+			goto err_out;
+		copy_highpage(e->pages[i], pages[i]);
+	}
+	refcount_set(&e->refcount, 1);
+	e->referenced = false;
+	e->index = index;
+	e->pageofs = pageofs;
+	e->length = length;
+	e->nr_pages = nr_pages;
+
+	xa_lock(&sbi->extcache);
+	cur = xa_load(&sbi->extcache, index);
+	if (cur && !xa_is_value(cur))
+		goto err_unlock;
+	if (xa_is_err(__xa_store(&sbi->extcache, index, e,
+				 GFP_NOWAIT | __GFP_NOWARN)))
+		goto err_unlock;
+	if (cur)
+		--sbi->extcache_nr_ghosts;
+
+	list_add(&e->lru, &sbi->extcache_lru);
+	atomic_long_add(nr_pages, &sbi->extcache_pages);
+	atomic_long_add(nr_pages, &erofs_extcache_nr_pages);
+
+	if (atomic_long_read(&sbi->extcache_pages) > max_pages)
+		__erofs_extcache_evict(sbi,
+			atomic_long_read(&sbi->extcache_pages) - max_pages);
+	xa_unlock(&sbi->extcache);
+	return;
+
+err_unlock:
+	xa_unlock(&sbi->extcache);
+err_out:
+	e->nr_pages = i;
+	refcount_set(&e->refcount, 1);
+	erofs_extcache_put(e);
+}
+
+unsigned long erofs_extcache_shrink(struct erofs_sb_info *sbi,
+				    unsigned long nr_shrink)
+{
+	unsigned long freed;
+
+	xa_lock(&sbi->extcache);
+	freed = __erofs_extcache_evict(sbi, nr_shrink);
+	xa_unlock(&sbi->extcache);
+	return freed;
+}
+
+void erofs_extcache_drop(struct erofs_sb_info *sbi)
+{
+	erofs_extcache_shrink(sbi, ~0UL);
+	/* only ghosts are left */
+	xa_destroy(&sbi->extcache);
+	sbi->extcache_nr_ghosts = 0;
+}
+
+unsigned long erofs_extcache_count(void)
+{
+	return atomic_long_read(&erofs_extcache_nr_pages);
+}
@@ -107,6 +107,20 @@ struct erofs_sb_info {
 
 	struct erofs_sb_lz4_info lz4;
 #endif	/* CONFIG_EROFS_FS_ZIP */
+#ifdef CONFIG_EROFS_FS_ZIP_EXTCACHE
+	/* cached decompressed extents and ghosts by physical block number */
+	struct xarray extcache;
+	/* LRU list of cached extents, protected by the extcache xa_lock */
+	struct list_head extcache_lru;
+	unsigned int extcache_nr_ghosts;
+	/* memory budget of the decompressed extent cache, 0 to disable */
+	unsigned int extcache_max_kb;
+
+	atomic_long_t extcache_pages;
+	atomic_long_t extcache_hits;
+	atomic_long_t extcache_misses;
+	atomic_long_t extcache_evictions;
+#endif
 	struct erofs_dev_context *devs;
 	struct dax_device *dax_dev;
 	u64 total_blocks;
@@ -544,6 +558,55 @@ static inline int z_erofs_load_lz4_config(struct super_block *sb,
 }
 #endif	/* !CONFIG_EROFS_FS_ZIP */
 
+/* extcache.c */
+struct erofs_extcache_entry;
+#ifdef CONFIG_EROFS_FS_ZIP_EXTCACHE
+#define EROFS_EXTCACHE_DEFAULT_KB	2048
+
+void erofs_extcache_init(struct erofs_sb_info *sbi);
+struct erofs_extcache_entry *erofs_extcache_get(struct erofs_sb_info *sbi,
+						struct erofs_map_blocks *map);
+void erofs_extcache_put(struct erofs_extcache_entry *e);
+void erofs_extcache_read(struct erofs_extcache_entry *e, struct page *page,
+			 unsigned int pageofs, erofs_off_t pos,
+			 unsigned int len);
+bool erofs_extcache_admit(struct erofs_sb_info *sbi, pgoff_t index,
+			  unsigned char algorithmformat);
+void erofs_extcache_insert(struct erofs_sb_info *sbi, pgoff_t index,
+			   struct page **pages, unsigned int pageofs,
+			   unsigned int length);
+unsigned long erofs_extcache_shrink(struct erofs_sb_info *sbi,
+				    unsigned long nr_shrink);
+void erofs_extcache_drop(struct erofs_sb_info *sbi);
+unsigned long erofs_extcache_count(void);
+#else
+static inline void erofs_extcache_init(struct erofs_sb_info *sbi) {}
+static inline struct erofs_extcache_entry *
+erofs_extcache_get(struct erofs_sb_info *sbi, struct erofs_map_blocks *map)
+{
+	return NULL;
+}
+static inline void erofs_extcache_put(struct erofs_extcache_entry *e) {}
+static inline void erofs_extcache_read(struct erofs_extcache_entry *e,
+		struct page *page, unsigned int pageofs, erofs_off_t pos,
+		unsigned int len) {}
+static inline bool erofs_extcache_admit(struct erofs_sb_info *sbi,
+		pgoff_t index, unsigned char algorithmformat)
+{
+	return false;
+}
+static inline void erofs_extcache_insert(struct erofs_sb_info *sbi,
+		pgoff_t index, struct page **pages, unsigned int pageofs,
+		unsigned int length) {}
+static inline unsigned long erofs_extcache_shrink(struct erofs_sb_info *sbi,
+						  unsigned long nr_shrink)
+{
+	return 0;
+}
+static inline void erofs_extcache_drop(struct erofs_sb_info *sbi) {}
+static inline unsigned long erofs_extcache_count(void) { return 0; }
+#endif	/* !CONFIG_EROFS_FS_ZIP_EXTCACHE */
+
 #ifdef CONFIG_EROFS_FS_ZIP_LZMA
 int z_erofs_lzma_init(void);
 void z_erofs_lzma_exit(void);
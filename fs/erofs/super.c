@@ -671,6 +671,7 @@ static int erofs_fc_fill_super(struct super_block *sb, struct fs_context *fc)
 
 #ifdef CONFIG_EROFS_FS_ZIP
 	xa_init(&sbi->managed_pslots);
+	erofs_extcache_init(sbi);
 #endif
 
 	/* get the root inode */
@@ -12,6 +12,7 @@ enum {
 	attr_feature,
 	attr_pointer_ui,
 	attr_pointer_bool,
+	attr_pointer_atomic_long,
 };
 
 enum {
@@ -52,9 +53,27 @@ static struct erofs_attr erofs_attr_##_name = {			\
 #define EROFS_ATTR_RW_BOOL(_name, _struct)	\
 	EROFS_ATTR_RW(_name, pointer_bool, _struct)
 
+#define EROFS_RO_ATTR_ATOMIC_LONG(_name, _struct)	\
+	EROFS_RO_ATTR(_name, pointer_atomic_long, _struct)
+
 #define ATTR_LIST(name) (&erofs_attr_##name.attr)
 
+#ifdef CONFIG_EROFS_FS_ZIP_EXTCACHE
+EROFS_ATTR_RW_UI(extcache_max_kb, erofs_sb_info);
+EROFS_RO_ATTR_ATOMIC_LONG(extcache_pages, erofs_sb_info);
+EROFS_RO_ATTR_ATOMIC_LONG(extcache_hits, erofs_sb_info);
+EROFS_RO_ATTR_ATOMIC_LONG(extcache_misses, erofs_sb_info);
+EROFS_RO_ATTR_ATOMIC_LONG(extcache_evictions, erofs_sb_info);
+#endif
+
 static struct attribute *erofs_attrs[] = {
+#ifdef CONFIG_EROFS_FS_ZIP_EXTCACHE
+	ATTR_LIST(extcache_max_kb),
+	ATTR_LIST(extcache_pages),
+	ATTR_LIST(extcache_hits),
+	ATTR_LIST(extcache_misses),
+	ATTR_LIST(extcache_evictions),
+#endif
 	NULL,
 };
 ATTRIBUTE_GROUPS(erofs);
@@ -107,6 +126,11 @@ static ssize_t erofs_attr_show(struct kobject *kobj,
 		if (!ptr)
 			return 0;
 		return sysfs_emit(buf, "%d\n", *(bool *)ptr);
+	case attr_pointer_atomic_long:
+		if (!ptr)
+			return 0;
+		return sysfs_emit(buf, "%ld\n",
+				  atomic_long_read((atomic_long_t *)ptr));
 	}
 	return 0;
 }
@@ -5,6 +5,7 @@
  */
 #include "zdata.h"
 #include "compress.h"
+#include <linux/cpuhotplug.h>
 #include <linux/prefetch.h>
 
 #include <trace/events/erofs.h>
@@ -117,8 +118,93 @@ typedef tagptr1_t compressed_page_t;
 
 static struct workqueue_struct *z_erofs_workqueue __read_mostly;
 
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+/* upper bound of the CPUs a single decompression queue is spread over */
+#define Z_EROFS_FANOUT_MAX	8
+
+static struct kthread_worker __rcu **z_erofs_pcpu_workers;
+static DEFINE_SPINLOCK(z_erofs_pcpu_worker_lock);
+static enum cpuhp_state erofs_cpuhp_state;
+
+static struct kthread_worker *erofs_init_percpu_worker(int cpu)
+{
+	struct kthread_worker *worker =
+		kthread_create_worker_on_cpu(cpu, 0, "erofs_worker/%u", cpu);
+
+	if (IS_ERR(worker))
+		return worker;
+	if (IS_ENABLED(CONFIG_EROFS_FS_PCPU_KTHREAD_HIPRI))
+		sched_set_fifo_low(worker->task);
+	return worker;
+}
+
+static int erofs_cpu_online(unsigned int cpu)
+{
+	struct kthread_worker *worker, *old;
+
+	worker = erofs_init_percpu_worker(cpu);
+	if (IS_ERR(worker))
+		return PTR_ERR(worker);
+
+	spin_lock(&z_erofs_pcpu_worker_lock);
+	old = rcu_dereference_protected(z_erofs_pcpu_workers[cpu],
+			lockdep_is_held(&z_erofs_pcpu_worker_lock));
+	if (!old)
+		rcu_assign_pointer(z_erofs_pcpu_workers[cpu], worker);
+	spin_unlock(&z_erofs_pcpu_worker_lock);
+	if (old)
+		kthread_destroy_worker(worker);
+	return 0;
+}
+
+static int erofs_cpu_offline(unsigned int cpu)
+{
+	struct kthread_worker *worker;
+
+	spin_lock(&z_erofs_pcpu_worker_lock);
+	worker = rcu_dereference_protected(z_erofs_pcpu_workers[cpu],
+			lockdep_is_held(&z_erofs_pcpu_worker_lock));
+	rcu_assign_pointer(z_erofs_pcpu_workers[cpu], NULL);
+	spin_unlock(&z_erofs_pcpu_worker_lock);
+
+	synchronize_rcu();
+	if (worker)
+		kthread_destroy_worker(worker);
+	return 0;
+}
+
+static int erofs_init_percpu_workers(void)
+{
+	int state;
+
+	z_erofs_pcpu_workers = kcalloc(nr_cpu_ids,
+			sizeof(struct kthread_worker *), GFP_KERNEL);
+	if (!z_erofs_pcpu_workers)
+		return -ENOMEM;
+
+	state = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "fs/erofs:online",
+				  erofs_cpu_online, erofs_cpu_offline);
+	if (state < 0) {
+		kfree(z_erofs_pcpu_workers);
+		return state;
+	}
+	erofs_cpuhp_state = state;
+	return 0;
+}
+
+static void erofs_destroy_percpu_workers(void)
+{
+	cpuhp_remove_state(erofs_cpuhp_state);
+	kfree(z_erofs_pcpu_workers);
+}
+#else
+static inline int erofs_init_percpu_workers(void) { return 0; }
+static inline void erofs_destroy_percpu_workers(void) {}
+#endif
+
 void z_erofs_exit_zip_subsystem(void)
 {
+	erofs_destroy_percpu_workers();
 	destroy_workqueue(z_erofs_workqueue);
 	z_erofs_destroy_pcluster_pool();
 }
@@ -145,7 +231,16 @@ int __init z_erofs_init_zip_subsystem(void)
 		return err;
 	err = z_erofs_init_workqueue();
 	if (err)
-		z_erofs_destroy_pcluster_pool();
+		goto out_destroy_pool;
+	err = erofs_init_percpu_workers();
+	if (err)
+		goto out_destroy_workqueue;
+	return 0;
+
+out_destroy_workqueue:
+	destroy_workqueue(z_erofs_workqueue);
+out_destroy_pool:
+	z_erofs_destroy_pcluster_pool();
 	return err;
 }
 
@@ -208,6 +303,8 @@ struct z_erofs_decompress_frontend {
 
 	struct z_erofs_collector clt;
 	struct erofs_map_blocks map;
+	/* cached decompressed data of the current extent, if any */
+	struct erofs_extcache_entry *ext;
 
 	bool readahead;
 	/* used for applying cache strategy on the fly */
@@ -656,7 +753,7 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 	if (offset + cur >= map->m_la &&
 	    offset + cur < map->m_la + map->m_llen) {
 		/* didn't get a valid collection previously (very rare) */
-		if (!clt->cl)
+		if (!clt->cl && !fe->ext)
 			goto restart_now;
 		goto hitted;
 	}
@@ -664,6 +761,8 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 	/* go ahead the next map_blocks */
 	erofs_dbg("%s: [out-of-range] pos %llu", __func__, offset + cur);
 
+	erofs_extcache_put(fe->ext);
+	fe->ext = NULL;
 	if (z_erofs_collector_end(clt))
 		fe->backmost = false;
 
@@ -677,6 +776,11 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 	if (!(map->m_flags & EROFS_MAP_MAPPED))
 		goto hitted;
 
+	/* no need to decompress at all if the extent is still cached */
+	fe->ext = erofs_extcache_get(sbi, map);
+	if (fe->ext)
+		goto hitted;
+
 	err = z_erofs_collector_begin(clt, inode, map);
 	if (err)
 		goto err_out;
@@ -706,6 +810,15 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 		goto next_part;
 	}
 
+	if (fe->ext) {
+		erofs_extcache_read(fe->ext, page, cur,
+				    offset + cur - map->m_la, end - cur);
+		/* the rest of this page cannot be used for inplace I/O */
+		tight = false;
+		++spiltted;
+		goto next_part;
+	}
+
 	/* let's derive page type */
 	page_type = cur ? Z_EROFS_VLE_PAGE_TYPE_HEAD :
 		(!spiltted ? Z_EROFS_PAGE_TYPE_EXCLUSIVE :
@@ -763,6 +876,55 @@ static int z_erofs_do_read_page(struct z_erofs_decompress_frontend *fe,
 }
 
 static void z_erofs_decompressqueue_work(struct work_struct *work);
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+static void z_erofs_decompressqueue_kthread_work(struct kthread_work *work);
+
+/*
+ * Prefer the bio completion CPU if it is idle: the worker bound to it starts
+ * running as soon as the interrupt returns, without a cross-CPU wakeup. Use
+ * another idle CPU otherwise, or the completion CPU if no CPU is idle.
+ * Must be called under rcu_read_lock().
+ */
+static struct kthread_worker *z_erofs_pick_pcpu_worker(void)
+{
+	unsigned int this_cpu = raw_smp_processor_id(), cpu;
+	struct kthread_worker *worker;
+
+	if (available_idle_cpu(this_cpu))
+		goto out;
+
+	for_each_online_cpu(cpu) {
+		if (cpu == this_cpu || !available_idle_cpu(cpu))
+			continue;
+		worker = rcu_dereference(z_erofs_pcpu_workers[cpu]);
+		if (worker)
+			return worker;
+	}
+out:
+	return rcu_dereference(z_erofs_pcpu_workers[this_cpu]);
+}
+
+static bool z_erofs_queue_pcpu_work(struct z_erofs_decompressqueue *io)
+{
+	struct kthread_worker *worker;
+
+	rcu_read_lock();
+	worker = z_erofs_pick_pcpu_worker();
+	if (worker) {
+		kthread_init_work(&io->u.kthread_work,
+				  z_erofs_decompressqueue_kthread_work);
+		kthread_queue_work(worker, &io->u.kthread_work);
+	}
+	rcu_read_unlock();
+	return worker;
+}
+#else
+static inline bool z_erofs_queue_pcpu_work(struct z_erofs_decompressqueue *io)
+{
+	return false;
+}
+#endif
+
 static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 				       bool sync, int bios)
 {
@@ -780,7 +942,8 @@ static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 		return;
 	/* Use workqueue and sync decompression for atomic contexts only */
 	if (in_atomic() || irqs_disabled()) {
-		queue_work(z_erofs_workqueue, &io->u.work);
+		if (!z_erofs_queue_pcpu_work(io))
+			queue_work(z_erofs_workqueue, &io->u.work);
 		sbi->opt.readahead_sync_decompress = true;
 		return;
 	}
@@ -830,7 +993,7 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 	struct page **pages, **compressed_pages, *page;
 
 	enum z_erofs_page_type page_type;
-	bool overlapped, partial;
+	bool overlapped, partial, cache_extent = false;
 	struct z_erofs_collection *cl;
 	int err;
 
@@ -841,6 +1004,18 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 	mutex_lock(&cl->lock);
 	nr_pages = cl->nr_pages;
 
+	/* decompress the whole extent if it's hot enough to be cached */
+	if (pcl->length & Z_EROFS_PCLUSTER_FULL_LENGTH) {
+		llen = pcl->length >> Z_EROFS_PCLUSTER_LENGTH_BIT;
+		i = PAGE_ALIGN(cl->pageofs + llen) >> PAGE_SHIFT;
+		if (i <= Z_EROFS_VMAP_GLOBAL_PAGES &&
+		    erofs_extcache_admit(sbi, pcl->obj.index,
+					 pcl->algorithmformat)) {
+			nr_pages = max(nr_pages, i);
+			cache_extent = true;
+		}
+	}
+
 	if (nr_pages <= Z_EROFS_VMAP_ONSTACK_PAGES) {
 		pages = pages_onstack;
 	} else if (nr_pages <= Z_EROFS_VMAP_GLOBAL_PAGES &&
@@ -949,6 +1124,18 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 	if (err)
 		goto out;
 
+	/* fill the gaps with short-lived pages to keep the whole extent */
+	for (i = 0; cache_extent && i < nr_pages; ++i) {
+		if (pages[i])
+			continue;
+		pages[i] = erofs_allocpage(pagepool, GFP_KERNEL | __GFP_NOWARN);
+		if (!pages[i]) {
+			cache_extent = false;
+			break;
+		}
+		set_page_private(pages[i], Z_EROFS_SHORTLIVED_PAGE);
+	}
+
 	llen = pcl->length >> Z_EROFS_PCLUSTER_LENGTH_BIT;
 	if (nr_pages << PAGE_SHIFT >= cl->pageofs + llen) {
 		outputsize = llen;
@@ -970,6 +1157,9 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 					.inplace_io = overlapped,
 					.partial_decoding = partial
 				 }, pagepool);
+	if (!err && cache_extent)
+		erofs_extcache_insert(sbi, pcl->obj.index, pages,
+				      cl->pageofs, llen);
 
 out:
 	/* must handle all compressed pages before ending pages */
@@ -1054,6 +1244,100 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	kvfree(bgq);
 }
 
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+static void z_erofs_decompressqueue_part_work(struct kthread_work *work)
+{
+	struct z_erofs_decompressqueue *part =
+		container_of(work, struct z_erofs_decompressqueue,
+			     u.kthread_work);
+	struct page *pagepool = NULL;
+
+	z_erofs_decompress_queue(part, &pagepool);
+
+	erofs_release_pages(&pagepool);
+	kfree(part);
+}
+
+/*
+ * Pclusters chained in one queue are independent of each other, so hand all
+ * but the first share of them to the workers of other idle CPUs rather than
+ * decompressing the whole queue on this CPU one by one.
+ */
+static void z_erofs_fanout_queue(struct z_erofs_decompressqueue *q)
+{
+	struct kthread_worker *workers[Z_EROFS_FANOUT_MAX - 1];
+	struct z_erofs_decompressqueue *parts[Z_EROFS_FANOUT_MAX - 1];
+	unsigned int this_cpu = raw_smp_processor_id();
+	unsigned int nr = 0, nr_workers = 0, nr_parts, per_part, cpu, i;
+	z_erofs_next_pcluster_t owned;
+	struct z_erofs_pcluster *pcl;
+
+	for (owned = q->head; owned != Z_EROFS_PCLUSTER_TAIL_CLOSED; ++nr) {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
+	}
+	if (nr < 2)
+		return;
+
+	rcu_read_lock();
+	for_each_online_cpu(cpu) {
+		if (nr_workers == ARRAY_SIZE(workers) || nr_workers + 1 >= nr)
+			break;
+		if (cpu == this_cpu || !available_idle_cpu(cpu))
+			continue;
+		workers[nr_workers] = rcu_dereference(z_erofs_pcpu_workers[cpu]);
+		if (workers[nr_workers])
+			++nr_workers;
+	}
+
+	per_part = DIV_ROUND_UP(nr, nr_workers + 1);
+	owned = q->head;
+	for (nr_parts = 0; nr_parts < nr_workers; ++nr_parts) {
+		/* skip the share of the previous part */
+		for (i = 0; i < per_part; ++i) {
+			pcl = container_of(owned, struct z_erofs_pcluster, next);
+			owned = READ_ONCE(pcl->next);
+			if (owned == Z_EROFS_PCLUSTER_TAIL_CLOSED)
+				break;
+		}
+		if (owned == Z_EROFS_PCLUSTER_TAIL_CLOSED)
+			break;
+
+		parts[nr_parts] = kmalloc(sizeof(*parts[nr_parts]),
+					  GFP_NOWAIT | __GFP_NOWARN);
+		if (!parts[nr_parts])
+			break;
+
+		/* @pcl is the last pcluster of the previous part */
+		WRITE_ONCE(pcl->next, Z_EROFS_PCLUSTER_TAIL_CLOSED);
+		parts[nr_parts]->sb = q->sb;
+		parts[nr_parts]->head = owned;
+		kthread_init_work(&parts[nr_parts]->u.kthread_work,
+				  z_erofs_decompressqueue_part_work);
+	}
+
+	/* a queued part can be decompressed and freed at once, cut all first */
+	for (i = 0; i < nr_parts; ++i)
+		kthread_queue_work(workers[i], &parts[i]->u.kthread_work);
+	rcu_read_unlock();
+}
+
+static void z_erofs_decompressqueue_kthread_work(struct kthread_work *work)
+{
+	struct z_erofs_decompressqueue *bgq =
+		container_of(work, struct z_erofs_decompressqueue,
+			     u.kthread_work);
+	struct page *pagepool = NULL;
+
+	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL_CLOSED);
+	z_erofs_fanout_queue(bgq);
+	z_erofs_decompress_queue(bgq, &pagepool);
+
+	erofs_release_pages(&pagepool);
+	kvfree(bgq);
+}
+#endif
+
 static struct page *pickup_page_for_submission(struct z_erofs_pcluster *pcl,
 					       unsigned int nr,
 					       struct page **pagepool,
@@ -1375,6 +1659,7 @@ static int z_erofs_readpage(struct file *file, struct page *page)
 	f.headoffset = (erofs_off_t)page->index << PAGE_SHIFT;
 
 	err = z_erofs_do_read_page(&f, page, &pagepool);
+	erofs_extcache_put(f.ext);
 	(void)z_erofs_collector_end(&f.clt);
 
 	/* if some compressed cluster ready, need submit them anyway */
@@ -1435,6 +1720,7 @@ static void z_erofs_readahead(struct readahead_control *rac)
 		put_page(page);
 	}
 
+	erofs_extcache_put(f.ext);
 	(void)z_erofs_collector_end(&f.clt);
 
 	z_erofs_runqueue(inode->i_sb, &f, &pagepool, sync);
@@ -1421,7 +1421,8 @@ void f2fs_compress_write_end_io(struct bio *bio, struct page *page)
 static int f2fs_write_raw_pages(struct compress_ctx *cc,
 					int *submitted,
 					struct writeback_control *wbc,
-					enum iostat_type io_type)
+					enum iostat_type io_type,
+					bool balance)
 {
 	struct address_space *mapping = cc->inode->i_mapping;
 	int _submitted, compr_blocks, ret, i;
@@ -1482,45 +1483,164 @@ static int f2fs_write_raw_pages(struct compress_ctx *cc,
 		*submitted += _submitted;
 	}
 
-	f2fs_balance_fs(F2FS_M_SB(mapping), true);
+	if (balance)
+		f2fs_balance_fs(F2FS_M_SB(mapping), true);
 
 	return 0;
 }
 
-int f2fs_write_multi_pages(struct compress_ctx *cc,
+/*
+ * Write out a cluster after compression returned @err, falling back to raw
+ * pages if it didn't compress well or the compressed write can't proceed.
+ * -EAGAIN means the cluster wasn't compressed at all. @balance must be false
+ * while other clusters are still locked by us, as checkpointing from
+ * f2fs_balance_fs() would wait on them.
+ */
+static int f2fs_write_cluster(struct compress_ctx *cc, int err,
 					int *submitted,
 					struct writeback_control *wbc,
-					enum iostat_type io_type)
+					enum iostat_type io_type,
+					bool balance)
 {
-	int err;
-
 	*submitted = 0;
-	if (cluster_may_compress(cc)) {
-		err = f2fs_compress_pages(cc);
-		if (err == -EAGAIN) {
-			add_compr_block_stat(cc->inode, cc->cluster_size);
-			goto write;
-		} else if (err) {
-			f2fs_put_rpages_wbc(cc, wbc, true, 1);
-			goto destroy_out;
-		}
-
+	if (!err) {
 		err = f2fs_write_compressed_pages(cc, submitted,
 							wbc, io_type);
 		if (!err)
 			return 0;
 		f2fs_bug_on(F2FS_I_SB(cc->inode), err != -EAGAIN);
+	} else if (err != -EAGAIN) {
+		f2fs_put_rpages_wbc(cc, wbc, true, 1);
+		goto destroy_out;
 	}
-write:
+
 	f2fs_bug_on(F2FS_I_SB(cc->inode), *submitted);
 
-	err = f2fs_write_raw_pages(cc, submitted, wbc, io_type);
+	err = f2fs_write_raw_pages(cc, submitted, wbc, io_type, balance);
 	f2fs_put_rpages_wbc(cc, wbc, false, 0);
 destroy_out:
 	f2fs_destroy_compress_ctx(cc, false);
 	return err;
 }
 
+static void f2fs_compress_work(struct work_struct *work)
+{
+	struct compress_work *cw = container_of(work,
+					struct compress_work, work);
+
+	cw->err = f2fs_compress_pages(&cw->cc);
+	complete(&cw->done);
+}
+
+/*
+ * Hand the cluster in @cc over to f2fs_compress_wq. The work takes over the
+ * locked pages of the cluster and @cc is left empty for the next one.
+ */
+static int f2fs_queue_compress_work(struct compress_ctx *cc)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(cc->inode);
+	struct compress_work *cw;
+
+	cw = f2fs_kmalloc(sbi, sizeof(*cw), GFP_NOFS);
+	if (!cw)
+		return -ENOMEM;
+
+	cw->cc = *cc;
+	cw->cc.works = NULL;
+	cw->cc.nr_works = 0;
+	init_completion(&cw->done);
+	INIT_WORK(&cw->work, f2fs_compress_work);
+
+	list_add_tail(&cw->list, cc->works);
+	cc->nr_works++;
+	queue_work(sbi->compress_wq, &cw->work);
+
+	cc->rpages = NULL;
+	f2fs_destroy_compress_ctx(cc, false);
+	return 0;
+}
+
+/*
+ * Write out the clusters in asynchronous compression, oldest first, until
+ * at most @max of them are left. All of them are written out even if one
+ * fails, and the first error is returned. The fs is only balanced after the
+ * last of them, and only if @cc holds no pages either.
+ */
+int f2fs_flush_compress_works(struct compress_ctx *cc, unsigned int max,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	int nr, ret, err = 0;
+
+	*submitted = 0;
+	while (cc->nr_works > max) {
+		struct compress_work *cw = list_first_entry(cc->works,
+					struct compress_work, list);
+
+		wait_for_completion(&cw->done);
+		list_del(&cw->list);
+		cc->nr_works--;
+
+		if (cw->err == -EAGAIN)
+			add_compr_block_stat(cw->cc.inode, cw->cc.cluster_size);
+		ret = f2fs_write_cluster(&cw->cc, cw->err, &nr, wbc, io_type,
+				!cc->nr_works && f2fs_cluster_is_empty(cc));
+		*submitted += nr;
+		if (ret && !err)
+			err = ret;
+		kfree(cw);
+	}
+	return err;
+}
+
+int f2fs_write_multi_pages(struct compress_ctx *cc,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	bool may_compress = cluster_may_compress(cc);
+	int nr, err, flush_err = 0;
+
+	*submitted = 0;
+	if (cc->works) {
+		unsigned int limit =
+			READ_ONCE(F2FS_I_SB(cc->inode)->compress_inflight);
+		bool async = may_compress && limit;
+
+		/*
+		 * Keep the clusters in file order on disk. An error writing
+		 * out an older cluster doesn't stop this one from being
+		 * written, it is only reported once this one is done.
+		 */
+		flush_err = f2fs_flush_compress_works(cc,
+						async ? limit - 1 : 0,
+						submitted, wbc, io_type);
+		if (async && !f2fs_queue_compress_work(cc))
+			return flush_err;
+
+		/* no other cluster may stay locked while writing this one */
+		if (cc->nr_works) {
+			err = f2fs_flush_compress_works(cc, 0, &nr,
+							wbc, io_type);
+			*submitted += nr;
+			if (!flush_err)
+				flush_err = err;
+		}
+	}
+
+	err = -EAGAIN;
+	if (may_compress) {
+		err = f2fs_compress_pages(cc);
+		if (err == -EAGAIN)
+			add_compr_block_stat(cc->inode, cc->cluster_size);
+	}
+
+	err = f2fs_write_cluster(cc, err, &nr, wbc, io_type, true);
+	*submitted += nr;
+	return err ? err : flush_err;
+}
+
 static inline bool allow_memalloc_for_decomp(struct f2fs_sb_info *sbi,
 		bool pre_alloc)
 {
@@ -1991,6 +2111,27 @@ void f2fs_destroy_page_array_cache(struct f2fs_sb_info *sbi)
 	kmem_cache_destroy(sbi->page_array_slab);
 }
 
+int f2fs_init_compress_wq(struct f2fs_sb_info *sbi)
+{
+	sbi->compress_inflight = DEF_COMPRESS_INFLIGHT;
+
+	if (!f2fs_sb_has_compression(sbi))
+		return 0;
+
+	sbi->compress_wq = alloc_workqueue("f2fs_compress_wq",
+					   WQ_UNBOUND | WQ_MEM_RECLAIM,
+					   num_online_cpus());
+	if (!sbi->compress_wq)
+		return -ENOMEM;
+	return 0;
+}
+
+void f2fs_destroy_compress_wq(struct f2fs_sb_info *sbi)
+{
+	if (sbi->compress_wq)
+		destroy_workqueue(sbi->compress_wq);
+}
+
 static int __init f2fs_init_cic_cache(void)
 {
 	cic_entry_slab = f2fs_kmem_cache_create("f2fs_cic_entry",
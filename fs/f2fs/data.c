@@ -1439,7 +1439,9 @@ int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 	unsigned int maxblocks = map->m_len;
 	struct dnode_of_data dn;
 	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
-	int mode = map->m_may_create ? ALLOC_NODE : LOOKUP_NODE;
+	/* no-wait writes are overwrites, see f2fs_overwrite_io() */
+	int mode = map->m_nowait ? LOOKUP_NODE_NOWAIT :
+		(map->m_may_create ? ALLOC_NODE : LOOKUP_NODE);
 	pgoff_t pgofs, end_offset, end;
 	int err = 0, ofs = 1;
 	unsigned int ofs_in_node, last_ofs_in_node;
@@ -1475,9 +1477,13 @@ int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 			*map->m_next_extent = pgofs + map->m_len;
 
 		/* for hardware encryption, but to avoid potential issue in future */
-		if (flag == F2FS_GET_BLOCK_DIO)
+		if (flag == F2FS_GET_BLOCK_DIO && !map->m_nowait)
 			f2fs_wait_on_block_writeback_range(inode,
 						map->m_pblk, map->m_len);
+		else if (flag == F2FS_GET_BLOCK_DIO &&
+				f2fs_block_writeback_range_busy(inode,
+						map->m_pblk, map->m_len))
+			err = -EAGAIN;
 
 		if (map->m_multidev_dio) {
 			block_t blk_addr = map->m_pblk;
@@ -1497,8 +1503,14 @@ int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 	}
 
 next_dnode:
-	if (map->m_may_create)
+	if (map->m_may_create && map->m_nowait) {
+		if (!f2fs_trylock_op(sbi)) {
+			err = -EAGAIN;
+			goto out;
+		}
+	} else if (map->m_may_create) {
 		f2fs_do_map_lock(sbi, flag, true);
+	}
 
 	/* When reading holes, we need its node page */
 	set_new_dnode(&dn, inode, NULL, NULL, 0);
@@ -1521,6 +1533,12 @@ int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 				goto unlock_out;
 			}
 
+			/* the overwrite turned into a hole under us */
+			if (map->m_may_create && map->m_nowait) {
+				err = -EAGAIN;
+				goto unlock_out;
+			}
+
 			err = 0;
 			if (map->m_next_pgofs)
 				*map->m_next_pgofs =
@@ -1676,6 +1694,10 @@ int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 		}
 	}
 
+	/* don't lose what is mapped if the next dnode would block */
+	if (map->m_nowait)
+		goto sync_out;
+
 	f2fs_put_dnode(&dn);
 
 	if (map->m_may_create) {
@@ -1691,8 +1713,12 @@ int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 		 * for hardware encryption, but to avoid potential issue
 		 * in future
 		 */
-		f2fs_wait_on_block_writeback_range(inode,
+		if (!map->m_nowait)
+			f2fs_wait_on_block_writeback_range(inode,
 						map->m_pblk, map->m_len);
+		else if (!err && f2fs_block_writeback_range_busy(inode,
+						map->m_pblk, map->m_len))
+			err = -EAGAIN;
 		invalidate_mapping_pages(META_MAPPING(sbi),
 						map->m_pblk, map->m_pblk);
 
@@ -1728,7 +1754,9 @@ int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 unlock_out:
 	if (map->m_may_create) {
 		f2fs_do_map_lock(sbi, flag, false);
-		f2fs_balance_fs(sbi, dn.node_changed);
+		/* foreground GC can block, leave it to the next writer */
+		if (!map->m_nowait)
+			f2fs_balance_fs(sbi, dn.node_changed);
 	}
 out:
 	trace_f2fs_map_blocks(inode, map, create, flag, err);
@@ -1749,6 +1777,8 @@ bool f2fs_overwrite_io(struct inode *inode, loff_t pos, size_t len)
 	map.m_next_extent = NULL;
 	map.m_seg_type = NO_CHECK_TYPE;
 	map.m_may_create = false;
+	/* only used by IOCB_NOWAIT writes */
+	map.m_nowait = true;
 	last_lblk = F2FS_BLK_ALIGN(pos + len);
 
 	while (map.m_lblk < last_lblk) {
@@ -2342,6 +2372,7 @@ static int f2fs_mpage_readpages(struct inode *inode,
 	map.m_next_extent = NULL;
 	map.m_seg_type = NO_CHECK_TYPE;
 	map.m_may_create = false;
+	map.m_nowait = false;
 
 	for (; nr_pages; nr_pages--) {
 		if (rac) {
@@ -2942,7 +2973,10 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 		.cbuf = NULL,
 		.rlen = PAGE_SIZE * F2FS_I(inode)->i_cluster_size,
 		.private = NULL,
+		.works = NULL,
+		.nr_works = 0,
 	};
+	LIST_HEAD(compress_works);
 #endif
 	int nr_pages;
 	pgoff_t index;
@@ -2975,6 +3009,12 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 		tag = PAGECACHE_TAG_TOWRITE;
 	else
 		tag = PAGECACHE_TAG_DIRTY;
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	/* quota writes stay synchronous, see f2fs_write_raw_pages() */
+	if (f2fs_compressed_file(inode) && sbi->compress_wq &&
+						!IS_NOQUOTA(inode))
+		cc.works = &compress_works;
+#endif
 retry:
 	retry = 0;
 	if (wbc->sync_mode == WB_SYNC_ALL || wbc->tagged_writepages)
@@ -3133,6 +3173,19 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 			retry = 0;
 		}
 	}
+	/* wait for the clusters still being compressed and write them */
+	if (cc.nr_works) {
+		int err = f2fs_flush_compress_works(&cc, 0, &submitted,
+							wbc, io_type);
+
+		nwritten += submitted;
+		wbc->nr_to_write -= submitted;
+		if (err && !ret) {
+			ret = err;
+			done = 1;
+			retry = 0;
+		}
+	}
 	if (f2fs_compressed_file(inode))
 		f2fs_destroy_compress_ctx(&cc, false);
 #endif
@@ -4110,6 +4163,8 @@ static int f2fs_iomap_begin(struct inode *inode, loff_t offset, loff_t length,
 	map.m_seg_type = f2fs_rw_hint_to_seg_type(inode->i_write_hint);
 	if (flags & IOMAP_WRITE)
 		map.m_may_create = true;
+	if (flags & IOMAP_NOWAIT)
+		map.m_nowait = true;
 
 	err = f2fs_map_blocks(inode, &map, flags & IOMAP_WRITE,
 			      F2FS_GET_BLOCK_DIO);
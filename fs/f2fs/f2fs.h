@@ -572,6 +572,10 @@ enum {
 					 * look up a node with readahead called
 					 * by get_data_block.
 					 */
+	LOOKUP_NODE_NOWAIT,		/*
+					 * look up a node only if it is cached,
+					 * -EAGAIN otherwise.
+					 */
 };
 
 #define DEFAULT_RETRY_IO_COUNT	8	/* maximum retry read IO or flush count */
@@ -661,6 +665,7 @@ struct f2fs_map_blocks {
 	int m_seg_type;
 	bool m_may_create;		/* indicate it is from write path */
 	bool m_multidev_dio;		/* indicate it allows multi-device dio */
+	bool m_nowait;			/* -EAGAIN instead of blocking */
 };
 
 /* for flag in get_data_block */
@@ -1511,6 +1516,10 @@ enum compress_flag {
 #define	COMPRESS_WATERMARK			20
 #define	COMPRESS_PERCENT			20
 
+/* clusters of one writeback being compressed by f2fs_compress_wq */
+#define DEF_COMPRESS_INFLIGHT			8
+#define MAX_COMPRESS_INFLIGHT			64
+
 #define COMPRESS_DATA_RESERVED_SIZE		4
 struct compress_data {
 	__le32 clen;			/* compressed data size */
@@ -1542,6 +1551,17 @@ struct compress_ctx {
 	size_t clen;			/* valid data length in cbuf */
 	void *private;			/* payload buffer for specified compression algorithm */
 	void *private2;			/* extra payload buffer */
+	struct list_head *works;	/* clusters in asynchronous compression */
+	unsigned int nr_works;		/* # of clusters in works */
+};
+
+/* cluster compressed by f2fs_compress_wq during writeback */
+struct compress_work {
+	struct list_head list;		/* works of the writeback, in file order */
+	struct work_struct work;
+	struct completion done;		/* compression has finished */
+	int err;			/* result of compression */
+	struct compress_ctx cc;		/* the cluster, owning its rpages */
 };
 
 /* compress context for write IO path */
@@ -1836,6 +1856,10 @@ struct f2fs_sb_info {
 	u64 compr_saved_block;
 	u32 compr_new_inode;
 
+	/* For asynchronous compression in writeback */
+	struct workqueue_struct *compress_wq;	/* compression workqueue */
+	unsigned int compress_inflight;		/* max clusters in compression */
+
 	/* For compressed block cache */
 	struct inode *compress_inode;		/* cache compressed blocks */
 	unsigned int compress_percent;		/* cache page percentage */
@@ -1855,6 +1879,9 @@ struct f2fs_sb_info {
 	/* For io latency related statistics info in one iostat period */
 	spinlock_t iostat_lat_lock;
 	struct iostat_lat_info *iostat_io_lat;
+
+	/* For per-uid/inode io statistics */
+	struct iostat_owner_info *iostat_owners;
 #endif
 };
 
@@ -3566,6 +3593,7 @@ struct page *f2fs_new_node_page(struct dnode_of_data *dn, unsigned int ofs);
 void f2fs_ra_node_page(struct f2fs_sb_info *sbi, nid_t nid);
 struct page *f2fs_get_node_page(struct f2fs_sb_info *sbi, pgoff_t nid);
 struct page *f2fs_get_node_page_ra(struct page *parent, int start);
+struct page *f2fs_get_node_page_nowait(struct f2fs_sb_info *sbi, pgoff_t nid);
 int f2fs_move_node_page(struct page *node_page, int gc_type);
 void f2fs_flush_inline_data(struct f2fs_sb_info *sbi);
 int f2fs_fsync_node_pages(struct f2fs_sb_info *sbi, struct inode *inode,
@@ -3660,6 +3688,8 @@ void f2fs_wait_on_page_writeback(struct page *page,
 void f2fs_wait_on_block_writeback(struct inode *inode, block_t blkaddr);
 void f2fs_wait_on_block_writeback_range(struct inode *inode, block_t blkaddr,
 								block_t len);
+bool f2fs_block_writeback_range_busy(struct inode *inode, block_t blkaddr,
+								block_t len);
 void f2fs_write_data_summaries(struct f2fs_sb_info *sbi, block_t start_blk);
 void f2fs_write_node_summaries(struct f2fs_sb_info *sbi, block_t start_blk);
 int f2fs_lookup_journal_in_cursum(struct f2fs_journal *journal, int type,
@@ -4214,6 +4244,10 @@ int f2fs_write_multi_pages(struct compress_ctx *cc,
 						int *submitted,
 						struct writeback_control *wbc,
 						enum iostat_type io_type);
+int f2fs_flush_compress_works(struct compress_ctx *cc, unsigned int max,
+						int *submitted,
+						struct writeback_control *wbc,
+						enum iostat_type io_type);
 int f2fs_is_compressed_cluster(struct inode *inode, pgoff_t index);
 void f2fs_update_extent_tree_range_compressed(struct inode *inode,
 				pgoff_t fofs, block_t blkaddr, unsigned int llen,
@@ -4233,6 +4267,8 @@ int f2fs_init_compress_inode(struct f2fs_sb_info *sbi);
 void f2fs_destroy_compress_inode(struct f2fs_sb_info *sbi);
 int f2fs_init_page_array_cache(struct f2fs_sb_info *sbi);
 void f2fs_destroy_page_array_cache(struct f2fs_sb_info *sbi);
+int f2fs_init_compress_wq(struct f2fs_sb_info *sbi);
+void f2fs_destroy_compress_wq(struct f2fs_sb_info *sbi);
 int __init f2fs_init_compress_cache(void);
 void f2fs_destroy_compress_cache(void);
 struct address_space *COMPRESS_MAPPING(struct f2fs_sb_info *sbi);
@@ -4287,6 +4323,8 @@ static inline int f2fs_init_compress_inode(struct f2fs_sb_info *sbi) { return 0;
 static inline void f2fs_destroy_compress_inode(struct f2fs_sb_info *sbi) { }
 static inline int f2fs_init_page_array_cache(struct f2fs_sb_info *sbi) { return 0; }
 static inline void f2fs_destroy_page_array_cache(struct f2fs_sb_info *sbi) { }
+static inline int f2fs_init_compress_wq(struct f2fs_sb_info *sbi) { return 0; }
+static inline void f2fs_destroy_compress_wq(struct f2fs_sb_info *sbi) { }
 static inline int __init f2fs_init_compress_cache(void) { return 0; }
 static inline void f2fs_destroy_compress_cache(void) { }
 static inline void f2fs_invalidate_compress_page(struct f2fs_sb_info *sbi,
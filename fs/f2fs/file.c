@@ -3342,6 +3342,7 @@ int f2fs_precache_extents(struct inode *inode)
 	map.m_next_extent = &m_next_extent;
 	map.m_seg_type = NO_CHECK_TYPE;
 	map.m_may_create = false;
+	map.m_nowait = false;
 	end = max_file_blocks(inode);
 
 	while (map.m_lblk < end) {
@@ -5000,4 +5001,5 @@ const struct file_operations f2fs_file_operations = {
 	.splice_read	= generic_file_splice_read,
 	.splice_write	= iter_file_splice_write,
 	.fadvise	= f2fs_file_fadvise,
+	.iopoll		= iomap_dio_iopoll,
 };
@@ -643,6 +643,69 @@ static void release_victim_entry(struct f2fs_sb_info *sbi)
 	f2fs_bug_on(sbi, !list_empty(&am->victim_list));
 }
 
+static bool victim_index_usable(struct f2fs_sb_info *sbi,
+				struct victim_sel_policy *p)
+{
+	if (p->alloc_mode != LFS)
+		return false;
+	if (p->gc_mode != GC_GREEDY && p->gc_mode != GC_CB)
+		return false;
+	/* checkpointed data and random selection need the full scan */
+	if (unlikely(is_sbi_flag_set(sbi, SBI_CP_DISABLED)))
+		return false;
+	return !f2fs_need_rand_seg(sbi);
+}
+
+/*
+ * Visit dirty sections from the least valid ones up. For GC_GREEDY, the
+ * first usable section is the victim as soon as nothing in a later bucket
+ * can be cheaper; GC_CB still weighs in the age of up to max_search of the
+ * least valid sections.
+ */
+static void lookup_victim_by_index(struct f2fs_sb_info *sbi,
+			struct victim_sel_policy *p, int gc_type)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	unsigned int nsearched = 0;
+	unsigned int bucket;
+
+	for (bucket = 0; bucket < NR_VICTIM_BUCKETS; bucket++) {
+		struct list_head *pos;
+
+		list_for_each(pos, &dirty_i->victim_buckets[bucket]) {
+			unsigned int secno = pos - dirty_i->victim_list;
+			unsigned int segno = GET_SEG_FROM_SEC(sbi, secno);
+			unsigned long cost;
+
+			nsearched++;
+#ifdef CONFIG_F2FS_CHECK_FS
+			if (test_bit(segno, SIT_I(sbi)->invalid_segmap))
+				goto next;
+#endif
+			if (sec_usage_check(sbi, secno))
+				goto next;
+			if (gc_type == BG_GC &&
+					test_bit(secno, dirty_i->victim_secmap))
+				goto next;
+
+			cost = get_gc_cost(sbi, segno, p);
+			if (p->min_cost > cost) {
+				p->min_segno = segno;
+				p->min_cost = cost;
+			}
+			if (p->gc_mode == GC_GREEDY &&
+				cost <= (bucket << dirty_i->victim_bucket_shift))
+				return;
+next:
+			if (nsearched >= p->max_search)
+				return;
+		}
+
+		if (p->gc_mode == GC_GREEDY && p->min_segno != NULL_SEGNO)
+			return;
+	}
+}
+
 /*
  * This function is called from two paths.
  * One is garbage collection and the other is SSR segment selection.
@@ -723,6 +786,13 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			goto got_it;
 	}
 
+	if (victim_index_usable(sbi, &p)) {
+		lookup_victim_by_index(sbi, &p, gc_type);
+		if (p.min_segno != NULL_SEGNO)
+			goto got_it;
+		goto out;
+	}
+
 	while (1) {
 		unsigned long cost, *dirty_bitmap;
 		unsigned int unit_no, segno;
@@ -8,7 +8,9 @@
 
 #include <linux/fs.h>
 #include <linux/f2fs_fs.h>
+#include <linux/hashtable.h>
 #include <linux/seq_file.h>
+#include <uapi/linux/f2fs.h>
 
 #include "f2fs.h"
 #include "iostat.h"
@@ -18,6 +20,37 @@
 static struct kmem_cache *bio_iostat_ctx_cache;
 static mempool_t *bio_iostat_ctx_pool;
 
+#define IOSTAT_OWNER_HASH_BITS		6
+#define IOSTAT_OWNER_ENTRIES		64	/* per owner type */
+
+struct iostat_owner {
+	struct hlist_node hnode;
+	struct f2fs_iostat_owner_entry stat;
+};
+
+struct iostat_owner_table {
+	DECLARE_HASHTABLE(hash, IOSTAT_OWNER_HASH_BITS);
+	struct iostat_owner owners[IOSTAT_OWNER_ENTRIES];
+	unsigned int nr;
+};
+
+struct iostat_owner_snapshot {
+	struct f2fs_iostat_owners_header hdr;
+	struct f2fs_iostat_owner_entry entries[F2FS_IOSTAT_NR_OWNER_TYPES *
+					       IOSTAT_OWNER_ENTRIES];
+};
+
+struct iostat_owner_info {
+	spinlock_t lock;		/* protects tables and nr_evicted */
+	struct iostat_owner_table tables[F2FS_IOSTAT_NR_OWNER_TYPES];
+	u64 nr_evicted;
+
+	/* taken when the sysfs file is read from offset 0 */
+	struct mutex snapshot_lock;
+	size_t snapshot_size;
+	struct iostat_owner_snapshot snapshot;
+};
+
 int __maybe_unused iostat_info_seq_show(struct seq_file *seq, void *offset)
 {
 	struct super_block *sb = seq->private;
@@ -85,6 +118,41 @@ int __maybe_unused iostat_info_seq_show(struct seq_file *seq, void *offset)
 	return 0;
 }
 
+ssize_t f2fs_read_iostat_owners(struct f2fs_sb_info *sbi, char *buf,
+			loff_t off, size_t count)
+{
+	struct iostat_owner_info *oi = sbi->iostat_owners;
+	struct iostat_owner_snapshot *snap = &oi->snapshot;
+	unsigned int type, i, nr = 0;
+
+	mutex_lock(&oi->snapshot_lock);
+	if (!off) {
+		spin_lock_irq(&oi->lock);
+		for (type = 0; type < F2FS_IOSTAT_NR_OWNER_TYPES; type++)
+			for (i = 0; i < oi->tables[type].nr; i++)
+				snap->entries[nr++] =
+					oi->tables[type].owners[i].stat;
+		snap->hdr.nr_evicted = oi->nr_evicted;
+		spin_unlock_irq(&oi->lock);
+
+		snap->hdr.magic = F2FS_IOSTAT_OWNERS_MAGIC;
+		snap->hdr.version = F2FS_IOSTAT_OWNERS_VERSION;
+		snap->hdr.nr_entries = nr;
+		snap->hdr.nr_buckets = F2FS_IOSTAT_OWNER_NR_BUCKETS;
+		oi->snapshot_size = offsetof(struct iostat_owner_snapshot,
+					entries) + nr * sizeof(snap->entries[0]);
+	}
+
+	if (off >= oi->snapshot_size) {
+		count = 0;
+	} else {
+		count = min_t(size_t, count, oi->snapshot_size - off);
+		memcpy(buf, (char *)snap + off, count);
+	}
+	mutex_unlock(&oi->snapshot_lock);
+	return count;
+}
+
 static inline void __record_iostat_latency(struct f2fs_sb_info *sbi)
 {
 	int io, idx = 0;
@@ -145,6 +213,7 @@ static inline void f2fs_record_iostat(struct f2fs_sb_info *sbi)
 void f2fs_reset_iostat(struct f2fs_sb_info *sbi)
 {
 	struct iostat_lat_info *io_lat = sbi->iostat_io_lat;
+	struct iostat_owner_info *oi = sbi->iostat_owners;
 	int i;
 
 	spin_lock_irq(&sbi->iostat_lock);
@@ -157,6 +226,14 @@ void f2fs_reset_iostat(struct f2fs_sb_info *sbi)
 	spin_lock_irq(&sbi->iostat_lat_lock);
 	memset(io_lat, 0, sizeof(struct iostat_lat_info));
 	spin_unlock_irq(&sbi->iostat_lat_lock);
+
+	spin_lock_irq(&oi->lock);
+	for (i = 0; i < F2FS_IOSTAT_NR_OWNER_TYPES; i++) {
+		hash_init(oi->tables[i].hash);
+		oi->tables[i].nr = 0;
+	}
+	oi->nr_evicted = 0;
+	spin_unlock_irq(&oi->lock);
 }
 
 void f2fs_update_iostat(struct f2fs_sb_info *sbi,
@@ -181,6 +258,71 @@ void f2fs_update_iostat(struct f2fs_sb_info *sbi,
 	f2fs_record_iostat(sbi);
 }
 
+static struct f2fs_iostat_owner_entry *iostat_owner_get(
+		struct iostat_owner_info *oi, unsigned int type, u32 id, u32 uid)
+{
+	struct iostat_owner_table *table = &oi->tables[type];
+	struct iostat_owner *owner, *victim;
+	int i, io;
+
+	hash_for_each_possible(table->hash, owner, hnode, id)
+		if (owner->stat.id == id)
+			return &owner->stat;
+
+	if (table->nr < IOSTAT_OWNER_ENTRIES) {
+		owner = &table->owners[table->nr++];
+	} else {
+		u64 min_bytes = U64_MAX;
+
+		/* replace the owner with the least I/O to keep the top ones */
+		for (i = 0; i < IOSTAT_OWNER_ENTRIES; i++) {
+			u64 bytes = 0;
+
+			victim = &table->owners[i];
+			for (io = 0; io < F2FS_IOSTAT_OWNER_NR_IO; io++)
+				bytes += victim->stat.bytes[io];
+			if (bytes < min_bytes) {
+				min_bytes = bytes;
+				owner = victim;
+			}
+		}
+		hash_del(&owner->hnode);
+		oi->nr_evicted++;
+	}
+
+	memset(&owner->stat, 0, sizeof(owner->stat));
+	owner->stat.type = type;
+	owner->stat.id = id;
+	owner->stat.uid = uid;
+	hash_add(table->hash, &owner->hnode, id);
+	return &owner->stat;
+}
+
+static void __update_iostat_owners(struct bio_iostat_ctx *iostat_ctx, int idx)
+{
+	struct iostat_owner_info *oi = iostat_ctx->sbi->iostat_owners;
+	u64 us = div_u64(ktime_get_ns() - iostat_ctx->submit_ns,
+			 NSEC_PER_USEC);
+	unsigned int bucket = min_t(unsigned int, fls64(us),
+				    F2FS_IOSTAT_OWNER_NR_BUCKETS - 1);
+	struct f2fs_iostat_owner_entry *stat;
+	unsigned long flags;
+
+	BUILD_BUG_ON(MAX_IO_TYPE != F2FS_IOSTAT_OWNER_NR_IO);
+
+	spin_lock_irqsave(&oi->lock, flags);
+	stat = iostat_owner_get(oi, F2FS_IOSTAT_OWNER_UID,
+				iostat_ctx->uid, iostat_ctx->uid);
+	stat->bytes[idx] += iostat_ctx->bytes;
+	stat->lat[idx][bucket]++;
+
+	stat = iostat_owner_get(oi, F2FS_IOSTAT_OWNER_INO,
+				iostat_ctx->ino, iostat_ctx->uid);
+	stat->bytes[idx] += iostat_ctx->bytes;
+	stat->lat[idx][bucket]++;
+	spin_unlock_irqrestore(&oi->lock, flags);
+}
+
 static inline void __update_iostat_latency(struct bio_iostat_ctx *iostat_ctx,
 				int rw, bool is_sync)
 {
@@ -213,6 +355,28 @@ static inline void __update_iostat_latency(struct bio_iostat_ctx *iostat_ctx,
 	if (ts_diff > io_lat->peak_lat[idx][iotype])
 		io_lat->peak_lat[idx][iotype] = ts_diff;
 	spin_unlock_irqrestore(&sbi->iostat_lat_lock, flags);
+
+	if (iostat_ctx->bytes)
+		__update_iostat_owners(iostat_ctx, idx);
+}
+
+void __iostat_bind_owner(struct bio_iostat_ctx *iostat_ctx, struct bio *bio)
+{
+	struct page *page = bio_first_page_all(bio);
+	struct inode *inode;
+
+	if (page_private_dummy(page))
+		return;
+	if (fscrypt_is_bounce_page(page))
+		page = fscrypt_pagecache_page(page);
+	if (!page->mapping)
+		return;
+
+	inode = page->mapping->host;
+	iostat_ctx->submit_ns = ktime_get_ns();
+	iostat_ctx->uid = from_kuid(&init_user_ns, inode->i_uid);
+	iostat_ctx->ino = inode->i_ino;
+	iostat_ctx->bytes = bio->bi_iter.bi_size;
 }
 
 void iostat_update_and_unbind_ctx(struct bio *bio, int rw)
@@ -238,6 +402,7 @@ void iostat_alloc_and_bind_ctx(struct f2fs_sb_info *sbi,
 	iostat_ctx->submit_ts = 0;
 	iostat_ctx->type = 0;
 	iostat_ctx->post_read_ctx = ctx;
+	iostat_ctx->bytes = 0;
 	bio->bi_private = iostat_ctx;
 }
 
@@ -279,10 +444,20 @@ int f2fs_init_iostat(struct f2fs_sb_info *sbi)
 	if (!sbi->iostat_io_lat)
 		return -ENOMEM;
 
+	sbi->iostat_owners = f2fs_kvzalloc(sbi,
+			sizeof(struct iostat_owner_info), GFP_KERNEL);
+	if (!sbi->iostat_owners) {
+		kfree(sbi->iostat_io_lat);
+		return -ENOMEM;
+	}
+	spin_lock_init(&sbi->iostat_owners->lock);
+	mutex_init(&sbi->iostat_owners->snapshot_lock);
+
 	return 0;
 }
 
 void f2fs_destroy_iostat(struct f2fs_sb_info *sbi)
 {
 	kfree(sbi->iostat_io_lat);
+	kvfree(sbi->iostat_owners);
 }
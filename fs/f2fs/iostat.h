@@ -30,6 +30,8 @@ struct iostat_lat_info {
 
 extern int __maybe_unused iostat_info_seq_show(struct seq_file *seq,
 			void *offset);
+extern ssize_t f2fs_read_iostat_owners(struct f2fs_sb_info *sbi, char *buf,
+			loff_t off, size_t count);
 extern void f2fs_reset_iostat(struct f2fs_sb_info *sbi);
 extern void f2fs_update_iostat(struct f2fs_sb_info *sbi,
 			enum iostat_type type, unsigned long long io_bytes);
@@ -39,8 +41,17 @@ struct bio_iostat_ctx {
 	unsigned long submit_ts;
 	enum page_type type;
 	struct bio_post_read_ctx *post_read_ctx;
+
+	/* owner of the first page, for the per-uid/inode statistics */
+	u64 submit_ns;
+	uid_t uid;
+	nid_t ino;
+	unsigned int bytes;
 };
 
+extern void __iostat_bind_owner(struct bio_iostat_ctx *iostat_ctx,
+			struct bio *bio);
+
 static inline void iostat_update_submit_ctx(struct bio *bio,
 			enum page_type type)
 {
@@ -48,6 +59,8 @@ static inline void iostat_update_submit_ctx(struct bio *bio,
 
 	iostat_ctx->submit_ts = jiffies;
 	iostat_ctx->type = type;
+	if (iostat_ctx->sbi->iostat_enable)
+		__iostat_bind_owner(iostat_ctx, bio);
 }
 
 static inline struct bio_post_read_ctx *get_post_read_ctx(struct bio *bio)
@@ -776,7 +776,10 @@ int f2fs_get_dnode_of_data(struct dnode_of_data *dn, pgoff_t index, int mode)
 	npage[0] = dn->inode_page;
 
 	if (!npage[0]) {
-		npage[0] = f2fs_get_node_page(sbi, nids[0]);
+		if (mode == LOOKUP_NODE_NOWAIT)
+			npage[0] = f2fs_get_node_page_nowait(sbi, nids[0]);
+		else
+			npage[0] = f2fs_get_node_page(sbi, nids[0]);
 		if (IS_ERR(npage[0]))
 			return PTR_ERR(npage[0]);
 	}
@@ -832,7 +835,11 @@ int f2fs_get_dnode_of_data(struct dnode_of_data *dn, pgoff_t index, int mode)
 		}
 
 		if (!done) {
-			npage[i] = f2fs_get_node_page(sbi, nids[i]);
+			if (mode == LOOKUP_NODE_NOWAIT)
+				npage[i] = f2fs_get_node_page_nowait(sbi,
+								     nids[i]);
+			else
+				npage[i] = f2fs_get_node_page(sbi, nids[i]);
 			if (IS_ERR(npage[i])) {
 				err = PTR_ERR(npage[i]);
 				f2fs_put_page(npage[0], 0);
@@ -1477,6 +1484,31 @@ struct page *f2fs_get_node_page_ra(struct page *parent, int start)
 	return __get_node_page(sbi, nid, parent, start);
 }
 
+/*
+ * Return the locked node page @nid if it is uptodate in the node cache, or
+ * -EAGAIN if getting it would have to wait for a lock or a read.
+ */
+struct page *f2fs_get_node_page_nowait(struct f2fs_sb_info *sbi, pgoff_t nid)
+{
+	struct page *page;
+
+	if (!nid)
+		return ERR_PTR(-ENOENT);
+	if (f2fs_check_nid_range(sbi, nid))
+		return ERR_PTR(-EINVAL);
+
+	page = f2fs_pagecache_get_page(NODE_MAPPING(sbi), nid,
+					FGP_LOCK | FGP_NOWAIT, 0);
+	if (!page)
+		return ERR_PTR(-EAGAIN);
+
+	if (unlikely(!PageUptodate(page) || nid != nid_of_node(page))) {
+		f2fs_put_page(page, 1);
+		return ERR_PTR(-EAGAIN);
+	}
+	return page;
+}
+
 static void flush_inline_data(struct f2fs_sb_info *sbi, nid_t ino)
 {
 	struct inode *inode;
@@ -825,6 +825,37 @@ int f2fs_flush_device_cache(struct f2fs_sb_info *sbi)
 	return ret;
 }
 
+/* Must hold seglist_lock */
+static void __update_victim_bucket(struct f2fs_sb_info *sbi,
+						unsigned int segno)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	unsigned int secno = GET_SEC_FROM_SEG(sbi, segno);
+	unsigned int bucket = NULL_VICTIM_BUCKET;
+	bool dirty;
+
+	if (__is_large_section(sbi))
+		dirty = test_bit(secno, dirty_i->dirty_secmap);
+	else
+		dirty = test_bit(segno, dirty_i->dirty_segmap[DIRTY]);
+
+	if (dirty) {
+		bucket = get_valid_blocks(sbi, segno, true) >>
+					dirty_i->victim_bucket_shift;
+		bucket = min_t(unsigned int, bucket, NR_VICTIM_BUCKETS - 1);
+	}
+
+	if (dirty_i->victim_bucket[secno] == bucket)
+		return;
+
+	if (bucket == NULL_VICTIM_BUCKET)
+		list_del_init(&dirty_i->victim_list[secno]);
+	else
+		list_move_tail(&dirty_i->victim_list[secno],
+					&dirty_i->victim_buckets[bucket]);
+	dirty_i->victim_bucket[secno] = bucket;
+}
+
 static void __locate_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno,
 		enum dirty_type dirty_type)
 {
@@ -859,6 +890,7 @@ static void __locate_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno,
 			if (!IS_CURSEC(sbi, secno))
 				set_bit(secno, dirty_i->dirty_secmap);
 		}
+		__update_victim_bucket(sbi, segno);
 	}
 }
 
@@ -890,14 +922,12 @@ static void __remove_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno,
 			unsigned int secno = GET_SEC_FROM_SEG(sbi, segno);
 
 			if (!valid_blocks ||
-					valid_blocks == BLKS_PER_SEC(sbi)) {
+					valid_blocks == BLKS_PER_SEC(sbi))
 				clear_bit(secno, dirty_i->dirty_secmap);
-				return;
-			}
-
-			if (!IS_CURSEC(sbi, secno))
+			else if (!IS_CURSEC(sbi, secno))
 				set_bit(secno, dirty_i->dirty_secmap);
 		}
+		__update_victim_bucket(sbi, segno);
 	}
 }
 
@@ -3849,6 +3879,31 @@ void f2fs_wait_on_block_writeback_range(struct inode *inode, block_t blkaddr,
 		f2fs_wait_on_block_writeback(inode, blkaddr + i);
 }
 
+/* what f2fs_wait_on_block_writeback_range() would wait for, without waiting */
+bool f2fs_block_writeback_range_busy(struct inode *inode, block_t blkaddr,
+								block_t len)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	struct page *cpage;
+	bool busy = false;
+	block_t i;
+
+	if (!f2fs_post_read_required(inode))
+		return false;
+
+	for (i = 0; i < len && !busy; i++) {
+		if (!__is_valid_data_blkaddr(blkaddr + i))
+			continue;
+
+		cpage = find_get_page(META_MAPPING(sbi), blkaddr + i);
+		if (cpage) {
+			busy = PageWriteback(cpage);
+			f2fs_put_page(cpage, 0);
+		}
+	}
+	return busy;
+}
+
 static int read_compacted_summaries(struct f2fs_sb_info *sbi)
 {
 	struct f2fs_checkpoint *ckpt = F2FS_CKPT(sbi);
@@ -4755,6 +4810,7 @@ static void init_dirty_segmap(struct f2fs_sb_info *sbi)
 		if (IS_CURSEC(sbi, secno))
 			continue;
 		set_bit(secno, dirty_i->dirty_secmap);
+		__update_victim_bucket(sbi, segno);
 	}
 	mutex_unlock(&dirty_i->seglist_lock);
 }
@@ -4763,10 +4819,35 @@ static int init_victim_secmap(struct f2fs_sb_info *sbi)
 {
 	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
 	unsigned int bitmap_size = f2fs_bitmap_size(MAIN_SECS(sbi));
+	unsigned int i;
 
 	dirty_i->victim_secmap = f2fs_kvzalloc(sbi, bitmap_size, GFP_KERNEL);
 	if (!dirty_i->victim_secmap)
 		return -ENOMEM;
+
+	dirty_i->victim_buckets = f2fs_kvmalloc(sbi,
+			array_size(NR_VICTIM_BUCKETS, sizeof(struct list_head)),
+			GFP_KERNEL);
+	dirty_i->victim_list = f2fs_kvmalloc(sbi,
+			array_size(MAIN_SECS(sbi), sizeof(struct list_head)),
+			GFP_KERNEL);
+	dirty_i->victim_bucket = f2fs_kvmalloc(sbi,
+			array_size(MAIN_SECS(sbi), sizeof(unsigned short)),
+			GFP_KERNEL);
+	if (!dirty_i->victim_buckets || !dirty_i->victim_list ||
+					!dirty_i->victim_bucket)
+		return -ENOMEM;
+
+	for (i = 0; i < NR_VICTIM_BUCKETS; i++)
+		INIT_LIST_HEAD(&dirty_i->victim_buckets[i]);
+	for (i = 0; i < MAIN_SECS(sbi); i++) {
+		INIT_LIST_HEAD(&dirty_i->victim_list[i]);
+		dirty_i->victim_bucket[i] = NULL_VICTIM_BUCKET;
+	}
+
+	while ((BLKS_PER_SEC(sbi) >> dirty_i->victim_bucket_shift) >=
+							NR_VICTIM_BUCKETS)
+		dirty_i->victim_bucket_shift++;
 	return 0;
 }
 
@@ -4774,6 +4855,7 @@ static int build_dirty_segmap(struct f2fs_sb_info *sbi)
 {
 	struct dirty_seglist_info *dirty_i;
 	unsigned int bitmap_size, i;
+	int err;
 
 	/* allocate memory for dirty segments list information */
 	dirty_i = f2fs_kzalloc(sbi, sizeof(struct dirty_seglist_info),
@@ -4801,8 +4883,12 @@ static int build_dirty_segmap(struct f2fs_sb_info *sbi)
 			return -ENOMEM;
 	}
 
+	err = init_victim_secmap(sbi);
+	if (err)
+		return err;
+
 	init_dirty_segmap(sbi);
-	return init_victim_secmap(sbi);
+	return 0;
 }
 
 static int sanity_check_curseg(struct f2fs_sb_info *sbi)
@@ -5356,6 +5442,9 @@ static void destroy_victim_secmap(struct f2fs_sb_info *sbi)
 	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
 
 	kvfree(dirty_i->victim_secmap);
+	kvfree(dirty_i->victim_buckets);
+	kvfree(dirty_i->victim_list);
+	kvfree(dirty_i->victim_bucket);
 }
 
 static void destroy_dirty_segmap(struct f2fs_sb_info *sbi)
@@ -288,6 +288,15 @@ enum dirty_type {
 	NR_DIRTY_TYPE
 };
 
+/*
+ * Dirty sections are also linked into buckets by their number of valid
+ * blocks, so that greedy and cost-benefit GC can visit the least valid
+ * sections first instead of scanning the dirty bitmap. A bucket covers a
+ * single valid block count unless sections have more blocks than buckets.
+ */
+#define NR_VICTIM_BUCKETS	1024
+#define NULL_VICTIM_BUCKET	USHRT_MAX
+
 struct dirty_seglist_info {
 	const struct victim_selection *v_ops;	/* victim selction operation */
 	unsigned long *dirty_segmap[NR_DIRTY_TYPE];
@@ -295,6 +304,10 @@ struct dirty_seglist_info {
 	struct mutex seglist_lock;		/* lock for segment bitmaps */
 	int nr_dirty[NR_DIRTY_TYPE];		/* # of dirty segments */
 	unsigned long *victim_secmap;		/* background GC victims */
+	struct list_head *victim_buckets;	/* dirty sections by valid blocks */
+	struct list_head *victim_list;		/* per-section bucket entry */
+	unsigned short *victim_bucket;		/* per-section bucket index */
+	unsigned int victim_bucket_shift;	/* valid blocks to bucket index */
 };
 
 /* victim selection function for cleaning and SSR */
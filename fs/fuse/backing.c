@@ -9,7 +9,9 @@
 #include <linux/fdtable.h>
 #include <linux/filter.h>
 #include <linux/fs_stack.h>
+#include <linux/fsnotify_backend.h>
 #include <linux/namei.h>
+#include <linux/sched/mm.h>
 
 #include "../internal.h"
 
@@ -23,6 +25,29 @@ struct fuse_bpf_aio_req {
 
 static struct kmem_cache *fuse_bpf_aio_request_cachep;
 
+/*
+ * Events on a backing inode after which cached lookups and attributes derived
+ * from it can no longer be trusted. FS_ACCESS is left out so that reads don't
+ * drop the caches; the atime is taken from the backing inode instead.
+ */
+#define FUSE_BACKING_MARK_EVENTS (FS_MODIFY | FS_ATTRIB | FS_CLOSE_WRITE |     \
+				  FS_CREATE | FS_DELETE | FS_MOVED_FROM |      \
+				  FS_MOVED_TO | FS_DELETE_SELF | FS_MOVE_SELF)
+
+/*
+ * Watch placed on the backing inode of a fuse inode the first time a lookup in
+ * it or its attributes are cached. Every event bumps seq; cached entries
+ * record seq when they are filled and are only used while it is unchanged.
+ * The watches of a connection are in its own group, fuse_conn->backing_group.
+ */
+struct fuse_backing_mark {
+	struct fsnotify_mark fsn_mark;
+	/* Not a reference, only compared against fuse_inode->backing_inode */
+	struct inode *backing_inode;
+	atomic_t seq;
+	struct rcu_head rcu;
+};
+
 static void fuse_stat_to_attr(struct fuse_conn *fc, struct inode *inode,
 		struct kstat *stat, struct fuse_attr *attr);
 
@@ -1323,6 +1348,8 @@ struct dentry *fuse_lookup_finalize(struct fuse_bpf_args *fa, struct inode *dir,
 		return ERR_PTR(error);
 
 	get_fuse_inode(inode)->nodeid = feo->nodeid;
+	/* The backing inode or bpf program may have been replaced */
+	clear_bit(FUSE_I_BACKING_ATTR, &get_fuse_inode(inode)->state);
 
 	return d_splice_alias(inode, entry);
 }
@@ -1344,6 +1371,256 @@ int fuse_revalidate_backing(struct dentry *entry, unsigned int flags)
 	return 1;
 }
 
+static int fuse_backing_mark_event(struct fsnotify_mark *mark, u32 mask,
+				   struct inode *inode, struct inode *dir,
+				   const struct qstr *name, u32 cookie)
+{
+	struct fuse_backing_mark *fbm =
+		container_of(mark, struct fuse_backing_mark, fsn_mark);
+
+	atomic_inc(&fbm->seq);
+	return 0;
+}
+
+static void fuse_backing_mark_free(struct fsnotify_mark *mark)
+{
+	struct fuse_backing_mark *fbm =
+		container_of(mark, struct fuse_backing_mark, fsn_mark);
+
+	/* fuse_backing_seq_valid() only holds the RCU read lock */
+	kfree_rcu(fbm, rcu);
+}
+
+static const struct fsnotify_ops fuse_backing_fsnotify_ops = {
+	.handle_inode_event = fuse_backing_mark_event,
+	.free_mark = fuse_backing_mark_free,
+};
+
+static struct fsnotify_group *fuse_backing_group_get(struct fuse_conn *fc)
+{
+	struct fsnotify_group *group = READ_ONCE(fc->backing_group);
+
+	if (group)
+		return group;
+
+	group = fsnotify_alloc_group(&fuse_backing_fsnotify_ops);
+	if (IS_ERR(group))
+		return NULL;
+
+	if (cmpxchg(&fc->backing_group, NULL, group)) {
+		fsnotify_put_group(group);
+		group = READ_ONCE(fc->backing_group);
+	}
+	return group;
+}
+
+/* Every watch holds a reference to the group, this drops the one of @fc */
+void fuse_backing_group_put(struct fuse_conn *fc)
+{
+	if (fc->backing_group)
+		fsnotify_put_group(fc->backing_group);
+}
+
+/*
+ * Watches are destroyed on eviction, which reclaim can get to while the
+ * mark_mutex of the group is held, so don't recurse into fs reclaim with it.
+ */
+static void fuse_backing_mark_destroy(struct fuse_backing_mark *fbm)
+{
+	unsigned int nofs_flag = memalloc_nofs_save();
+
+	fsnotify_destroy_mark(&fbm->fsn_mark, fbm->fsn_mark.group);
+	memalloc_nofs_restore(nofs_flag);
+	fsnotify_put_mark(&fbm->fsn_mark);
+}
+
+/*
+ * Make sure there is a watch on the current backing inode of @fi, placing a
+ * new one if there is none yet. The caches are best effort, so false is
+ * returned rather than an error if the watch cannot be placed.
+ *
+ * The watch may be replaced and freed concurrently, so it is only ever
+ * dereferenced under the RCU read lock.
+ */
+static bool fuse_backing_mark_get(struct fuse_inode *fi)
+{
+	struct fuse_backing_mark *fbm, *old;
+	struct inode *backing_inode = fi->backing_inode;
+	struct fsnotify_group *group;
+	unsigned int nofs_flag;
+	bool found;
+	int err;
+
+	rcu_read_lock();
+	fbm = READ_ONCE(fi->backing_mark);
+	found = fbm && fbm->backing_inode == backing_inode;
+	rcu_read_unlock();
+	if (found)
+		return true;
+
+	group = fuse_backing_group_get(get_fuse_conn(&fi->inode));
+	if (!group)
+		return false;
+
+	old = fbm;
+	fbm = kzalloc(sizeof(*fbm), GFP_KERNEL);
+	if (!fbm)
+		return false;
+
+	fsnotify_init_mark(&fbm->fsn_mark, group);
+	fbm->fsn_mark.mask = FUSE_BACKING_MARK_EVENTS;
+	fbm->backing_inode = backing_inode;
+	/* See fuse_backing_mark_destroy() */
+	nofs_flag = memalloc_nofs_save();
+	err = fsnotify_add_inode_mark(&fbm->fsn_mark, backing_inode, 1);
+	memalloc_nofs_restore(nofs_flag);
+	if (err) {
+		fsnotify_put_mark(&fbm->fsn_mark);
+		return false;
+	}
+
+	if (cmpxchg(&fi->backing_mark, old, fbm) != old) {
+		/* Lost the race against another lookup on this inode */
+		fuse_backing_mark_destroy(fbm);
+		return false;
+	}
+
+	if (old)
+		fuse_backing_mark_destroy(old);
+	return true;
+}
+
+void fuse_backing_mark_put(struct fuse_inode *fi)
+{
+	struct fuse_backing_mark *fbm;
+
+	fbm = xchg(&fi->backing_mark, NULL);
+	if (fbm)
+		fuse_backing_mark_destroy(fbm);
+}
+
+/*
+ * Start filling a cache entry from the backing inode of @inode. On success
+ * @seq is the sequence to pass to fuse_backing_cache_negative() or
+ * fuse_backing_cache_attr() once the result is known.
+ */
+bool fuse_backing_cache_begin(struct inode *inode, unsigned int *seq)
+{
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	struct fuse_backing_mark *fbm;
+	bool valid;
+
+	if (!fi->backing_inode || !fuse_backing_mark_get(fi))
+		return false;
+
+	rcu_read_lock();
+	fbm = READ_ONCE(fi->backing_mark);
+	valid = fbm && fbm->backing_inode == fi->backing_inode;
+	if (valid)
+		*seq = atomic_read(&fbm->seq);
+	rcu_read_unlock();
+
+	return valid;
+}
+
+static bool fuse_backing_seq_valid(struct fuse_inode *fi, unsigned int seq)
+{
+	/* Published with cmpxchg(), freed after an RCU grace period */
+	struct fuse_backing_mark *fbm = READ_ONCE(fi->backing_mark);
+
+	return fbm && fbm->backing_inode == READ_ONCE(fi->backing_inode) &&
+	       atomic_read(&fbm->seq) == seq;
+}
+
+void fuse_backing_cache_negative(struct dentry *entry, unsigned int seq)
+{
+	struct fuse_dentry *fd = get_fuse_dentry(entry);
+
+	if (!fd || !fd->backing_path.dentry ||
+	    !d_is_negative(fd->backing_path.dentry))
+		return;
+
+	fd->backing_seq = seq;
+	smp_wmb();
+	WRITE_ONCE(fd->backing_negative, true);
+}
+
+/*
+ * A negative entry stays valid as long as the backing dentry is still negative
+ * and nothing happened in the backing directory since it was looked up, which
+ * saves running the bpf program and the lower lookup again.
+ */
+bool fuse_backing_negative_valid(struct dentry *entry)
+{
+	struct fuse_dentry *fd = get_fuse_dentry(entry);
+	struct inode *dir;
+	bool valid = false;
+
+	if (!READ_ONCE(fd->backing_negative))
+		return false;
+	smp_rmb();
+
+	if (!d_is_negative(fd->backing_path.dentry))
+		return false;
+
+	rcu_read_lock();
+	dir = d_inode_rcu(READ_ONCE(entry->d_parent));
+	if (dir)
+		valid = fuse_backing_seq_valid(get_fuse_inode(dir),
+					       fd->backing_seq);
+	rcu_read_unlock();
+
+	return valid;
+}
+
+void fuse_backing_cache_attr(struct inode *inode, unsigned int seq)
+{
+	struct fuse_inode *fi = get_fuse_inode(inode);
+
+	fi->backing_attr_seq = seq;
+	smp_mb__before_atomic();
+	set_bit(FUSE_I_BACKING_ATTR, &fi->state);
+}
+
+/*
+ * Fill @stat from the attributes cached by the last getattr as long as the
+ * backing inode has not changed since and nobody invalidated them.
+ */
+bool fuse_backing_attr_cached(struct inode *inode, struct kstat *stat,
+			      u32 request_mask, unsigned int flags)
+{
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	struct timespec64 atime = {};
+	bool valid;
+
+	if ((flags & AT_STATX_FORCE_SYNC) ||
+	    (request_mask & READ_ONCE(fi->inval_mask)))
+		return false;
+
+	if (!test_bit(FUSE_I_BACKING_ATTR, &fi->state))
+		return false;
+	smp_rmb();
+
+	rcu_read_lock();
+	valid = fuse_backing_seq_valid(fi, READ_ONCE(fi->backing_attr_seq));
+	/* Reads don't invalidate the cache, see FUSE_BACKING_MARK_EVENTS */
+	if (valid)
+		atime = READ_ONCE(fi->backing_inode)->i_atime;
+	rcu_read_unlock();
+	if (!valid) {
+		clear_bit(FUSE_I_BACKING_ATTR, &fi->state);
+		return false;
+	}
+
+	if (stat) {
+		generic_fillattr(inode, stat);
+		stat->mode = fi->orig_i_mode;
+		stat->ino = fi->orig_ino;
+		stat->atime = atime;
+	}
+	return true;
+}
+
 int fuse_canonical_path_initialize(struct fuse_bpf_args *fa,
 				   struct fuse_dummy_io *fdi,
 				   const struct path *path,
@@ -2454,6 +2731,8 @@ int __init fuse_bpf_init(void)
 
 void __exit fuse_bpf_cleanup(void)
 {
+	/* All fuse inodes are gone, wait for their marks to be freed */
+	fsnotify_wait_marks_destroyed();
 	kmem_cache_destroy(fuse_bpf_aio_request_cachep);
 }
 
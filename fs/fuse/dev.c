@@ -2334,6 +2334,27 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 				res = fuse_passthrough_open(fud, oldfd);
 		}
 		break;
+	case FUSE_DEV_IOC_BACKING_OPEN: {
+		struct fuse_backing_map map;
+
+		res = -EFAULT;
+		if (!copy_from_user(&map, (void __user *)arg, sizeof(map))) {
+			res = -EINVAL;
+			fud = fuse_get_dev(file);
+			if (fud)
+				res = fuse_backing_open(fud, &map);
+		}
+		break;
+	}
+	case FUSE_DEV_IOC_BACKING_CLOSE:
+		res = -EFAULT;
+		if (!get_user(oldfd, (__u32 __user *)arg)) {
+			res = -EINVAL;
+			fud = fuse_get_dev(file);
+			if (fud)
+				res = fuse_backing_close(fud, oldfd);
+		}
+		break;
 	default:
 		res = -ENOTTY;
 		break;
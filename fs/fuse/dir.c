@@ -242,6 +242,8 @@ static int fuse_dentry_revalidate(struct dentry *entry, unsigned int flags)
 		if (ret <= 0) {
 			goto out;
 		}
+		if (!inode && fuse_backing_negative_valid(entry))
+			goto out;
 	}
 #endif
 	if (time_before64(fuse_dentry_time(entry), get_jiffies_64()) ||
@@ -641,13 +643,20 @@ static struct dentry *fuse_lookup(struct inode *dir, struct dentry *entry,
 
 #ifdef CONFIG_FUSE_BPF
 	struct fuse_err_ret fer;
+	unsigned int seq;
+	bool cache;
 
+	cache = fuse_backing_cache_begin(dir, &seq);
 	fer = fuse_bpf_backing(dir, struct fuse_lookup_io,
 			       fuse_lookup_initialize, fuse_lookup_backing,
 			       fuse_lookup_finalize,
 			       dir, entry, flags);
-	if (fer.ret)
+	if (fer.ret) {
+		if (cache && fer.cacheable && !fer.result &&
+		    d_really_is_negative(entry))
+			fuse_backing_cache_negative(entry, seq);
 		return fer.result;
+	}
 #endif
 
 	if (fuse_is_bad(dir))
@@ -1366,13 +1375,22 @@ static int fuse_update_get_attr(struct inode *inode, struct file *file,
 
 #ifdef CONFIG_FUSE_BPF
 	struct fuse_err_ret fer;
+	unsigned int seq;
+	bool cache;
 
+	if (fuse_backing_attr_cached(inode, stat, request_mask, flags))
+		return 0;
+
+	cache = fuse_backing_cache_begin(inode, &seq);
 	fer = fuse_bpf_backing(inode, struct fuse_getattr_io,
 			       fuse_getattr_initialize,	fuse_getattr_backing,
 			       fuse_getattr_finalize,
 			       path->dentry, stat, request_mask, flags);
-	if (fer.ret)
+	if (fer.ret) {
+		if (cache && fer.cacheable && !fer.result)
+			fuse_backing_cache_attr(inode, seq);
 		return PTR_ERR(fer.result);
+	}
 #endif
 
 	if (flags & AT_STATX_FORCE_SYNC)
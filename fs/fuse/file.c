@@ -221,6 +221,8 @@ void fuse_finish_open(struct inode *inode, struct file *file)
 
 	if ((file->f_mode & FMODE_WRITE) && fc->writeback_cache)
 		fuse_link_write_file(file);
+
+	fuse_passthrough_finish_open(file);
 }
 
 int fuse_open_common(struct inode *inode, struct file *file, bool isdir)
@@ -76,6 +76,11 @@ struct fuse_dentry {
 		struct rcu_head rcu;
 	};
 	struct path backing_path;
+#ifdef CONFIG_FUSE_BPF
+	/* Negative backing entry, valid while the parent's backing_seq holds */
+	bool backing_negative;
+	unsigned int backing_seq;
+#endif
 };
 
 static inline struct fuse_dentry *get_fuse_dentry(const struct dentry *entry)
@@ -117,6 +122,12 @@ struct fuse_inode {
 	 * or handle in place
 	 */
 	struct bpf_prog *bpf;
+
+	/** Watch on backing_inode that invalidates the cached entries */
+	struct fuse_backing_mark *backing_mark;
+
+	/** backing_mark sequence at which the attributes were cached */
+	unsigned int backing_attr_seq;
 #endif
 
 	/** Unique ID, which identifies the inode between userspace
@@ -225,6 +236,8 @@ enum {
 	FUSE_I_SIZE_UNSTABLE,
 	/* Bad inode */
 	FUSE_I_BAD,
+	/** Attributes were cached from the backing inode */
+	FUSE_I_BACKING_ATTR,
 };
 
 struct fuse_conn;
@@ -879,8 +892,16 @@ struct fuse_conn {
 	/** IDR for passthrough requests */
 	struct idr passthrough_req;
 
-	/** Protects passthrough_req */
+	/** IDR for backing files registered with FUSE_DEV_IOC_BACKING_OPEN */
+	struct idr backing_files;
+
+	/** Protects passthrough_req and backing_files */
 	spinlock_t passthrough_req_lock;
+
+#ifdef CONFIG_FUSE_BPF
+	/** Group of the watches on backing inodes, allocated on first use */
+	struct fsnotify_group *backing_group;
+#endif
 };
 
 /*
@@ -1330,8 +1351,11 @@ void fuse_dax_cancel_work(struct fuse_conn *fc);
 /* passthrough.c */
 void fuse_copyattr(struct file *dst_file, struct file *src_file);
 int fuse_passthrough_open(struct fuse_dev *fud, u32 lower_fd);
+int fuse_backing_open(struct fuse_dev *fud, struct fuse_backing_map *map);
+int fuse_backing_close(struct fuse_dev *fud, u32 backing_id);
 int fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_file *ff,
 			   struct fuse_open_out *openarg);
+void fuse_passthrough_finish_open(struct file *file);
 void fuse_passthrough_release(struct fuse_passthrough *passthrough);
 ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to);
 ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from);
@@ -1610,6 +1634,15 @@ struct dentry *fuse_lookup_finalize(struct fuse_bpf_args *fa, struct inode *dir,
 			   struct dentry *entry, unsigned int flags);
 int fuse_revalidate_backing(struct dentry *entry, unsigned int flags);
 
+bool fuse_backing_cache_begin(struct inode *inode, unsigned int *seq);
+void fuse_backing_cache_negative(struct dentry *entry, unsigned int seq);
+bool fuse_backing_negative_valid(struct dentry *entry);
+void fuse_backing_cache_attr(struct inode *inode, unsigned int seq);
+bool fuse_backing_attr_cached(struct inode *inode, struct kstat *stat,
+			      u32 request_mask, unsigned int flags);
+void fuse_backing_mark_put(struct fuse_inode *fi);
+void fuse_backing_group_put(struct fuse_conn *fc);
+
 int fuse_canonical_path_initialize(struct fuse_bpf_args *fa,
 				   struct fuse_dummy_io *fdi,
 				   const struct path *path,
@@ -1825,6 +1858,8 @@ static inline void convert_fuse_statfs(struct kstatfs *stbuf, struct fuse_kstatf
 struct fuse_err_ret {
 	void *result;
 	bool ret;
+	/* result came from the backing call alone, without any filter */
+	bool cacheable;
 };
 
 int __init fuse_bpf_init(void);
@@ -1925,6 +1960,8 @@ ssize_t fuse_bpf_simple_request(struct fuse_mount *fm, struct fuse_bpf_args *arg
 		fer = (struct fuse_err_ret) {				\
 			ERR_PTR(backing(&fa, args)),			\
 			true,						\
+			!(ext_flags & (FUSE_BPF_USER_FILTER |		\
+				       FUSE_BPF_POST_FILTER)),		\
 		};							\
 		if (IS_ERR(fer.result))					\
 			fa.error_in = PTR_ERR(fer.result);		\
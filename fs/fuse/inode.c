@@ -81,6 +81,7 @@ static struct inode *fuse_alloc_inode(struct super_block *sb)
 #ifdef CONFIG_FUSE_BPF
 	fi->backing_inode = NULL;
 	fi->bpf = NULL;
+	fi->backing_mark = NULL;
 #endif
 	fi->nodeid = 0;
 	fi->nlookup = 0;
@@ -126,6 +127,7 @@ static void fuse_evict_inode(struct inode *inode)
 	WARN_ON(inode->i_state & I_DIRTY_INODE);
 
 #ifdef CONFIG_FUSE_BPF
+	fuse_backing_mark_put(fi);
 	iput(fi->backing_inode);
 	if (fi->bpf)
 		bpf_prog_put(fi->bpf);
@@ -841,6 +843,7 @@ void fuse_conn_init(struct fuse_conn *fc, struct fuse_mount *fm,
 	INIT_LIST_HEAD(&fc->entry);
 	INIT_LIST_HEAD(&fc->devices);
 	idr_init(&fc->passthrough_req);
+	idr_init(&fc->backing_files);
 	atomic_set(&fc->num_waiting, 0);
 	fc->max_background = FUSE_DEFAULT_MAX_BACKGROUND;
 	fc->congestion_threshold = FUSE_DEFAULT_CONGESTION_THRESHOLD;
@@ -869,6 +872,9 @@ void fuse_conn_put(struct fuse_conn *fc)
 
 		if (IS_ENABLED(CONFIG_FUSE_DAX))
 			fuse_dax_conn_free(fc);
+#ifdef CONFIG_FUSE_BPF
+		fuse_backing_group_put(fc);
+#endif
 		if (fiq->ops->release)
 			fiq->ops->release(fiq);
 		put_pid_ns(fc->pid_ns);
@@ -1322,6 +1328,8 @@ void fuse_free_conn(struct fuse_conn *fc)
 	WARN_ON(!list_empty(&fc->devices));
 	idr_for_each(&fc->passthrough_req, free_fuse_passthrough, NULL);
 	idr_destroy(&fc->passthrough_req);
+	idr_for_each(&fc->backing_files, free_fuse_passthrough, NULL);
+	idr_destroy(&fc->backing_files);
 	kfree_rcu(fc, rcu);
 }
 EXPORT_SYMBOL_GPL(fuse_free_conn);
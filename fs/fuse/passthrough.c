@@ -71,6 +71,44 @@ static void fuse_aio_rw_complete(struct kiocb *iocb, long res, long res2)
 	iocb_fuse->ki_complete(iocb_fuse, res, res2);
 }
 
+/*
+ * Requests submitted with IOCB_NOWAIT (io_uring inline submission, RWF_NOWAIT)
+ * must not sleep on memory reclaim; fail them with -EAGAIN instead so that the
+ * caller retries from a context that can block.
+ */
+static struct fuse_aio_req *fuse_aio_req_alloc(struct kiocb *iocb_fuse,
+					       struct file *passthrough_filp)
+{
+	struct fuse_aio_req *aio_req;
+	gfp_t gfp = iocb_fuse->ki_flags & IOCB_NOWAIT ?
+		    GFP_NOWAIT | __GFP_NOWARN : GFP_KERNEL;
+
+	aio_req = kmalloc(sizeof(struct fuse_aio_req), gfp);
+	if (!aio_req)
+		return NULL;
+
+	aio_req->iocb_fuse = iocb_fuse;
+	kiocb_clone(&aio_req->iocb, iocb_fuse, passthrough_filp);
+	/*
+	 * A buffered read queued on a page wait queue returns -EIOCBQUEUED
+	 * without ever calling ki_complete, so the clone must not use one.
+	 */
+	aio_req->iocb.ki_flags &= ~IOCB_WAITQ;
+	aio_req->iocb.ki_complete = fuse_aio_rw_complete;
+
+	return aio_req;
+}
+
+static bool fuse_passthrough_start_write(struct kiocb *iocb_fuse,
+					 struct file *passthrough_filp)
+{
+	if (iocb_fuse->ki_flags & IOCB_NOWAIT)
+		return file_start_write_trylock(passthrough_filp);
+
+	file_start_write(passthrough_filp);
+	return true;
+}
+
 ssize_t fuse_passthrough_read_iter(struct kiocb *iocb_fuse,
 				   struct iov_iter *iter)
 {
@@ -91,15 +129,13 @@ ssize_t fuse_passthrough_read_iter(struct kiocb *iocb_fuse,
 	} else {
 		struct fuse_aio_req *aio_req;
 
-		aio_req = kmalloc(sizeof(struct fuse_aio_req), GFP_KERNEL);
+		aio_req = fuse_aio_req_alloc(iocb_fuse, passthrough_filp);
 		if (!aio_req) {
-			ret = -ENOMEM;
+			ret = iocb_fuse->ki_flags & IOCB_NOWAIT ? -EAGAIN :
+								  -ENOMEM;
 			goto out;
 		}
 
-		aio_req->iocb_fuse = iocb_fuse;
-		kiocb_clone(&aio_req->iocb, iocb_fuse, passthrough_filp);
-		aio_req->iocb.ki_complete = fuse_aio_rw_complete;
 		ret = call_read_iter(passthrough_filp, &aio_req->iocb, iter);
 		if (ret != -EIOCBQUEUED)
 			fuse_aio_cleanup_handler(aio_req);
@@ -126,13 +162,21 @@ ssize_t fuse_passthrough_write_iter(struct kiocb *iocb_fuse,
 	if (!iov_iter_count(iter))
 		return 0;
 
-	inode_lock(fuse_inode);
+	if (iocb_fuse->ki_flags & IOCB_NOWAIT) {
+		if (!inode_trylock(fuse_inode))
+			return -EAGAIN;
+	} else {
+		inode_lock(fuse_inode);
+	}
 
 	fuse_copyattr(fuse_filp, passthrough_filp);
 
 	old_cred = override_creds(ff->passthrough.cred);
 	if (is_sync_kiocb(iocb_fuse)) {
-		file_start_write(passthrough_filp);
+		if (!fuse_passthrough_start_write(iocb_fuse, passthrough_filp)) {
+			ret = -EAGAIN;
+			goto out;
+		}
 		ret = vfs_iter_write(passthrough_filp, iter, &iocb_fuse->ki_pos,
 				     iocb_to_rw_flags(iocb_fuse->ki_flags,
 						      PASSTHROUGH_IOCB_MASK));
@@ -142,18 +186,20 @@ ssize_t fuse_passthrough_write_iter(struct kiocb *iocb_fuse,
 	} else {
 		struct fuse_aio_req *aio_req;
 
-		aio_req = kmalloc(sizeof(struct fuse_aio_req), GFP_KERNEL);
+		aio_req = fuse_aio_req_alloc(iocb_fuse, passthrough_filp);
 		if (!aio_req) {
-			ret = -ENOMEM;
+			ret = iocb_fuse->ki_flags & IOCB_NOWAIT ? -EAGAIN :
+								  -ENOMEM;
 			goto out;
 		}
 
-		file_start_write(passthrough_filp);
+		if (!fuse_passthrough_start_write(iocb_fuse, passthrough_filp)) {
+			kfree(aio_req);
+			ret = -EAGAIN;
+			goto out;
+		}
 		__sb_writers_release(passthrough_inode->i_sb, SB_FREEZE_WRITE);
 
-		aio_req->iocb_fuse = iocb_fuse;
-		kiocb_clone(&aio_req->iocb, iocb_fuse, passthrough_filp);
-		aio_req->iocb.ki_complete = fuse_aio_rw_complete;
 		ret = call_write_iter(passthrough_filp, &aio_req->iocb, iter);
 		if (ret != -EIOCBQUEUED)
 			fuse_aio_cleanup_handler(aio_req);
@@ -194,22 +240,22 @@ ssize_t fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
 	return ret;
 }
 
-int fuse_passthrough_open(struct fuse_dev *fud, u32 lower_fd)
+static struct fuse_passthrough *fuse_passthrough_alloc(struct fuse_conn *fc,
+							u32 lower_fd)
 {
 	int res;
 	struct file *passthrough_filp;
-	struct fuse_conn *fc = fud->fc;
 	struct inode *passthrough_inode;
 	struct super_block *passthrough_sb;
 	struct fuse_passthrough *passthrough;
 
 	if (!fc->passthrough)
-		return -EPERM;
+		return ERR_PTR(-EPERM);
 
 	passthrough_filp = fget(lower_fd);
 	if (!passthrough_filp) {
 		pr_err("FUSE: invalid file descriptor for passthrough.\n");
-		return -EBADF;
+		return ERR_PTR(-EBADF);
 	}
 
 	if (!passthrough_filp->f_op->read_iter ||
@@ -236,22 +282,103 @@ int fuse_passthrough_open(struct fuse_dev *fud, u32 lower_fd)
 	passthrough->filp = passthrough_filp;
 	passthrough->cred = prepare_creds();
 
+	return passthrough;
+
+err_free_file:
+	fput(passthrough_filp);
+
+	return ERR_PTR(res);
+}
+
+static int fuse_passthrough_idr_add(struct fuse_conn *fc, struct idr *idr,
+				    struct fuse_passthrough *passthrough)
+{
+	int res;
+
 	idr_preload(GFP_KERNEL);
 	spin_lock(&fc->passthrough_req_lock);
-	res = idr_alloc(&fc->passthrough_req, passthrough, 1, 0, GFP_ATOMIC);
+	res = idr_alloc(idr, passthrough, 1, 0, GFP_ATOMIC);
 	spin_unlock(&fc->passthrough_req_lock);
 	idr_preload_end();
 
-	if (res > 0)
-		return res;
+	if (res <= 0) {
+		fuse_passthrough_release(passthrough);
+		kfree(passthrough);
+	}
+
+	return res;
+}
+
+int fuse_passthrough_open(struct fuse_dev *fud, u32 lower_fd)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_passthrough *passthrough;
+
+	passthrough = fuse_passthrough_alloc(fc, lower_fd);
+	if (IS_ERR(passthrough))
+		return PTR_ERR(passthrough);
+
+	return fuse_passthrough_idr_add(fc, &fc->passthrough_req, passthrough);
+}
+
+/*
+ * Unlike the ids handed out by fuse_passthrough_open(), which are consumed by
+ * the one open reply that references them, a registered backing file stays
+ * in the table until FUSE_DEV_IOC_BACKING_CLOSE. Any number of opens can
+ * reference it with FOPEN_PASSTHROUGH, so a daemon that serves the same lower
+ * file to many openers does not pay an fd lookup and allocation per open.
+ */
+int fuse_backing_open(struct fuse_dev *fud, struct fuse_backing_map *map)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_passthrough *passthrough;
+
+	if (map->flags || map->padding)
+		return -EINVAL;
+
+	passthrough = fuse_passthrough_alloc(fc, map->fd);
+	if (IS_ERR(passthrough))
+		return PTR_ERR(passthrough);
+
+	return fuse_passthrough_idr_add(fc, &fc->backing_files, passthrough);
+}
+
+int fuse_backing_close(struct fuse_dev *fud, u32 backing_id)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_passthrough *passthrough;
+
+	if (!fc->passthrough)
+		return -EPERM;
+
+	spin_lock(&fc->passthrough_req_lock);
+	passthrough = idr_remove(&fc->backing_files, backing_id);
+	spin_unlock(&fc->passthrough_req_lock);
 
+	if (!passthrough)
+		return -ENOENT;
+
+	/* Files opened through this entry hold their own references */
 	fuse_passthrough_release(passthrough);
 	kfree(passthrough);
 
-err_free_file:
-	fput(passthrough_filp);
+	return 0;
+}
 
-	return res;
+static int fuse_backing_setup(struct fuse_conn *fc, struct fuse_file *ff,
+			      int backing_id)
+{
+	struct fuse_passthrough *passthrough;
+
+	spin_lock(&fc->passthrough_req_lock);
+	passthrough = idr_find(&fc->backing_files, backing_id);
+	if (passthrough) {
+		ff->passthrough.filp = get_file(passthrough->filp);
+		ff->passthrough.cred = get_new_cred(passthrough->cred);
+	}
+	spin_unlock(&fc->passthrough_req_lock);
+
+	return passthrough ? 0 : -EINVAL;
 }
 
 int fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_file *ff,
@@ -267,6 +394,9 @@ int fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_file *ff,
 	if (passthrough_fh <= 0)
 		return -EINVAL;
 
+	if (openarg->open_flags & FOPEN_PASSTHROUGH)
+		return fuse_backing_setup(fc, ff, passthrough_fh);
+
 	spin_lock(&fc->passthrough_req_lock);
 	passthrough = idr_remove(&fc->passthrough_req, passthrough_fh);
 	spin_unlock(&fc->passthrough_req_lock);
@@ -280,6 +410,23 @@ int fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_file *ff,
 	return 0;
 }
 
+/*
+ * Let callers that issue I/O without blocking (io_uring, RWF_NOWAIT) do so on
+ * the FUSE file whenever the lower file supports it, instead of punting every
+ * request to a worker thread. FMODE_BUF_RASYNC is not passed on: the retry of
+ * an async buffered read is driven by the caller's wait queue entry, which
+ * the clone of the kiocb can't complete through.
+ */
+void fuse_passthrough_finish_open(struct file *file)
+{
+	struct fuse_file *ff = file->private_data;
+
+	if (!ff->passthrough.filp)
+		return;
+
+	file->f_mode |= ff->passthrough.filp->f_mode & FMODE_NOWAIT;
+}
+
 void fuse_passthrough_release(struct fuse_passthrough *passthrough)
 {
 	if (passthrough->filp) {
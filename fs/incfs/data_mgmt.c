@@ -2,6 +2,7 @@
 /*
  * Copyright 2019 Google LLC
  */
+#include <linux/bvec.h>
 #include <linux/crc32.h>
 #include <linux/delay.h>
 #include <linux/file.h>
@@ -9,12 +10,16 @@
 #include <linux/gfp.h>
 #include <linux/kobject.h>
 #include <linux/ktime.h>
+#include <linux/log2.h>
 #include <linux/lz4.h>
 #include <linux/mm.h>
 #include <linux/namei.h>
 #include <linux/pagemap.h>
+#include <linux/percpu.h>
 #include <linux/slab.h>
 #include <linux/types.h>
+#include <linux/uio.h>
+#include <linux/vmalloc.h>
 #include <linux/workqueue.h>
 
 #include "data_mgmt.h"
@@ -93,6 +98,39 @@ struct mount_info *incfs_alloc_mount_info(struct super_block *sb,
 	return ERR_PTR(error);
 }
 
+static int alloc_read_log_rings(struct read_log_rings *rings,
+				unsigned int pages)
+{
+	u32 data_size = PAGE_SIZE << order_base_2(pages);
+	size_t stride = PAGE_SIZE + data_size;
+	void *base;
+	int cpu;
+
+	rings->rr_state = alloc_percpu(struct read_log_ring_state);
+	if (!rings->rr_state)
+		return -ENOMEM;
+
+	base = vmalloc_user(stride * nr_cpu_ids);
+	if (!base) {
+		free_percpu(rings->rr_state);
+		rings->rr_state = NULL;
+		return -ENOMEM;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct incfs_log_ring_header *hdr = base + cpu * stride;
+
+		hdr->header_size = PAGE_SIZE;
+		hdr->data_size = data_size;
+	}
+	rings->rr_stride = stride;
+	rings->rr_data_size = data_size;
+
+	/* Reads may be going on already when this is a remount */
+	smp_store_release(&rings->rr_base, base);
+	return 0;
+}
+
 int incfs_realloc_mount_info(struct mount_info *mi,
 			     struct mount_options *options)
 {
@@ -130,6 +168,18 @@ int incfs_realloc_mount_info(struct mount_info *mi,
 		kfree(old_buffer);
 	}
 
+	/* The rings may be mapped, so they can't be resized on remount */
+	if (mi->mi_log.rl_cpu_rings.rr_base) {
+		options->read_log_ring_pages =
+			mi->mi_options.read_log_ring_pages;
+	} else if (options->read_log_ring_pages) {
+		int error = alloc_read_log_rings(&mi->mi_log.rl_cpu_rings,
+						 options->read_log_ring_pages);
+
+		if (error)
+			return error;
+	}
+
 	if (options->sysfs_name && !mi->mi_sysfs_node)
 		mi->mi_sysfs_node = incfs_add_sysfs_node(options->sysfs_name,
 							 mi);
@@ -171,6 +221,8 @@ void incfs_free_mount_info(struct mount_info *mi)
 	mutex_destroy(&mi->mi_zstd_workspace_mutex);
 	put_cred(mi->mi_owner);
 	kfree(mi->mi_log.rl_ring_buf);
+	vfree(mi->mi_log.rl_cpu_rings.rr_base);
+	free_percpu(mi->mi_log.rl_cpu_rings.rr_state);
 	for (i = 0; i < ARRAY_SIZE(mi->pseudo_file_xattr); ++i)
 		kfree(mi->pseudo_file_xattr[i].data);
 	kfree(mi->mi_per_uid_read_timeouts);
@@ -217,6 +269,39 @@ struct dentry *incfs_lookup_dentry(struct dentry *parent, const char *name)
 	return result;
 }
 
+static int blockmap_chunk_count(struct data_file *df)
+{
+	return DIV_ROUND_UP(df->df_data_block_count,
+			    INCFS_BLOCKMAP_CHUNK_BLOCKS);
+}
+
+static int init_blockmap_index(struct data_file *df)
+{
+	int nr_chunks = blockmap_chunk_count(df);
+
+	df->df_loaded_chunks = kvcalloc(BITS_TO_LONGS(nr_chunks),
+					sizeof(unsigned long), GFP_NOFS);
+	df->df_present_blocks =
+		kvcalloc(BITS_TO_LONGS(df->df_data_block_count),
+			 sizeof(unsigned long), GFP_NOFS);
+	df->df_chunks = kvcalloc(nr_chunks, sizeof(*df->df_chunks), GFP_NOFS);
+	if (!df->df_loaded_chunks || !df->df_present_blocks || !df->df_chunks)
+		return -ENOMEM;
+	return 0;
+}
+
+static void free_blockmap_index(struct data_file *df)
+{
+	int i;
+
+	if (df->df_chunks)
+		for (i = 0; i < blockmap_chunk_count(df); i++)
+			kfree(df->df_chunks[i].bc_extents);
+	kvfree(df->df_chunks);
+	kvfree(df->df_present_blocks);
+	kvfree(df->df_loaded_chunks);
+}
+
 static struct data_file *handle_mapped_file(struct mount_info *mi,
 					    struct data_file *df)
 {
@@ -264,6 +349,7 @@ static struct data_file *handle_mapped_file(struct mount_info *mi,
 		goto out;
 
 	result->df_mapped_offset = df->df_metadata_off;
+	result->df_mapped = true;
 
 out:
 	dput(index_file_dentry);
@@ -296,6 +382,9 @@ struct data_file *incfs_open_data_file(struct mount_info *mi, struct file *bf)
 	}
 
 	mutex_init(&df->df_enable_verity);
+	xa_init(&df->df_hash_cache);
+	mutex_init(&df->df_blockmap_mutex);
+	spin_lock_init(&df->df_extents_lock);
 
 	df->df_backing_file_context = bfc;
 	df->df_mount_info = mi;
@@ -322,6 +411,8 @@ struct data_file *incfs_open_data_file(struct mount_info *mi, struct file *bf)
 	md_records = incfs_scan_metadata_chain(df);
 	if (md_records < 0)
 		error = md_records;
+	else
+		error = init_blockmap_index(df);
 
 out:
 	if (error) {
@@ -337,6 +428,8 @@ struct data_file *incfs_open_data_file(struct mount_info *mi, struct file *bf)
 void incfs_free_data_file(struct data_file *df)
 {
 	u32 data_blocks_written, hash_blocks_written;
+	struct page *page;
+	unsigned long index;
 
 	if (!df)
 		return;
@@ -363,12 +456,17 @@ void incfs_free_data_file(struct data_file *df)
 			pr_warn("incfs: failed to write status to backing file\n");
 	}
 
+	xa_for_each(&df->df_hash_cache, index, page)
+		put_page(page);
+	xa_destroy(&df->df_hash_cache);
+	free_blockmap_index(df);
 	incfs_free_mtree(df->df_hash_tree);
 	incfs_free_bfc(df->df_backing_file_context);
 	kfree(df->df_signature);
 	kfree(df->df_verity_file_digest.data);
 	kfree(df->df_verity_signature);
 	mutex_destroy(&df->df_enable_verity);
+	mutex_destroy(&df->df_blockmap_mutex);
 	kfree(df);
 }
 
@@ -548,11 +646,117 @@ static void log_read_one_record(struct read_log *rl, struct read_log_state *rs)
 	++rs->current_record_no;
 }
 
+/* Append a read record to the current CPU's mappable read log ring */
+static void log_ring_block_read(struct read_log_rings *rings, void *base,
+				incfs_uuid_t *id, int block_index, uid_t uid,
+				s64 now_us)
+{
+	struct incfs_log_ring_header *hdr;
+	struct read_log_ring_state *state;
+	union {
+		struct incfs_log_ring_full full;
+		struct incfs_log_ring_delta delta;
+		struct incfs_log_ring_next next;
+	} record;
+	size_t record_size, pad = 0;
+	u32 mask = rings->rr_data_size - 1;
+	u64 head, tail, ts_us = now_us;
+	u8 *data;
+	int cpu;
+
+	cpu = get_cpu();
+	hdr = base + cpu * rings->rr_stride;
+	data = (u8 *)hdr + PAGE_SIZE;
+	state = per_cpu_ptr(rings->rr_state, cpu);
+
+	if (state->valid && state->uid == uid && ts_us >= state->ts_us &&
+	    !memcmp(&state->file_id, id, sizeof(*id)) &&
+	    ts_us - state->ts_us <= U16_MAX) {
+		u32 ts_delta = ts_us - state->ts_us;
+
+		if (block_index == state->block_index + 1 &&
+		    ts_delta <= U8_MAX) {
+			record.next = (struct incfs_log_ring_next){
+				.type = INCFS_LOG_RING_NEXT,
+				.ts_delta_us = ts_delta,
+			};
+			record_size = sizeof(record.next);
+		} else {
+			record.delta = (struct incfs_log_ring_delta){
+				.type = INCFS_LOG_RING_DELTA,
+				.ts_delta_us = ts_delta,
+				.block_delta = block_index - state->block_index,
+			};
+			record_size = sizeof(record.delta);
+		}
+	} else {
+		record.full = (struct incfs_log_ring_full){
+			.type = INCFS_LOG_RING_FULL,
+			.block_index = block_index,
+			.timestamp_us = ts_us,
+			.uid = uid,
+		};
+		memcpy(record.full.file_id, id->bytes,
+		       sizeof(record.full.file_id));
+		record_size = sizeof(record.full);
+	}
+
+	/* Only this CPU writes head, tail comes from the reader */
+	head = hdr->head;
+	tail = smp_load_acquire(&hdr->tail);
+	if (rings->rr_data_size - (head & mask) < record_size)
+		pad = rings->rr_data_size - (head & mask);
+
+	if (head - tail > rings->rr_data_size ||
+	    head + pad + record_size - tail > rings->rr_data_size) {
+		WRITE_ONCE(hdr->dropped, hdr->dropped + 1);
+		state->valid = false;
+		goto out;
+	}
+
+	if (pad) {
+		data[head & mask] = INCFS_LOG_RING_PAD;
+		head += pad;
+	}
+	memcpy(data + (head & mask), &record, record_size);
+
+	state->file_id = *id;
+	state->ts_us = ts_us;
+	state->block_index = block_index;
+	state->uid = uid;
+	state->valid = true;
+
+	/* Pairs with the reader's acquire of head */
+	smp_store_release(&hdr->head, head + record_size);
+out:
+	put_cpu();
+}
+
+bool incfs_log_rings_have_data(struct mount_info *mi)
+{
+	struct read_log_rings *rings = &mi->mi_log.rl_cpu_rings;
+	void *base = smp_load_acquire(&rings->rr_base);
+	int cpu;
+
+	if (!base)
+		return false;
+
+	for_each_possible_cpu(cpu) {
+		struct incfs_log_ring_header *hdr =
+			base + cpu * rings->rr_stride;
+
+		if (smp_load_acquire(&hdr->head) != READ_ONCE(hdr->tail))
+			return true;
+	}
+	return false;
+}
+
 static void log_block_read(struct mount_info *mi, incfs_uuid_t *id,
 			   int block_index)
 {
 	struct read_log *log = &mi->mi_log;
 	struct read_log_state *head, *tail;
+	void *rings_base;
 	s64 now_us;
 	s64 relative_us;
 	union log_record record;
@@ -567,11 +771,22 @@ static void log_block_read(struct mount_info *mi, incfs_uuid_t *id,
 	 * This may read the old value, but it's OK to delay the logging start
 	 * right after the configuration update.
 	 */
-	if (READ_ONCE(log->rl_size) == 0)
+	rings_base = smp_load_acquire(&log->rl_cpu_rings.rr_base);
+	if (!rings_base && READ_ONCE(log->rl_size) == 0)
 		return;
 
 	now_us = ktime_to_us(ktime_get());
 
+	if (rings_base) {
+		log_ring_block_read(&log->rl_cpu_rings, rings_base, id,
+				    block_index, uid, now_us);
+		schedule_delayed_work(&log->ml_wakeup_work,
+				      msecs_to_jiffies(16));
+	}
+
+	if (READ_ONCE(log->rl_size) == 0)
+		return;
+
 	spin_lock(&log->rl_lock);
 	if (log->rl_size == 0) {
 		spin_unlock(&log->rl_lock);
@@ -665,6 +880,88 @@ static void log_block_read(struct mount_info *mi, incfs_uuid_t *id,
 	schedule_delayed_work(&log->ml_wakeup_work, msecs_to_jiffies(16));
 }
 
+/*
+ * Verified hash blocks are cached so that verification can stop at the first
+ * verified ancestor of a data block. Blocks of the lowest level are kept in
+ * the page cache after the data pages, marked with PageChecked, and may be
+ * reclaimed. Blocks of the levels above are a small fraction of the tree and
+ * are on the path of every verification, so they are kept in df_hash_cache
+ * until the file is evicted.
+ */
+static bool get_verified_digest(struct data_file *df, struct file *f, int lvl,
+				loff_t hash_block_offset, size_t offset_in_block,
+				pgoff_t file_pages, u8 *digest, int digest_size)
+{
+	struct page *page;
+	u8 *addr;
+
+	if (lvl > 0) {
+		page = xa_load(&df->df_hash_cache,
+			       hash_block_offset / INCFS_DATA_FILE_BLOCK_SIZE);
+		if (!page)
+			return false;
+
+		addr = kmap_atomic(page);
+		memcpy(digest, addr + offset_in_block, digest_size);
+		kunmap_atomic(addr);
+		return true;
+	}
+
+	page = find_get_page_flags(f->f_inode->i_mapping,
+				   file_pages + hash_block_offset /
+						INCFS_DATA_FILE_BLOCK_SIZE,
+				   FGP_ACCESSED);
+	if (!page)
+		return false;
+
+	if (!PageChecked(page)) {
+		put_page(page);
+		return false;
+	}
+
+	addr = kmap_atomic(page);
+	memcpy(digest, addr + offset_in_block, digest_size);
+	kunmap_atomic(addr);
+	put_page(page);
+	return true;
+}
+
+static void cache_verified_hash_block(struct data_file *df, struct file *f,
+				      int lvl, loff_t hash_block_offset,
+				      pgoff_t file_pages, u8 *buf)
+{
+	struct page *page;
+	u8 *addr;
+
+	if (lvl > 0) {
+		page = alloc_page(GFP_NOFS);
+		if (!page)
+			return;
+
+		addr = kmap_atomic(page);
+		memcpy(addr, buf, INCFS_DATA_FILE_BLOCK_SIZE);
+		kunmap_atomic(addr);
+		/* Somebody else may have verified the same block meanwhile */
+		if (xa_insert(&df->df_hash_cache,
+			      hash_block_offset / INCFS_DATA_FILE_BLOCK_SIZE,
+			      page, GFP_NOFS))
+			put_page(page);
+		return;
+	}
+
+	page = grab_cache_page(f->f_inode->i_mapping,
+			       file_pages + hash_block_offset /
+					    INCFS_DATA_FILE_BLOCK_SIZE);
+	if (page) {
+		addr = kmap_atomic(page);
+		memcpy(addr, buf, INCFS_DATA_FILE_BLOCK_SIZE);
+		kunmap_atomic(addr);
+		SetPageChecked(page);
+		unlock_page(page);
+		put_page(page);
+	}
+}
+
 static int validate_hash_tree(struct backing_file_context *bfc, struct file *f,
 			      int block_index, struct mem_range data, u8 *buf)
 {
@@ -704,29 +1001,20 @@ static int validate_hash_tree(struct backing_file_context *bfc, struct file *f,
 		hash_block_index /= hash_per_block;
 	}
 
-	memcpy(stored_digest, tree->root_hash, digest_size);
-
 	file_pages = DIV_ROUND_UP(df->df_size, INCFS_DATA_FILE_BLOCK_SIZE);
-	for (lvl = tree->depth - 1; lvl >= 0; lvl--) {
-		pgoff_t hash_page =
-			file_pages +
-			hash_block_offset[lvl] / INCFS_DATA_FILE_BLOCK_SIZE;
-		struct page *page = find_get_page_flags(
-			f->f_inode->i_mapping, hash_page, FGP_ACCESSED);
-
-		if (page && PageChecked(page)) {
-			u8 *addr = kmap_atomic(page);
-
-			memcpy(stored_digest, addr + hash_offset_in_block[lvl],
-			       digest_size);
-			kunmap_atomic(addr);
-			put_page(page);
-			continue;
-		}
 
-		if (page)
-			put_page(page);
+	/* Find the lowest verified ancestor, the root hash if there is none */
+	for (lvl = 0; lvl < tree->depth; lvl++) {
+		if (get_verified_digest(df, f, lvl, hash_block_offset[lvl],
+					hash_offset_in_block[lvl], file_pages,
+					stored_digest, digest_size))
+			break;
+	}
+	if (lvl == tree->depth)
+		memcpy(stored_digest, tree->root_hash, digest_size);
 
+	/* And verify the hash blocks below it */
+	for (lvl--; lvl >= 0; lvl--) {
 		res = incfs_kread(bfc, buf, INCFS_DATA_FILE_BLOCK_SIZE,
 				  hash_block_offset[lvl] + sig->hash_offset);
 		if (res < 0)
@@ -759,16 +1047,8 @@ static int validate_hash_tree(struct backing_file_context *bfc, struct file *f,
 		memcpy(stored_digest, buf + hash_offset_in_block[lvl],
 		       digest_size);
 
-		page = grab_cache_page(f->f_inode->i_mapping, hash_page);
-		if (page) {
-			u8 *addr = kmap_atomic(page);
-
-			memcpy(addr, buf, INCFS_DATA_FILE_BLOCK_SIZE);
-			kunmap_atomic(addr);
-			SetPageChecked(page);
-			unlock_page(page);
-			put_page(page);
-		}
+		cache_verified_hash_block(df, f, lvl, hash_block_offset[lvl],
+					  file_pages, buf);
 	}
 
 	res = incfs_calc_digest(tree->alg, data,
@@ -837,6 +1117,335 @@ static int get_data_file_block(struct data_file *df, int index,
 	return 0;
 }
 
+static struct data_file_extent *find_extent(struct blockmap_chunk *chunk,
+					    int rel)
+{
+	int lo = 0, hi = chunk->bc_nr_extents;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		struct data_file_extent *de = &chunk->bc_extents[mid];
+
+		if (rel < de->de_first)
+			hi = mid;
+		else if (rel >= de->de_first + de->de_count)
+			lo = mid + 1;
+		else
+			return de;
+	}
+	return NULL;
+}
+
+static bool is_full_block(const struct data_file_block *block)
+{
+	return block->db_comp_alg == COMPRESSION_NONE &&
+	       block->db_stored_size == INCFS_DATA_FILE_BLOCK_SIZE;
+}
+
+/* Can @next, starting right after @de, be appended to @de? */
+static bool can_join_extents(const struct data_file_extent *de,
+			     const struct data_file_extent *next)
+{
+	return de->de_comp_alg == COMPRESSION_NONE &&
+	       de->de_last_size == INCFS_DATA_FILE_BLOCK_SIZE &&
+	       next->de_comp_alg == COMPRESSION_NONE &&
+	       next->de_first == de->de_first + de->de_count &&
+	       next->de_backing_offset == de->de_backing_offset +
+			(loff_t)de->de_count * INCFS_DATA_FILE_BLOCK_SIZE;
+}
+
+/*
+ * Add present block @block at @rel to @chunk, merging it with its neighbours
+ * when they are stored back to back. @chunk must have room for one more
+ * extent.
+ */
+static void insert_extent(struct blockmap_chunk *chunk, int rel,
+			  const struct data_file_block *block)
+{
+	struct data_file_extent *de = chunk->bc_extents;
+	struct data_file_extent new = {
+		.de_backing_offset = block->db_backing_file_data_offset,
+		.de_first = rel,
+		.de_count = 1,
+		.de_last_size = block->db_stored_size,
+		.de_comp_alg = block->db_comp_alg,
+	};
+	int nr = chunk->bc_nr_extents;
+	int pos = 0, hi = nr;
+
+	while (pos < hi) {
+		int mid = (pos + hi) / 2;
+
+		if (de[mid].de_first < rel)
+			pos = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (pos > 0 && can_join_extents(&de[pos - 1], &new)) {
+		struct data_file_extent *prev = &de[pos - 1];
+
+		prev->de_count++;
+		prev->de_last_size = new.de_last_size;
+		/* The new block may close the gap to the next extent */
+		if (pos < nr && is_full_block(block) &&
+		    can_join_extents(prev, &de[pos])) {
+			prev->de_count += de[pos].de_count;
+			prev->de_last_size = de[pos].de_last_size;
+			memmove(&de[pos], &de[pos + 1],
+				(nr - pos - 1) * sizeof(*de));
+			chunk->bc_nr_extents--;
+		}
+		return;
+	}
+
+	if (pos < nr && is_full_block(block) && can_join_extents(&new, &de[pos])) {
+		de[pos].de_backing_offset = new.de_backing_offset;
+		de[pos].de_first = rel;
+		de[pos].de_count++;
+		return;
+	}
+
+	memmove(&de[pos + 1], &de[pos], (nr - pos) * sizeof(*de));
+	de[pos] = new;
+	chunk->bc_nr_extents++;
+}
+
+/*
+ * Look up data block @index in the in-memory blockmap index. Returns -EAGAIN
+ * if the block's chunk is not loaded, or if the block is absent from the
+ * index of a mapped file.
+ */
+static int get_indexed_block(struct data_file *df, int index,
+			     struct data_file_block *res_block)
+{
+	int chunk_index = index / INCFS_BLOCKMAP_CHUNK_BLOCKS;
+	int rel = index % INCFS_BLOCKMAP_CHUNK_BLOCKS;
+	struct data_file_extent *de;
+	int error = -EAGAIN;
+
+	if (!test_bit(chunk_index, df->df_loaded_chunks))
+		return -EAGAIN;
+
+	/* Pairs with smp_mb__before_atomic() in load_blockmap_chunk() */
+	smp_rmb();
+	if (!test_bit(index, df->df_present_blocks)) {
+		/* It may have been filled through the file it maps */
+		if (df->df_mapped)
+			return -EAGAIN;
+		*res_block = (struct data_file_block){};
+		return 0;
+	}
+
+	spin_lock(&df->df_extents_lock);
+	de = find_extent(&df->df_chunks[chunk_index], rel);
+	if (de) {
+		int i = rel - de->de_first;
+
+		res_block->db_backing_file_data_offset =
+			de->de_backing_offset +
+			(loff_t)i * INCFS_DATA_FILE_BLOCK_SIZE;
+		res_block->db_stored_size = i == de->de_count - 1 ?
+			de->de_last_size : INCFS_DATA_FILE_BLOCK_SIZE;
+		res_block->db_comp_alg = de->de_comp_alg;
+		error = 0;
+	}
+	spin_unlock(&df->df_extents_lock);
+
+	return error;
+}
+
+/* Load the blockmap entries of chunk @chunk_index into the in-memory index */
+static int load_blockmap_chunk(struct data_file *df, int chunk_index)
+{
+	struct blockmap_chunk *chunk = &df->df_chunks[chunk_index];
+	struct blockmap_chunk new = {};
+	struct incfs_blockmap_entry *bme = NULL;
+	struct data_file_extent *old;
+	int first = chunk_index * INCFS_BLOCKMAP_CHUNK_BLOCKS;
+	int count = min(INCFS_BLOCKMAP_CHUNK_BLOCKS,
+			df->df_data_block_count - first);
+	int error, i, seg;
+
+	error = mutex_lock_interruptible(&df->df_blockmap_mutex);
+	if (error)
+		return error;
+
+	if (test_bit(chunk_index, df->df_loaded_chunks))
+		goto out;
+
+	bme = kmalloc_array(count, sizeof(*bme), GFP_NOFS);
+	new.bc_extents = kmalloc_array(count, sizeof(*new.bc_extents),
+				       GFP_NOFS);
+	if (!bme || !new.bc_extents) {
+		error = -ENOMEM;
+		goto out;
+	}
+
+	for (seg = 0; seg < ARRAY_SIZE(df->df_segments); seg++) {
+		error = down_read_killable(&df->df_segments[seg].rwsem);
+		if (error)
+			goto out_up;
+	}
+
+	error = incfs_read_blockmap_entries(df->df_backing_file_context, bme,
+					    first, count, df->df_blockmap_off);
+	if (error < 0)
+		goto out_up;
+	if (error != count) {
+		error = -EIO;
+		goto out_up;
+	}
+	error = 0;
+
+	for (i = 0; i < count; i++) {
+		struct data_file_block block;
+
+		convert_data_file_block(&bme[i], &block);
+		if (!is_data_block_present(&block))
+			continue;
+
+		insert_extent(&new, i, &block);
+		set_bit(first + i, df->df_present_blocks);
+	}
+
+	/* Most chunks collapse into a few extents, don't keep the slack */
+	old = new.bc_extents;
+	new.bc_extents = kmemdup(old, new.bc_nr_extents * sizeof(*old),
+				 GFP_NOFS);
+	kfree(old);
+	if (new.bc_nr_extents && !new.bc_extents) {
+		error = -ENOMEM;
+		goto out_up;
+	}
+	new.bc_max_extents = new.bc_nr_extents;
+
+	spin_lock(&df->df_extents_lock);
+	old = chunk->bc_extents;
+	*chunk = new;
+	spin_unlock(&df->df_extents_lock);
+	kfree(old);
+	new.bc_extents = NULL;
+
+	/* Publish the present bits before the chunk */
+	smp_mb__before_atomic();
+	set_bit(chunk_index, df->df_loaded_chunks);
+
+out_up:
+	while (seg--)
+		up_read(&df->df_segments[seg].rwsem);
+out:
+	kfree(new.bc_extents);
+	kfree(bme);
+	mutex_unlock(&df->df_blockmap_mutex);
+	return error;
+}
+
+/*
+ * Add block @index, which has just been written, to the in-memory index.
+ * Called with the block's segment rwsem held for write.
+ */
+static void index_new_block(struct data_file *df, int index,
+			    const struct data_file_block *block)
+{
+	int chunk_index = index / INCFS_BLOCKMAP_CHUNK_BLOCKS;
+	struct blockmap_chunk *chunk = &df->df_chunks[chunk_index];
+	struct data_file_extent *new = NULL, *old = NULL;
+	int max;
+
+	/* Present bits are never wrong, only incomplete before loading */
+	set_bit(index, df->df_present_blocks);
+
+	/* The block will be picked up when the chunk is loaded */
+	if (!test_bit(chunk_index, df->df_loaded_chunks))
+		return;
+
+	spin_lock(&df->df_extents_lock);
+	while (chunk->bc_nr_extents == chunk->bc_max_extents) {
+		max = chunk->bc_max_extents;
+		spin_unlock(&df->df_extents_lock);
+
+		kfree(new);
+		new = kmalloc_array(clamp(2 * max, 4,
+					  INCFS_BLOCKMAP_CHUNK_BLOCKS),
+				    sizeof(*new), GFP_NOFS);
+		spin_lock(&df->df_extents_lock);
+		if (!new) {
+			/*
+			 * Drop the chunk's extents, lookups fall back to the
+			 * blockmap until the chunk is loaded again.
+			 */
+			clear_bit(chunk_index, df->df_loaded_chunks);
+			old = chunk->bc_extents;
+			*chunk = (struct blockmap_chunk){};
+			spin_unlock(&df->df_extents_lock);
+			kfree(old);
+			return;
+		}
+
+		/* Somebody else may have grown the array meanwhile */
+		if (chunk->bc_max_extents == max) {
+			memcpy(new, chunk->bc_extents, max * sizeof(*new));
+			old = chunk->bc_extents;
+			chunk->bc_extents = new;
+			chunk->bc_max_extents = clamp(2 * max, 4,
+						INCFS_BLOCKMAP_CHUNK_BLOCKS);
+			new = NULL;
+		}
+	}
+	insert_extent(chunk, index % INCFS_BLOCKMAP_CHUNK_BLOCKS, block);
+	spin_unlock(&df->df_extents_lock);
+
+	kfree(new);
+	kfree(old);
+}
+
+/*
+ * Look up data block @index, from the in-memory index whenever possible.
+ * Must not be called with any segment rwsem held.
+ */
+static int get_data_block_indexed(struct data_file *df, int index,
+				  struct data_file_block *res_block)
+{
+	struct data_file_segment *segment;
+	int error;
+
+	error = get_indexed_block(df, index, res_block);
+	if (error != -EAGAIN)
+		return error;
+
+	error = load_blockmap_chunk(df, index / INCFS_BLOCKMAP_CHUNK_BLOCKS);
+	if (error)
+		return error;
+
+	error = get_indexed_block(df, index, res_block);
+	if (error != -EAGAIN)
+		return error;
+
+	/*
+	 * The chunk was dropped again, or the block is absent from the index
+	 * of a mapped file: go to the blockmap
+	 */
+	segment = get_file_segment(df, index);
+	error = down_read_killable(&segment->rwsem);
+	if (error)
+		return error;
+
+	error = get_data_file_block(df, index, res_block);
+
+	up_read(&segment->rwsem);
+	if (error || !df->df_mapped || !is_data_block_present(res_block))
+		return error;
+
+	/* Index the block so that the blockmap is only read once for it */
+	if (down_write_killable(&segment->rwsem))
+		return 0;
+	if (!test_bit(index, df->df_present_blocks))
+		index_new_block(df, index, res_block);
+	up_write(&segment->rwsem);
+	return 0;
+}
+
 static int check_room_for_one_range(u32 size, u32 size_out)
 {
 	if (size_out + sizeof(struct incfs_filled_range) > size)
@@ -917,35 +1526,60 @@ int incfs_get_filled_blocks(struct data_file *df,
 	for (arg->index_out = arg->start_index; arg->index_out < end_index;
 	     ++arg->index_out) {
 		struct data_file_block dfb;
+		bool present;
 
-		if (++i == READ_BLOCKMAP_ENTRIES) {
-			entries_read = incfs_read_blockmap_entries(
-				df->df_backing_file_context, bme,
-				arg->index_out, READ_BLOCKMAP_ENTRIES,
-				df->df_blockmap_off);
-			if (entries_read < 0) {
-				error = entries_read;
-				break;
+		if (arg->index_out < df->df_data_block_count) {
+			/* Data blocks are answered from the in-memory index */
+			int chunk_index = arg->index_out /
+					  INCFS_BLOCKMAP_CHUNK_BLOCKS;
+
+			if (!test_bit(chunk_index, df->df_loaded_chunks)) {
+				error = load_blockmap_chunk(df, chunk_index);
+				if (error)
+					break;
+			}
+			/* Pairs with smp_mb__before_atomic() in loading */
+			smp_rmb();
+			present = test_bit(arg->index_out,
+					   df->df_present_blocks);
+			if (!present && df->df_mapped) {
+				error = get_data_block_indexed(df,
+						arg->index_out, &dfb);
+				if (error)
+					break;
+				present = is_data_block_present(&dfb);
 			}
+		} else {
+			if (++i == READ_BLOCKMAP_ENTRIES) {
+				entries_read = incfs_read_blockmap_entries(
+					df->df_backing_file_context, bme,
+					arg->index_out, READ_BLOCKMAP_ENTRIES,
+					df->df_blockmap_off);
+				if (entries_read < 0) {
+					error = entries_read;
+					break;
+				}
 
-			i = 0;
-		}
+				i = 0;
+			}
 
-		if (i >= entries_read) {
-			error = -EIO;
-			break;
-		}
+			if (i >= entries_read) {
+				error = -EIO;
+				break;
+			}
 
-		convert_data_file_block(bme + i, &dfb);
+			convert_data_file_block(bme + i, &dfb);
+			present = is_data_block_present(&dfb);
+		}
 
-		if (is_data_block_present(&dfb)) {
+		if (present) {
 			if (arg->index_out >= df->df_data_block_count)
 				++hash_blocks_filled;
 			else
 				++data_blocks_filled;
 		}
 
-		if (is_data_block_present(&dfb) == in_range)
+		if (present == in_range)
 			continue;
 
 		if (!in_range) {
@@ -1104,6 +1738,36 @@ static void notify_pending_reads(struct mount_info *mi,
 	wake_up_all(&mi->mi_blocks_written_notif_wq);
 }
 
+/*
+ * Notify pending reads waiting for any of the @count blocks starting at
+ * @first_index, @nr_written of which have just been written, with one wakeup
+ * per segment.
+ */
+static void notify_pending_reads_range(struct mount_info *mi,
+				       struct data_file *df, int first_index,
+				       int count, int nr_written)
+{
+	struct pending_read *entry = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(df->df_segments); i++) {
+		struct data_file_segment *segment = &df->df_segments[i];
+
+		rcu_read_lock();
+		list_for_each_entry_rcu(entry, &segment->reads_list_head,
+							segment_reads_list) {
+			if (entry->block_index >= first_index &&
+			    entry->block_index < first_index + count)
+				set_read_done(entry);
+		}
+		rcu_read_unlock();
+		wake_up_all(&segment->new_data_arrival_wq);
+	}
+
+	atomic_add(nr_written, &mi->mi_blocks_written);
+	wake_up_all(&mi->mi_blocks_written_notif_wq);
+}
+
 static int usleep_interruptible(u32 us)
 {
 	/* See:
@@ -1145,15 +1809,8 @@ static int wait_for_data_block(struct data_file *df, int block_index,
 	mi = df->df_mount_info;
 	segment = get_file_segment(df, block_index);
 
-	error = down_read_killable(&segment->rwsem);
-	if (error)
-		return error;
-
 	/* Look up the given block */
-	error = get_data_file_block(df, block_index, &block);
-
-	up_read(&segment->rwsem);
-
+	error = get_data_block_indexed(df, block_index, &block);
 	if (error)
 		return error;
 
@@ -1217,15 +1874,11 @@ static int wait_for_data_block(struct data_file *df, int block_index,
 			return error;
 	}
 
-	error = down_read_killable(&segment->rwsem);
-	if (error)
-		return error;
-
 	/*
 	 * Re-read blocks info now, it has just arrived and
 	 * should be available.
 	 */
-	error = get_data_file_block(df, block_index, &block);
+	error = get_data_block_indexed(df, block_index, &block);
 	if (!error) {
 		if (is_data_block_present(&block))
 			*res_block = block;
@@ -1238,7 +1891,6 @@ static int wait_for_data_block(struct data_file *df, int block_index,
 			error = -ENODATA;
 		}
 	}
-	up_read(&segment->rwsem);
 
 out:
 	if (error)
@@ -1356,6 +2008,225 @@ ssize_t incfs_read_data_file_block(struct mem_range dst, struct file *f,
 	return result;
 }
 
+/*
+ * Look up @nr_blocks data blocks starting at @first_index, from the in-memory
+ * index or else with a single backing file read. @buf must hold @nr_blocks
+ * entries.
+ */
+static int get_data_file_blocks(struct data_file *df, int first_index,
+				int nr_blocks, struct incfs_blockmap_entry *buf,
+				struct data_file_block *res_blocks)
+{
+	int error = 0;
+	int i;
+
+	for (i = 0; i < nr_blocks; i++) {
+		int index = first_index + i;
+
+		error = get_indexed_block(df, index, &res_blocks[i]);
+		if (error == -EAGAIN) {
+			error = load_blockmap_chunk(df,
+					index / INCFS_BLOCKMAP_CHUNK_BLOCKS);
+			if (!error)
+				error = get_indexed_block(df, index,
+							  &res_blocks[i]);
+		}
+		if (error)
+			break;
+	}
+	if (error != -EAGAIN)
+		return error;
+
+	for (i = 0; i < ARRAY_SIZE(df->df_segments); i++) {
+		error = down_read_killable(&df->df_segments[i].rwsem);
+		if (error)
+			break;
+	}
+
+	if (!error)
+		error = incfs_read_blockmap_entries(df->df_backing_file_context,
+						    buf, first_index, nr_blocks,
+						    df->df_blockmap_off);
+
+	while (i--)
+		up_read(&df->df_segments[i].rwsem);
+
+	if (error < 0)
+		return error;
+	if (error != nr_blocks)
+		return -EIO;
+
+	for (i = 0; i < nr_blocks; i++)
+		convert_data_file_block(&buf[i], &res_blocks[i]);
+	return 0;
+}
+
+/*
+ * Read the uncompressed blocks @blocks straight into @pages. All blocks but
+ * the last one must be full and they must be stored back to back.
+ */
+static ssize_t read_blocks_to_pages(struct backing_file_context *bfc,
+				    struct data_file_block *blocks,
+				    struct page **pages, int nr_blocks)
+{
+	struct bio_vec bvec[INCFS_READ_BATCH_PAGES];
+	size_t size = 0;
+	int i;
+
+	for (i = 0; i < nr_blocks; i++) {
+		bvec[i].bv_page = pages[i];
+		bvec[i].bv_len = blocks[i].db_stored_size;
+		bvec[i].bv_offset = 0;
+		size += blocks[i].db_stored_size;
+	}
+
+	return incfs_kread_bvec(bfc, bvec, nr_blocks, size,
+				blocks[0].db_backing_file_data_offset);
+}
+
+/*
+ * Fill, verify and log a single page of a run that was read into @src.
+ */
+static int fill_page_from_run(struct file *f, struct data_file *df,
+			      int index, struct data_file_block *block,
+			      struct page *page, u8 *src, bool in_page,
+			      u8 *hash_buf)
+{
+	struct mount_info *mi = df->df_mount_info;
+	void *addr = kmap(page);
+	ssize_t result;
+
+	if (in_page) {
+		result = block->db_stored_size;
+	} else if (block->db_comp_alg == COMPRESSION_NONE) {
+		result = min_t(size_t, block->db_stored_size, PAGE_SIZE);
+		memcpy(addr, src, result);
+	} else {
+		result = decompress(mi, range(src, block->db_stored_size),
+				    range(addr, PAGE_SIZE), block->db_comp_alg);
+	}
+
+	if (result > 0) {
+		int err = validate_hash_tree(df->df_backing_file_context, f,
+					     index, range(addr, result),
+					     hash_buf);
+
+		if (err < 0)
+			result = err;
+	}
+
+	if (result >= 0 && result < PAGE_SIZE)
+		memset(addr + result, 0, PAGE_SIZE - result);
+	flush_dcache_page(page);
+	kunmap(page);
+
+	if (result < 0)
+		return result;
+
+	log_block_read(mi, &df->df_id, index);
+	SetPageUptodate(page);
+	return 0;
+}
+
+/*
+ * incfs_read_data_file_pages() - opportunistically fill consecutive pages
+ * @f: incfs file the pages belong to
+ * @pages: locked page cache pages with consecutive indices
+ * @nr_pages: number of pages, at most INCFS_READ_BATCH_PAGES
+ * @tmp: scratch buffer of at least INCFS_READ_BATCH_TMP_SIZE bytes
+ *
+ * Meant for readahead: pages whose blocks are present are read, blocks that
+ * are stored back to back in the backing file are read together, and the
+ * pages are marked up to date. Missing blocks are not waited for and pages
+ * that fail are left alone, so that ->readpage deals with them when they are
+ * actually needed. The pages are not unlocked.
+ *
+ * Returns the number of pages filled or a negative error.
+ */
+int incfs_read_data_file_pages(struct file *f, struct page **pages,
+			       int nr_pages, struct mem_range tmp)
+{
+	struct data_file *df = get_incfs_data_file(f);
+	struct data_file_block blocks[INCFS_READ_BATCH_PAGES];
+	struct backing_file_context *bfc;
+	u8 *hash_buf;
+	int first_index;
+	int filled = 0;
+	int i, j, k;
+	int error;
+
+	if (!df || !tmp.data || tmp.len < INCFS_READ_BATCH_TMP_SIZE ||
+	    nr_pages > INCFS_READ_BATCH_PAGES)
+		return -EFAULT;
+
+	if (df->df_blockmap_off <= 0)
+		return -ENODATA;
+
+	bfc = df->df_backing_file_context;
+	hash_buf = tmp.data + 2 * INCFS_READ_BATCH_PAGES *
+		   INCFS_DATA_FILE_BLOCK_SIZE;
+	first_index = (page_offset(pages[0]) + df->df_mapped_offset) /
+		      INCFS_DATA_FILE_BLOCK_SIZE;
+	if (first_index >= df->df_data_block_count)
+		return 0;
+	nr_pages = min(nr_pages, df->df_data_block_count - first_index);
+
+	/* The entries are converted before hash_buf is used for hashes */
+	error = get_data_file_blocks(df, first_index, nr_pages,
+				     (struct incfs_blockmap_entry *)hash_buf,
+				     blocks);
+	if (error)
+		return error;
+
+	for (i = 0; i < nr_pages; i = j) {
+		struct data_file_block *first = &blocks[i];
+		bool in_pages = first->db_comp_alg == COMPRESSION_NONE;
+		size_t run_size = first->db_stored_size;
+		ssize_t result;
+
+		j = i + 1;
+		if (!is_data_block_present(first) ||
+		    first->db_stored_size > 2 * INCFS_DATA_FILE_BLOCK_SIZE)
+			continue;
+
+		/* Extend the run as long as blocks are stored contiguously */
+		while (j < nr_pages && is_data_block_present(&blocks[j]) &&
+		       blocks[j].db_stored_size <=
+				2 * INCFS_DATA_FILE_BLOCK_SIZE &&
+		       blocks[j].db_backing_file_data_offset ==
+				first->db_backing_file_data_offset + run_size) {
+			in_pages = in_pages &&
+				   blocks[j - 1].db_stored_size == PAGE_SIZE &&
+				   blocks[j].db_comp_alg == COMPRESSION_NONE;
+			run_size += blocks[j].db_stored_size;
+			j++;
+		}
+		in_pages = in_pages && blocks[j - 1].db_stored_size <= PAGE_SIZE;
+
+		if (in_pages)
+			result = read_blocks_to_pages(bfc, first, &pages[i],
+						      j - i);
+		else
+			result = incfs_kread(bfc, tmp.data, run_size,
+					first->db_backing_file_data_offset);
+		if (result != run_size)
+			continue;
+
+		for (k = i; k < j; k++) {
+			u8 *src = tmp.data +
+				(blocks[k].db_backing_file_data_offset -
+				 first->db_backing_file_data_offset);
+
+			if (!fill_page_from_run(f, df, first_index + k,
+						&blocks[k], pages[k], src,
+						in_pages, hash_buf))
+				filled++;
+		}
+	}
+
+	return filled;
+}
+
 ssize_t incfs_read_merkle_tree_blocks(struct mem_range dst,
 				      struct data_file *df, size_t offset)
 {
@@ -1385,6 +2256,7 @@ int incfs_process_new_data_block(struct data_file *df,
 	struct backing_file_context *bfc = NULL;
 	struct data_file_segment *segment = NULL;
 	struct data_file_block existing_block = {};
+	struct data_file_block new_block = {};
 	u16 flags = 0;
 	int error = 0;
 
@@ -1408,14 +2280,8 @@ int incfs_process_new_data_block(struct data_file *df,
 	else if (block->compression)
 		return -EINVAL;
 
-	error = down_read_killable(&segment->rwsem);
-	if (error)
-		return error;
-
-	error = get_data_file_block(df, block->block_index, &existing_block);
-
-	up_read(&segment->rwsem);
-
+	error = get_data_block_indexed(df, block->block_index,
+				       &existing_block);
 	if (error)
 		return error;
 	if (is_data_block_present(&existing_block)) {
@@ -1427,14 +2293,24 @@ int incfs_process_new_data_block(struct data_file *df,
 	if (error)
 		return error;
 
+	/* Another fill of the same block may have got here first */
+	if (test_bit(block->block_index, df->df_present_blocks)) {
+		up_write(&segment->rwsem);
+		return 0;
+	}
+
 	error = mutex_lock_interruptible(&bfc->bc_mutex);
 	if (!error) {
 		error = incfs_write_data_block_to_backing_file(
 			bfc, range(data, block->data_len), block->block_index,
-			df->df_blockmap_off, flags);
+			df->df_blockmap_off, flags,
+			&new_block.db_backing_file_data_offset);
 		mutex_unlock(&bfc->bc_mutex);
 	}
 	if (!error) {
+		new_block.db_stored_size = block->data_len;
+		new_block.db_comp_alg = flags & INCFS_BLOCK_COMPRESSED_MASK;
+		index_new_block(df, block->block_index, &new_block);
 		notify_pending_reads(mi, segment, block->block_index);
 		atomic_inc(&df->df_data_blocks_written);
 	}
@@ -1446,6 +2322,152 @@ int incfs_process_new_data_block(struct data_file *df,
 	return error;
 }
 
+/*
+ * Add the blocks of the @count blocks starting at @first_index that are
+ * present in the blockmap but absent from the index of mapped file @df,
+ * see df_mapped. Called with all segment rwsems held for write.
+ */
+static int index_mapped_range(struct data_file *df, int first_index,
+			      int count, struct incfs_blockmap_entry *bme)
+{
+	int error, i;
+
+	error = incfs_read_blockmap_entries(df->df_backing_file_context, bme,
+					    first_index, count,
+					    df->df_blockmap_off);
+	if (error < 0)
+		return error;
+	if (error != count)
+		return -EIO;
+
+	for (i = 0; i < count; i++) {
+		struct data_file_block block;
+
+		convert_data_file_block(&bme[i], &block);
+		if (is_data_block_present(&block) &&
+		    !test_bit(first_index + i, df->df_present_blocks))
+			index_new_block(df, first_index + i, &block);
+	}
+	return 0;
+}
+
+/*
+ * Fill the uncompressed data blocks starting at @first_index with the @size
+ * bytes in @bvec. Runs of blocks that are not present yet are written with a
+ * single backing file write and blockmap update each, and pending reads are
+ * woken up once for the whole range.
+ */
+int incfs_process_new_data_blocks(struct data_file *df, int first_index,
+				  struct bio_vec *bvec, unsigned int nr_segs,
+				  size_t size)
+{
+	struct backing_file_context *bfc = NULL;
+	struct incfs_blockmap_entry *bme = NULL;
+	int count = DIV_ROUND_UP(size, INCFS_DATA_FILE_BLOCK_SIZE);
+	int nr_written = 0;
+	int error = 0;
+	int i, j, seg;
+
+	if (!df || !bvec)
+		return -EFAULT;
+
+	bfc = df->df_backing_file_context;
+
+	if (first_index < 0 || !count ||
+	    count > df->df_data_block_count - first_index)
+		return -ERANGE;
+
+	/* Make the presence bits of the range authoritative */
+	for (i = first_index / INCFS_BLOCKMAP_CHUNK_BLOCKS;
+	     i <= (first_index + count - 1) / INCFS_BLOCKMAP_CHUNK_BLOCKS;
+	     i++) {
+		if (test_bit(i, df->df_loaded_chunks))
+			continue;
+		error = load_blockmap_chunk(df, i);
+		if (error)
+			return error;
+	}
+
+	/* That is not enough for mapped files */
+	if (df->df_mapped) {
+		bme = kmalloc_array(count, sizeof(*bme), GFP_NOFS);
+		if (!bme)
+			return -ENOMEM;
+	}
+
+	for (seg = 0; seg < ARRAY_SIZE(df->df_segments); seg++) {
+		error = down_write_killable(&df->df_segments[seg].rwsem);
+		if (error)
+			goto out_up;
+	}
+
+	if (bme) {
+		error = index_mapped_range(df, first_index, count, bme);
+		if (error)
+			goto out_up;
+	}
+
+	error = mutex_lock_interruptible(&bfc->bc_mutex);
+	if (error)
+		goto out_up;
+
+	for (i = 0; i < count; i = j) {
+		struct data_file_block block = {
+			.db_comp_alg = COMPRESSION_NONE,
+		};
+		struct iov_iter iter;
+		size_t run_start = (size_t)i * INCFS_DATA_FILE_BLOCK_SIZE;
+		loff_t data_offset;
+		int k;
+
+		j = i + 1;
+		if (test_bit(first_index + i, df->df_present_blocks))
+			continue;
+
+		while (j < count &&
+		       !test_bit(first_index + j, df->df_present_blocks))
+			j++;
+
+		iov_iter_bvec(&iter, WRITE, bvec, nr_segs, size);
+		iov_iter_advance(&iter, run_start);
+		iov_iter_truncate(&iter, min_t(size_t, size,
+				(size_t)j * INCFS_DATA_FILE_BLOCK_SIZE) -
+				run_start);
+		error = incfs_write_data_blocks_to_backing_file(bfc, &iter,
+				first_index + i, j - i, df->df_blockmap_off,
+				&data_offset);
+		if (error)
+			break;
+
+		for (k = i; k < j; k++) {
+			block.db_backing_file_data_offset = data_offset +
+				(loff_t)(k - i) * INCFS_DATA_FILE_BLOCK_SIZE;
+			block.db_stored_size = min_t(size_t, size -
+				(size_t)k * INCFS_DATA_FILE_BLOCK_SIZE,
+				INCFS_DATA_FILE_BLOCK_SIZE);
+			index_new_block(df, first_index + k, &block);
+		}
+		nr_written += j - i;
+	}
+
+	mutex_unlock(&bfc->bc_mutex);
+
+	if (nr_written) {
+		notify_pending_reads_range(df->df_mount_info, df, first_index,
+					   count, nr_written);
+		atomic_add(nr_written, &df->df_data_blocks_written);
+	}
+
+out_up:
+	while (seg--)
+		up_write(&df->df_segments[seg].rwsem);
+	kfree(bme);
+
+	if (error)
+		pr_debug("%d+%d error: %d\n", first_index, count, error);
+	return error;
+}
+
 int incfs_read_file_signature(struct data_file *df, struct mem_range dst)
 {
 	struct backing_file_context *bfc = df->df_backing_file_context;
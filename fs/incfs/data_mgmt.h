@@ -16,6 +16,7 @@
 #include <linux/zstd.h>
 #include <crypto/hash.h>
 #include <linux/rwsem.h>
+#include <linux/xarray.h>
 
 #include <uapi/linux/incrementalfs.h>
 
@@ -24,6 +25,8 @@
 
 #define SEGMENTS_PER_FILE 3
 
+struct bio_vec;
+
 enum LOG_RECORD_TYPE {
 	FULL,
 	SAME_FILE,
@@ -96,6 +99,36 @@ struct read_log_state {
 	u64 current_record_no;
 };
 
+/* Producer state of one CPU's mappable read log ring */
+struct read_log_ring_state {
+	incfs_uuid_t file_id;
+
+	u64 ts_us;
+
+	u32 block_index;
+
+	uid_t uid;
+
+	/* Whether the next record can be encoded relative to this one */
+	bool valid;
+};
+
+/*
+ * Per-cpu rings of read records that readers of the .log file can mmap.
+ * Each CPU appends to its own ring without locking, see
+ * struct incfs_log_ring_header for the protocol.
+ */
+struct read_log_rings {
+	/* One ring of rr_stride bytes per possible CPU id, header first */
+	void *rr_base;
+
+	size_t rr_stride;
+
+	u32 rr_data_size;
+
+	struct read_log_ring_state __percpu *rr_state;
+};
+
 /* A ring buffer to save records about data blocks which were recently read. */
 struct read_log {
 	void *rl_ring_buf;
@@ -109,6 +142,9 @@ struct read_log {
 	/* A lock to protect the above fields */
 	spinlock_t rl_lock;
 
+	/* Set up once at mount time, never resized while it may be mapped */
+	struct read_log_rings rl_cpu_rings;
+
 	/* A queue of waiters who want to be notified about reads */
 	wait_queue_head_t ml_notif_wq;
 
@@ -121,6 +157,7 @@ struct mount_options {
 	unsigned int readahead_pages;
 	unsigned int read_log_pages;
 	unsigned int read_log_wakeup_count;
+	unsigned int read_log_ring_pages;
 	bool report_uid;
 	char *sysfs_name;
 };
@@ -247,6 +284,38 @@ struct data_file_block {
 	enum incfs_compression_alg db_comp_alg;
 };
 
+/* Number of data blocks whose blockmap entries are indexed at once */
+#define INCFS_BLOCKMAP_CHUNK_BLOCKS 512
+
+/*
+ * Run of present data blocks stored back to back in the backing file. All
+ * blocks but the last one are uncompressed and full sized, so a compressed
+ * block is always an extent of its own.
+ */
+struct data_file_extent {
+	loff_t de_backing_offset;
+
+	/* First block of the extent, relative to its chunk */
+	u16 de_first;
+
+	u16 de_count;
+
+	/* Stored size of the last block */
+	u16 de_last_size;
+
+	u8 de_comp_alg;
+};
+
+/* Extents of one chunk of INCFS_BLOCKMAP_CHUNK_BLOCKS data blocks */
+struct blockmap_chunk {
+	/* Sorted by de_first */
+	struct data_file_extent *bc_extents;
+
+	u16 bc_nr_extents;
+
+	u16 bc_max_extents;
+};
+
 struct pending_read {
 	incfs_uuid_t file_id;
 
@@ -324,6 +393,14 @@ struct data_file {
 	/* For mapped files, the offset into the actual file */
 	loff_t df_mapped_offset;
 
+	/*
+	 * Set for mapped files. Their blocks are filled through the data_file
+	 * of the file they map, so the in-memory index below may miss present
+	 * blocks: for those files, a block that is absent from the index is
+	 * looked up in the blockmap.
+	 */
+	bool df_mapped;
+
 	/* Number of data blocks written to file */
 	atomic_t df_data_blocks_written;
 
@@ -358,6 +435,35 @@ struct data_file {
 	/* Guaranteed set if df_hash_tree is set. */
 	struct incfs_df_signature *df_signature;
 
+	/*
+	 * Verified hash blocks above the lowest hash tree level, indexed by
+	 * block number in the hash area.
+	 */
+	struct xarray df_hash_cache;
+
+	/*
+	 * In-memory index of the data block part of the blockmap. It is
+	 * loaded one chunk of INCFS_BLOCKMAP_CHUNK_BLOCKS entries at a time on
+	 * first use and kept up to date by incfs_process_new_data_block().
+	 * A bit in df_present_blocks is only set once the block is present,
+	 * but it is only authoritative once the chunk's bit in
+	 * df_loaded_chunks is set, and never for mapped files.
+	 *
+	 * Chunks are loaded under df_blockmap_mutex with all segment rwsems
+	 * held for read, and new blocks are indexed with their segment rwsem
+	 * held for write, so the two never race.
+	 */
+	struct mutex df_blockmap_mutex;
+
+	/* Protects the extent arrays of df_chunks */
+	spinlock_t df_extents_lock;
+
+	unsigned long *df_loaded_chunks;
+
+	unsigned long *df_present_blocks;
+
+	struct blockmap_chunk *df_chunks;
+
 	/*
 	 * The verity file digest, set when verity is enabled and the file has
 	 * been opened
@@ -431,6 +537,16 @@ ssize_t incfs_read_data_file_block(struct mem_range dst, struct file *f,
 			int index, struct mem_range tmp,
 			struct incfs_read_data_file_timeouts *timeouts);
 
+/* Maximum number of pages incfs_read_data_file_pages() handles at a time */
+#define INCFS_READ_BATCH_PAGES 16
+
+/* Size of the scratch buffer incfs_read_data_file_pages() needs */
+#define INCFS_READ_BATCH_TMP_SIZE \
+	((2 * INCFS_READ_BATCH_PAGES + 1) * INCFS_DATA_FILE_BLOCK_SIZE)
+
+int incfs_read_data_file_pages(struct file *f, struct page **pages,
+			       int nr_pages, struct mem_range tmp);
+
 ssize_t incfs_read_merkle_tree_blocks(struct mem_range dst,
 				      struct data_file *df, size_t offset);
 
@@ -443,6 +559,10 @@ int incfs_read_file_signature(struct data_file *df, struct mem_range dst);
 int incfs_process_new_data_block(struct data_file *df,
 				 struct incfs_fill_block *block, u8 *data);
 
+int incfs_process_new_data_blocks(struct data_file *df, int first_index,
+				  struct bio_vec *bvec, unsigned int nr_segs,
+				  size_t size);
+
 int incfs_process_new_hash_block(struct data_file *df,
 				 struct incfs_fill_block *block, u8 *data);
 
@@ -464,6 +584,8 @@ int incfs_collect_logged_reads(struct mount_info *mi,
 			       struct incfs_pending_read_info2 *reads2,
 			       int reads_size);
 struct read_log_state incfs_get_log_state(struct mount_info *mi);
+bool incfs_log_rings_have_data(struct mount_info *mi);
+
 int incfs_get_uncollected_logs_count(struct mount_info *mi,
 				     const struct read_log_state *state);
 
@@ -11,6 +11,7 @@
 #include <linux/slab.h>
 #include <linux/crc32.h>
 #include <linux/kernel.h>
+#include <linux/uio.h>
 
 #include "format.h"
 #include "data_mgmt.h"
@@ -475,7 +476,8 @@ int incfs_write_mapping_fh_to_backing_file(struct backing_file_context *bfc,
 /* Write a given data block and update file's blockmap to point it. */
 int incfs_write_data_block_to_backing_file(struct backing_file_context *bfc,
 				     struct mem_range block, int block_index,
-				     loff_t bm_base_off, u16 flags)
+				     loff_t bm_base_off, u16 flags,
+				     loff_t *data_offset_out)
 {
 	struct incfs_blockmap_entry bm_entry = {};
 	int result = 0;
@@ -508,8 +510,82 @@ int incfs_write_data_block_to_backing_file(struct backing_file_context *bfc,
 	bm_entry.me_data_size = cpu_to_le16((u16)block.len);
 	bm_entry.me_flags = cpu_to_le16(flags);
 
-	return write_to_bf(bfc, &bm_entry, sizeof(bm_entry),
-				bm_entry_off);
+	result = write_to_bf(bfc, &bm_entry, sizeof(bm_entry), bm_entry_off);
+	if (!result && data_offset_out)
+		*data_offset_out = data_offset;
+	return result;
+}
+
+/*
+ * Append the data of @count consecutive uncompressed data blocks starting at
+ * @block_index from @iter and point their blockmap entries at it, with one
+ * write each. All blocks but the last one must be full.
+ */
+int incfs_write_data_blocks_to_backing_file(struct backing_file_context *bfc,
+					    struct iov_iter *iter,
+					    int block_index, int count,
+					    loff_t bm_base_off,
+					    loff_t *data_offset_out)
+{
+	struct incfs_blockmap_entry *bm_entries;
+	size_t size = iov_iter_count(iter);
+	ssize_t written;
+	loff_t data_offset = 0;
+	loff_t bm_entry_off =
+		bm_base_off + sizeof(struct incfs_blockmap_entry) * block_index;
+	int result = 0;
+	int i;
+
+	if (!bfc)
+		return -EFAULT;
+
+	if (block_index < 0 || count <= 0 ||
+	    size <= (size_t)(count - 1) * INCFS_DATA_FILE_BLOCK_SIZE ||
+	    size > (size_t)count * INCFS_DATA_FILE_BLOCK_SIZE)
+		return -EINVAL;
+
+	LOCK_REQUIRED(bfc->bc_mutex);
+
+	data_offset = incfs_get_end_offset(bfc->bc_file);
+	if (data_offset <= bm_entry_off) {
+		/* Blockmap entry is beyond the file's end. It is not normal. */
+		return -EINVAL;
+	}
+
+	bm_entries = kcalloc(count, sizeof(*bm_entries), GFP_NOFS);
+	if (!bm_entries)
+		return -ENOMEM;
+
+	/* Write the blocks' data at the end of the backing file. */
+	written = incfs_kwrite_iter(bfc, iter, data_offset);
+	if (written < 0) {
+		result = written;
+		goto out;
+	}
+	if (written != size) {
+		result = -EIO;
+		goto out;
+	}
+
+	/* Update the blockmap to point to the newly written data. */
+	for (i = 0; i < count; i++) {
+		loff_t offset = data_offset + i * INCFS_DATA_FILE_BLOCK_SIZE;
+		u16 len = i < count - 1 ? INCFS_DATA_FILE_BLOCK_SIZE :
+			  size - i * INCFS_DATA_FILE_BLOCK_SIZE;
+
+		bm_entries[i].me_data_offset_lo = cpu_to_le32((u32)offset);
+		bm_entries[i].me_data_offset_hi =
+			cpu_to_le16((u16)(offset >> 32));
+		bm_entries[i].me_data_size = cpu_to_le16(len);
+	}
+
+	result = write_to_bf(bfc, bm_entries, count * sizeof(*bm_entries),
+			     bm_entry_off);
+	if (!result && data_offset_out)
+		*data_offset_out = data_offset;
+out:
+	kfree(bm_entries);
+	return result;
 }
 
 int incfs_write_hash_block_to_backing_file(struct backing_file_context *bfc,
@@ -741,6 +817,20 @@ ssize_t incfs_kread(struct backing_file_context *bfc, void *buf, size_t size,
 	return ret;
 }
 
+ssize_t incfs_kread_bvec(struct backing_file_context *bfc, struct bio_vec *bvec,
+			 unsigned int nr_segs, size_t size, loff_t pos)
+{
+	const struct cred *old_cred = override_creds(bfc->bc_cred);
+	struct iov_iter iter;
+	ssize_t ret;
+
+	iov_iter_bvec(&iter, READ, bvec, nr_segs, size);
+	ret = vfs_iter_read(bfc->bc_file, &iter, &pos, 0);
+
+	revert_creds(old_cred);
+	return ret;
+}
+
 ssize_t incfs_kwrite(struct backing_file_context *bfc, const void *buf,
 		     size_t size, loff_t pos)
 {
@@ -750,3 +840,17 @@ ssize_t incfs_kwrite(struct backing_file_context *bfc, const void *buf,
 	revert_creds(old_cred);
 	return ret;
 }
+
+ssize_t incfs_kwrite_iter(struct backing_file_context *bfc,
+			  struct iov_iter *iter, loff_t pos)
+{
+	const struct cred *old_cred = override_creds(bfc->bc_cred);
+	ssize_t ret;
+
+	file_start_write(bfc->bc_file);
+	ret = vfs_iter_write(bfc->bc_file, iter, &pos, 0);
+	file_end_write(bfc->bc_file);
+
+	revert_creds(old_cred);
+	return ret;
+}
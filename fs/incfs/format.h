@@ -110,6 +110,9 @@
 
 #include "internal.h"
 
+struct bio_vec;
+struct iov_iter;
+
 #define INCFS_MAX_NAME_LEN 255
 #define INCFS_FORMAT_V1 1
 #define INCFS_FORMAT_CURRENT_VER INCFS_FORMAT_V1
@@ -361,7 +364,13 @@ int incfs_write_mapping_fh_to_backing_file(struct backing_file_context *bfc,
 int incfs_write_data_block_to_backing_file(struct backing_file_context *bfc,
 					   struct mem_range block,
 					   int block_index, loff_t bm_base_off,
-					   u16 flags);
+					   u16 flags, loff_t *data_offset_out);
+
+int incfs_write_data_blocks_to_backing_file(struct backing_file_context *bfc,
+					    struct iov_iter *iter,
+					    int block_index, int count,
+					    loff_t bm_base_off,
+					    loff_t *data_offset_out);
 
 int incfs_write_hash_block_to_backing_file(struct backing_file_context *bfc,
 					   struct mem_range block,
@@ -401,7 +410,11 @@ int incfs_read_next_metadata_record(struct backing_file_context *bfc,
 
 ssize_t incfs_kread(struct backing_file_context *bfc, void *buf, size_t size,
 		    loff_t pos);
+ssize_t incfs_kread_bvec(struct backing_file_context *bfc, struct bio_vec *bvec,
+			 unsigned int nr_segs, size_t size, loff_t pos);
 ssize_t incfs_kwrite(struct backing_file_context *bfc, const void *buf,
 		     size_t size, loff_t pos);
+ssize_t incfs_kwrite_iter(struct backing_file_context *bfc,
+			  struct iov_iter *iter, loff_t pos);
 
 #endif /* _INCFS_FORMAT_H */
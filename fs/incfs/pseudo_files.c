@@ -9,6 +9,7 @@
 #include <linux/namei.h>
 #include <linux/poll.h>
 #include <linux/syscalls.h>
+#include <linux/vmalloc.h>
 
 #include <uapi/linux/incrementalfs.h>
 
@@ -1144,7 +1145,8 @@ static __poll_t log_poll(struct file *file, poll_table *wait)
 
 	poll_wait(file, &mi->mi_log.ml_notif_wq, wait);
 	count = incfs_get_uncollected_logs_count(mi, &log_state->state);
-	if (count >= mi->mi_options.read_log_wakeup_count)
+	if (count >= mi->mi_options.read_log_wakeup_count ||
+	    incfs_log_rings_have_data(mi))
 		ret = EPOLLIN | EPOLLRDNORM;
 
 	return ret;
@@ -1170,9 +1172,26 @@ static int log_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
+/* Map the per-cpu read log rings, see struct incfs_log_ring_header */
+static int log_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct mount_info *mi = get_mount_info(file_superblock(file));
+	void *base = smp_load_acquire(&mi->mi_log.rl_cpu_rings.rr_base);
+
+	if (!base)
+		return -ENODEV;
+
+	/* The reader has to be able to publish its tail */
+	if (!(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, base, vma->vm_pgoff);
+}
+
 static const struct file_operations incfs_log_file_ops = {
 	.read = log_read,
 	.poll = log_poll,
+	.mmap = log_mmap,
 	.open = log_open,
 	.release = log_release,
 	.llseek = noop_llseek,
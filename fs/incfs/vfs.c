@@ -45,6 +45,7 @@ static int dir_rename(struct inode *old_dir, struct dentry *old_dentry,
 static int file_open(struct inode *inode, struct file *file);
 static int file_release(struct inode *inode, struct file *file);
 static int read_single_page(struct file *f, struct page *page);
+static void readahead(struct readahead_control *rac);
 static long dispatch_ioctl(struct file *f, unsigned int req, unsigned long arg);
 
 #ifdef CONFIG_COMPAT
@@ -109,7 +110,7 @@ static const struct dentry_operations incfs_dentry_ops = {
 
 static const struct address_space_operations incfs_address_space_ops = {
 	.readpage = read_single_page,
-	/* .readpages = readpages */
+	.readahead = readahead,
 };
 
 static vm_fault_t incfs_fault(struct vm_fault *vmf)
@@ -198,6 +199,7 @@ enum parse_parameter {
 	Opt_readahead_pages,
 	Opt_rlog_pages,
 	Opt_rlog_wakeup_cnt,
+	Opt_rlog_ring_pages,
 	Opt_report_uid,
 	Opt_sysfs_name,
 	Opt_err
@@ -208,6 +210,7 @@ static const match_table_t option_tokens = {
 	{ Opt_readahead_pages, "readahead=%u" },
 	{ Opt_rlog_pages, "rlog_pages=%u" },
 	{ Opt_rlog_wakeup_cnt, "rlog_wakeup_cnt=%u" },
+	{ Opt_rlog_ring_pages, "rlog_ring_pages=%u" },
 	{ Opt_report_uid, "report_uid" },
 	{ Opt_sysfs_name, "sysfs_name=%s" },
 	{ Opt_err, NULL }
@@ -269,6 +272,13 @@ static int parse_options(struct mount_options *opts, char *str)
 				return -EINVAL;
 			opts->read_log_wakeup_count = value;
 			break;
+		case Opt_rlog_ring_pages:
+			if (match_int(&args[0], &value))
+				return -EINVAL;
+			if (value < 0 || value > 1024)
+				return -EINVAL;
+			opts->read_log_ring_pages = value;
+			break;
 		case Opt_report_uid:
 			opts->report_uid = true;
 			break;
@@ -475,17 +485,16 @@ static struct dentry *open_or_create_special_dir(struct dentry *backing_dir,
 	return index_dentry;
 }
 
-static int read_single_page_timeouts(struct data_file *df, struct file *f,
-				     int block_index, struct mem_range range,
-				     struct mem_range tmp)
+static void get_read_timeouts(struct mount_info *mi,
+			      struct incfs_read_data_file_timeouts *timeouts)
 {
-	struct mount_info *mi = df->df_mount_info;
-	struct incfs_read_data_file_timeouts timeouts = {
-		.max_pending_time_us = U32_MAX,
-	};
 	int uid = current_uid().val;
 	int i;
 
+	*timeouts = (struct incfs_read_data_file_timeouts) {
+		.max_pending_time_us = U32_MAX,
+	};
+
 	spin_lock(&mi->mi_per_uid_read_timeouts_lock);
 	for (i = 0; i < mi->mi_per_uid_read_timeouts_size /
 		sizeof(*mi->mi_per_uid_read_timeouts); ++i) {
@@ -493,21 +502,29 @@ static int read_single_page_timeouts(struct data_file *df, struct file *f,
 			&mi->mi_per_uid_read_timeouts[i];
 
 		if(t->uid == uid) {
-			timeouts.min_time_us = t->min_time_us;
-			timeouts.min_pending_time_us = t->min_pending_time_us;
-			timeouts.max_pending_time_us = t->max_pending_time_us;
+			timeouts->min_time_us = t->min_time_us;
+			timeouts->min_pending_time_us = t->min_pending_time_us;
+			timeouts->max_pending_time_us = t->max_pending_time_us;
 			break;
 		}
 	}
 	spin_unlock(&mi->mi_per_uid_read_timeouts_lock);
-	if (timeouts.max_pending_time_us == U32_MAX) {
+	if (timeouts->max_pending_time_us == U32_MAX) {
 		u64 read_timeout_us = (u64)mi->mi_options.read_timeout_ms *
 					1000;
 
-		timeouts.max_pending_time_us = read_timeout_us <= U32_MAX ?
+		timeouts->max_pending_time_us = read_timeout_us <= U32_MAX ?
 					       read_timeout_us : U32_MAX;
 	}
+}
+
+static int read_single_page_timeouts(struct data_file *df, struct file *f,
+				     int block_index, struct mem_range range,
+				     struct mem_range tmp)
+{
+	struct incfs_read_data_file_timeouts timeouts;
 
+	get_read_timeouts(df->df_mount_info, &timeouts);
 	return incfs_read_data_file_block(range, f, block_index, tmp,
 					  &timeouts);
 }
@@ -572,6 +589,44 @@ static int read_single_page(struct file *f, struct page *page)
 	return result;
 }
 
+/*
+ * Read the pages whose blocks are already present in batches, coalescing
+ * backing file reads. Pages left behind are unlocked by the caller and read
+ * through read_single_page() if and when they are accessed, which also
+ * takes care of waiting for missing blocks.
+ */
+static void readahead(struct readahead_control *rac)
+{
+	struct data_file *df = get_incfs_data_file(rac->file);
+	struct incfs_read_data_file_timeouts timeouts;
+	struct page *pages[INCFS_READ_BATCH_PAGES];
+	struct mem_range tmp;
+	unsigned int nr, i;
+
+	if (!df)
+		return;
+
+	/* Per uid delays must apply to every read, leave it to readpage */
+	get_read_timeouts(df->df_mount_info, &timeouts);
+	if (timeouts.min_time_us || timeouts.min_pending_time_us)
+		return;
+
+	tmp.len = INCFS_READ_BATCH_TMP_SIZE;
+	tmp.data = kvmalloc(tmp.len, GFP_NOFS);
+	if (!tmp.data)
+		return;
+
+	while ((nr = readahead_page_batch(rac, pages))) {
+		incfs_read_data_file_pages(rac->file, pages, nr, tmp);
+		for (i = 0; i < nr; i++) {
+			unlock_page(pages[i]);
+			put_page(pages[i]);
+		}
+	}
+
+	kvfree(tmp.data);
+}
+
 int incfs_link(struct dentry *what, struct dentry *where)
 {
 	struct dentry *parent_dentry = dget_parent(where);
@@ -795,6 +850,84 @@ static long ioctl_fill_blocks(struct file *f, void __user *arg)
 	return i;
 }
 
+static long ioctl_fill_block_range(struct file *f, void __user *arg)
+{
+	struct incfs_fill_block_range __user *usr_range = arg;
+	struct incfs_fill_block_range range;
+	struct data_file *df = get_incfs_data_file(f);
+	struct incfs_file_data *fd = f->private_data;
+	struct page **pages = NULL;
+	struct bio_vec *bvec = NULL;
+	unsigned long start;
+	size_t offset, remaining;
+	int nr_pages, pinned = 0;
+	long error = 0;
+	int i;
+
+	if (!df)
+		return -EBADF;
+
+	if (!fd || fd->fd_fill_permission != CAN_FILL)
+		return -EPERM;
+
+	if (copy_from_user(&range, usr_range, sizeof(range)))
+		return -EFAULT;
+
+	if (range.reserved || !range.data_len)
+		return -EINVAL;
+
+	if (range.data_len >
+	    INCFS_MAX_FILL_RANGE_BLOCKS * INCFS_DATA_FILE_BLOCK_SIZE)
+		return -E2BIG;
+
+	/*
+	 * Pin the loader's buffer rather than copying it, the backing file
+	 * write is then the only copy of the data.
+	 */
+	start = (unsigned long)u64_to_user_ptr(range.data);
+	offset = offset_in_page(start);
+	nr_pages = DIV_ROUND_UP(offset + range.data_len, PAGE_SIZE);
+
+	pages = kmalloc_array(nr_pages, sizeof(*pages), GFP_KERNEL);
+	bvec = kmalloc_array(nr_pages, sizeof(*bvec), GFP_KERNEL);
+	if (!pages || !bvec) {
+		error = -ENOMEM;
+		goto out;
+	}
+
+	pinned = pin_user_pages_fast(start & PAGE_MASK, nr_pages, 0, pages);
+	if (pinned < 0) {
+		error = pinned;
+		pinned = 0;
+		goto out;
+	}
+	if (pinned != nr_pages) {
+		error = -EFAULT;
+		goto out;
+	}
+
+	remaining = range.data_len;
+	for (i = 0; i < nr_pages; i++) {
+		bvec[i].bv_page = pages[i];
+		bvec[i].bv_offset = i ? 0 : offset;
+		bvec[i].bv_len = min_t(size_t, PAGE_SIZE - bvec[i].bv_offset,
+				       remaining);
+		remaining -= bvec[i].bv_len;
+	}
+
+	error = incfs_process_new_data_blocks(df, range.block_index, bvec,
+					      nr_pages, range.data_len);
+
+	maybe_delete_incomplete_file(f, df);
+
+out:
+	if (pinned)
+		unpin_user_pages(pages, pinned);
+	kfree(bvec);
+	kfree(pages);
+	return error;
+}
+
 static long ioctl_read_file_signature(struct file *f, void __user *arg)
 {
 	struct incfs_get_file_sig_args __user *args_usr_ptr = arg;
@@ -901,6 +1034,8 @@ static long dispatch_ioctl(struct file *f, unsigned int req, unsigned long arg)
 	switch (req) {
 	case INCFS_IOC_FILL_BLOCKS:
 		return ioctl_fill_blocks(f, (void __user *)arg);
+	case INCFS_IOC_FILL_BLOCK_RANGE:
+		return ioctl_fill_block_range(f, (void __user *)arg);
 	case INCFS_IOC_READ_FILE_SIGNATURE:
 		return ioctl_read_file_signature(f, (void __user *)arg);
 	case INCFS_IOC_GET_FILLED_BLOCKS:
@@ -929,6 +1064,7 @@ static long incfs_compat_ioctl(struct file *file, unsigned int cmd,
 		cmd = FS_IOC_GETFLAGS;
 		break;
 	case INCFS_IOC_FILL_BLOCKS:
+	case INCFS_IOC_FILL_BLOCK_RANGE:
 	case INCFS_IOC_READ_FILE_SIGNATURE:
 	case INCFS_IOC_GET_FILLED_BLOCKS:
 	case INCFS_IOC_GET_BLOCK_COUNT:
@@ -1944,6 +2080,9 @@ static int show_options(struct seq_file *m, struct dentry *root)
 		seq_printf(m, ",rlog_wakeup_cnt=%u",
 			   mi->mi_options.read_log_wakeup_count);
 	}
+	if (mi->mi_options.read_log_ring_pages != 0)
+		seq_printf(m, ",rlog_ring_pages=%u",
+			   mi->mi_options.read_log_ring_pages);
 	if (mi->mi_options.report_uid)
 		seq_puts(m, ",report_uid");
 
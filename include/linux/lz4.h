@@ -320,6 +320,23 @@ int LZ4_decompress_safe(const char *source, char *dest, int compressedSize,
 int LZ4_decompress_safe_partial(const char *source, char *dest,
 	int compressedSize, int targetOutputSize, int maxDecompressedSize);
 
+/*
+ * The above, always using the generic C decompressor rather than an
+ * architecture specific one selected at boot (e.g. to compare them)
+ */
+int LZ4_decompress_safe_generic(const char *source, char *dest,
+	int compressedSize, int maxDecompressedSize);
+int LZ4_decompress_safe_partial_generic(const char *source, char *dest,
+	int compressedSize, int targetOutputSize, int maxDecompressedSize);
+
+#ifdef CONFIG_LZ4_DECOMPRESS_NEON
+/* arm64 NEON decompressor, must be called under kernel_neon_begin() */
+int LZ4_decompress_safe_neon(const char *source, char *dest,
+	int compressedSize, int maxDecompressedSize);
+int LZ4_decompress_safe_partial_neon(const char *source, char *dest,
+	int compressedSize, int targetOutputSize, int maxDecompressedSize);
+#endif
+
 /*-************************************************************************
  *	LZ4 HC Compression
  **************************************************************************/
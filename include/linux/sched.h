@@ -1756,6 +1756,9 @@ extern void sched_set_normal(struct task_struct *p, int nice);
 extern int sched_setattr(struct task_struct *, const struct sched_attr *);
 extern int sched_setattr_nocheck(struct task_struct *, const struct sched_attr *);
 extern struct task_struct *idle_task(int cpu);
+#ifdef CONFIG_UCLAMP_TASK
+extern unsigned long uclamp_eff_value(struct task_struct *p, enum uclamp_id clamp_id);
+#endif
 
 /**
  * is_idle_task - is the specified task an idle task?
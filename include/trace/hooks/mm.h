@@ -38,6 +38,10 @@ DECLARE_RESTRICTED_HOOK(android_rvh_set_readahead_gfp_mask,
 DECLARE_HOOK(android_vh_cma_alloc_start,
 	TP_PROTO(s64 *ts),
 	TP_ARGS(ts));
+/* before the bitmap of @cma is searched, may sleep */
+DECLARE_RESTRICTED_HOOK(android_rvh_cma_alloc_prepare,
+	TP_PROTO(struct cma *cma),
+	TP_ARGS(cma), 1);
 DECLARE_HOOK(android_vh_cma_alloc_finish,
 	TP_PROTO(struct cma *cma, struct page *page, unsigned long count,
 		 unsigned int align, gfp_t gfp_mask, s64 ts),
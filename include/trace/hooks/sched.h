@@ -12,6 +12,7 @@
 struct cgroup_taskset;
 struct cgroup_subsys_state;
 struct cpufreq_policy;
+struct cpumask;
 struct em_perf_domain;
 enum uclamp_id;
 struct sched_entity;
@@ -412,6 +413,10 @@ DECLARE_HOOK(android_vh_mmput,
 DECLARE_HOOK(android_vh_rebuild_root_domains_bypass,
 	TP_PROTO(bool tasks_frozen, bool *bypass),
 	TP_ARGS(tasks_frozen, bypass));
+
+DECLARE_HOOK(android_vh_io_wq_worker_cpus,
+	TP_PROTO(struct task_struct *owner, struct cpumask *mask),
+	TP_ARGS(owner, mask));
 /* macro versions of hooks are no longer required */
 
 #endif /* _TRACE_HOOK_SCHED_H */
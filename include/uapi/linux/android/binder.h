@@ -173,6 +173,14 @@ struct binder_fd_object {
  * in the offset array pointing to the parent binder_buffer_object,
  * and by setting @parent_offset to the offset in the parent buffer
  * at which the pointer to this buffer is located.
+ *
+ * Large buffers with the BINDER_BUFFER_FLAG_ZERO_COPY flag set may have
+ * their whole pages mapped into the target instead of copied, if they
+ * live in a shared memfd mapping sealed with F_SEAL_WRITE and
+ * F_SEAL_SHRINK. The buffer is then placed at the same offset within a
+ * page as in the sender, so senders should reserve up to a page of
+ * extra room in buffers_size for each such buffer. Buffers that do not
+ * qualify are copied as usual.
  */
 struct binder_buffer_object {
 	struct binder_object_header	hdr;
@@ -185,6 +193,7 @@ struct binder_buffer_object {
 
 enum {
 	BINDER_BUFFER_FLAG_HAS_PARENT = 0x01,
+	BINDER_BUFFER_FLAG_ZERO_COPY = 0x02,
 };
 
 /* struct binder_fd_array_object - object describing an array of fds in a buffer
@@ -284,6 +293,38 @@ struct binder_frozen_status_info {
 	__u32            async_recv;
 };
 
+/*
+ * Use with BINDER_GET_POOL_INFO to decide whether the thread pool of the
+ * calling process should grow or shrink.
+ */
+struct binder_pool_info {
+	/* transactions waiting for a thread to become available */
+	__u32            queued;
+	/* threads waiting for work */
+	__u32            idle_threads;
+	/* threads started in response to BR_SPAWN_LOOPER */
+	__u32            started_threads;
+	__u32            max_threads;
+	/* time the oldest queued transaction has been waiting */
+	__u64            oldest_wait_ns;
+	/* 99th percentile of recent queue waits, rounded up to a power of 2 */
+	__u64            wait_p99_ns;
+	/* longest queue wait since the previous BINDER_GET_POOL_INFO */
+	__u64            wait_max_ns;
+};
+
+/*
+ * Use with BINDER_SET_POOL_NOTIFY to have the eventfd signalled when
+ * queue_depth transactions are waiting for a thread, or a transaction
+ * waited longer than wait_ns. Either threshold can be 0 to disable it.
+ * Pass an eventfd of -1 to stop notifications.
+ */
+struct binder_pool_notify {
+	__s32            eventfd;
+	__u32            queue_depth;
+	__u64            wait_ns;
+};
+
 #define BINDER_WRITE_READ		_IOWR('b', 1, struct binder_write_read)
 #define BINDER_SET_IDLE_TIMEOUT		_IOW('b', 3, __s64)
 #define BINDER_SET_MAX_THREADS		_IOW('b', 5, __u32)
@@ -297,6 +338,8 @@ struct binder_frozen_status_info {
 #define BINDER_FREEZE			_IOW('b', 14, struct binder_freeze_info)
 #define BINDER_GET_FROZEN_INFO		_IOWR('b', 15, struct binder_frozen_status_info)
 #define BINDER_ENABLE_ONEWAY_SPAM_DETECTION	_IOW('b', 16, __u32)
+#define BINDER_GET_POOL_INFO		_IOR('b', 32, struct binder_pool_info)
+#define BINDER_SET_POOL_NOTIFY		_IOW('b', 33, struct binder_pool_notify)
 
 /*
  * NOTE: Two special error codes you should check for when calling
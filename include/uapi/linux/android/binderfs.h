@@ -31,5 +31,76 @@ struct binderfs_device {
  */
 #define BINDER_CTL_ADD _IOWR('b', 1, struct binderfs_device)
 
+/*
+ * Layout of the binary binder_logs/transaction_stats file: one
+ * struct binderfs_txn_stats_header followed by @nr_entries
+ * struct binderfs_txn_stats_entry records.
+ *
+ * Latencies are bucketed in nanoseconds, log-linear: values are first
+ * shifted right by BINDERFS_TXN_STATS_MIN_SHIFT, the first
+ * 2^BINDERFS_TXN_STATS_SUB_BITS buckets are linear and every further
+ * power of two is split into 2^BINDERFS_TXN_STATS_SUB_BITS buckets.
+ * The last bucket also counts all larger values.
+ */
+#define BINDERFS_TXN_STATS_MAGIC	0x62747873	/* "btxs" */
+#define BINDERFS_TXN_STATS_VERSION	1
+#define BINDERFS_TXN_STATS_MIN_SHIFT	10
+#define BINDERFS_TXN_STATS_SUB_BITS	2
+#define BINDERFS_TXN_STATS_NR_BUCKETS	104
+
+enum binderfs_txn_stats_metric {
+	/* BC_TRANSACTION until the target thread picks it up */
+	BINDERFS_TXN_STATS_QUEUE_WAIT,
+	/* BR_TRANSACTION until the target sends BC_REPLY */
+	BINDERFS_TXN_STATS_HANDLE,
+	/* BC_TRANSACTION until the caller picks up BR_REPLY */
+	BINDERFS_TXN_STATS_REPLY,
+	BINDERFS_TXN_STATS_NR_METRICS,
+};
+
+/**
+ * struct binderfs_txn_stats_header - transaction_stats file header
+ * @magic:       BINDERFS_TXN_STATS_MAGIC
+ * @version:     BINDERFS_TXN_STATS_VERSION
+ * @nr_entries:  number of entries following the header
+ * @nr_buckets:  BINDERFS_TXN_STATS_NR_BUCKETS
+ * @nr_metrics:  BINDERFS_TXN_STATS_NR_METRICS
+ * @min_shift:   BINDERFS_TXN_STATS_MIN_SHIFT
+ * @sub_bits:    BINDERFS_TXN_STATS_SUB_BITS
+ * @reserved:    must be zero
+ * @dropped:     transactions not accounted because the table was full
+ */
+struct binderfs_txn_stats_header {
+	__u32 magic;
+	__u32 version;
+	__u32 nr_entries;
+	__u32 nr_buckets;
+	__u32 nr_metrics;
+	__u32 min_shift;
+	__u32 sub_bits;
+	__u32 reserved;
+	__u64 dropped;
+};
+
+/**
+ * struct binderfs_txn_stats_entry - latency histograms for one key
+ * @sender_uid:  effective uid of the sending process
+ * @sender_pid:  pid (tgid) of the sending process
+ * @target_pid:  pid (tgid) of the receiving process
+ * @target_node: debug id of the target binder node
+ * @code:        transaction code
+ * @reserved:    must be zero
+ * @counts:      per-metric histogram buckets
+ */
+struct binderfs_txn_stats_entry {
+	__u32 sender_uid;
+	__u32 sender_pid;
+	__u32 target_pid;
+	__u32 target_node;
+	__u32 code;
+	__u32 reserved;
+	__u64 counts[BINDERFS_TXN_STATS_NR_METRICS][BINDERFS_TXN_STATS_NR_BUCKETS];
+};
+
 #endif /* _UAPI_LINUX_BINDERFS_H */
 
@@ -95,4 +95,45 @@ struct f2fs_comp_option {
 	__u8 log_cluster_size;
 };
 
+/*
+ * Layout of /sys/fs/f2fs/<disk>/iostat_owners: a header followed by
+ * nr_entries entries, each accounting the bios whose first page belongs
+ * to a uid or an inode. Only the owners with the most I/O are kept.
+ */
+#define F2FS_IOSTAT_OWNERS_MAGIC	0xf2f5105a
+#define F2FS_IOSTAT_OWNERS_VERSION	1
+
+enum {
+	F2FS_IOSTAT_OWNER_UID,
+	F2FS_IOSTAT_OWNER_INO,
+	F2FS_IOSTAT_NR_OWNER_TYPES,
+};
+
+enum {
+	F2FS_IOSTAT_OWNER_READ,
+	F2FS_IOSTAT_OWNER_WRITE_SYNC,
+	F2FS_IOSTAT_OWNER_WRITE_ASYNC,
+	F2FS_IOSTAT_OWNER_NR_IO,
+};
+
+/* bucket i counts bios completed in [2^(i-1), 2^i) us, bucket 0 below 1us */
+#define F2FS_IOSTAT_OWNER_NR_BUCKETS	24
+
+struct f2fs_iostat_owners_header {
+	__u32 magic;
+	__u32 version;
+	__u32 nr_entries;
+	__u32 nr_buckets;
+	__u64 nr_evicted;		/* owners replaced by busier ones */
+};
+
+struct f2fs_iostat_owner_entry {
+	__u32 type;			/* F2FS_IOSTAT_OWNER_* */
+	__u32 id;			/* uid or inode number */
+	__u32 uid;			/* owner uid of the inode */
+	__u32 reserved;
+	__u64 bytes[F2FS_IOSTAT_OWNER_NR_IO];
+	__u32 lat[F2FS_IOSTAT_OWNER_NR_IO][F2FS_IOSTAT_OWNER_NR_BUCKETS];
+};
+
 #endif /* _UAPI_LINUX_F2FS_H */
@@ -34,6 +34,7 @@
  */
 #define INCFS_MAX_HASH_SIZE 32
 #define INCFS_MAX_FILE_ATTR_SIZE 512
+#define INCFS_MAX_FILL_RANGE_BLOCKS 256
 
 #define INCFS_INDEX_NAME ".index"
 #define INCFS_INCOMPLETE_NAME ".incomplete"
@@ -141,6 +142,17 @@
 #define INCFS_IOC_GET_LAST_READ_ERROR \
 	_IOW(INCFS_IOCTL_BASE_CODE, 39, struct incfs_get_last_read_error_args)
 
+/*
+ * Fill in a range of uncompressed data blocks from a single buffer. This may
+ * only be called on a handle passed as a parameter to INCFS_IOC_PERMIT_FILL
+ *
+ * Blocks of the range that are already present are left alone.
+ *
+ * Returns 0 on success or error
+ */
+#define INCFS_IOC_FILL_BLOCK_RANGE \
+	_IOW(INCFS_IOCTL_BASE_CODE, 40, struct incfs_fill_block_range)
+
 /* ===== sysfs feature flags ===== */
 /*
  * Each flag is represented by a file in /sys/fs/incremental-fs/features
@@ -169,6 +181,11 @@
  */
 #define INCFS_FEATURE_FLAG_V2 "v2"
 
+/*
+ * INCFS_IOC_FILL_BLOCK_RANGE support
+ */
+#define INCFS_FEATURE_FLAG_FILL_RANGE "fill_range"
+
 enum incfs_compression_alg {
 	COMPRESSION_NONE = 0,
 	COMPRESSION_LZ4 = 1,
@@ -230,6 +247,102 @@ struct incfs_pending_read_info2 {
 	__u32 reserved;
 };
 
+/*
+ * Mappable read log.
+ *
+ * When the file system is mounted with rlog_ring_pages=N, reads are also
+ * logged to a ring per possible CPU that readers of the .log file can mmap()
+ * with MAP_SHARED from offset 0. CPU i's ring starts at
+ * i * (header_size + data_size) and consists of a struct
+ * incfs_log_ring_header, padded to header_size, followed by data_size bytes
+ * of records.
+ *
+ * head and tail count bytes written and consumed since the ring was created.
+ * The kernel only writes head, with release semantics, after the records
+ * are in place. The reader consumes the records between tail and head,
+ * found at offset (position % data_size) in the data area, and then stores
+ * the new tail with release semantics. The kernel never overwrites records
+ * that have not been consumed; it drops new records instead and counts them
+ * in dropped.
+ *
+ * Records are a byte stream without alignment. Each one starts with a byte
+ * from enum incfs_log_ring_record_type. A record never wraps around the end
+ * of the data area; when the next record doesn't fit, the kernel writes an
+ * INCFS_LOG_RING_PAD byte and continues at the start of the data area.
+ *
+ * INCFS_LOG_RING_DELTA and INCFS_LOG_RING_NEXT records describe a read
+ * relative to the previous record in the same ring. The first record of a
+ * ring and the first record after a drop are INCFS_LOG_RING_FULL.
+ */
+struct incfs_log_ring_header {
+	__aligned_u64 head;
+
+	__aligned_u64 tail;
+
+	/* Number of records dropped because the ring was full */
+	__aligned_u64 dropped;
+
+	__u32 header_size;
+
+	/* Size of the data area, a power of two */
+	__u32 data_size;
+};
+
+enum incfs_log_ring_record_type {
+	/* Skip to the start of the data area */
+	INCFS_LOG_RING_PAD = 0,
+
+	/* struct incfs_log_ring_full */
+	INCFS_LOG_RING_FULL = 1,
+
+	/* struct incfs_log_ring_delta */
+	INCFS_LOG_RING_DELTA = 2,
+
+	/* struct incfs_log_ring_next */
+	INCFS_LOG_RING_NEXT = 3,
+};
+
+/* A read of any block */
+struct incfs_log_ring_full {
+	__u8 type;
+
+	__u8 reserved[3];
+
+	__u32 block_index;
+
+	__u8 file_id[16];
+
+	/* A number of microseconds since system boot to the read. */
+	__u64 timestamp_us;
+
+	/* The UID of the reading process */
+	__u32 uid;
+} __attribute__((packed));
+
+/* A read from the same file by the same UID as the previous record */
+struct incfs_log_ring_delta {
+	__u8 type;
+
+	__u8 reserved;
+
+	/* Microseconds since the previous record */
+	__u16 ts_delta_us;
+
+	/* Block index relative to the previous record */
+	__s32 block_delta;
+} __attribute__((packed));
+
+/*
+ * A read of the block after the previous record's, from the same file by the
+ * same UID
+ */
+struct incfs_log_ring_next {
+	__u8 type;
+
+	/* Microseconds since the previous record */
+	__u8 ts_delta_us;
+} __attribute__((packed));
+
 /*
  * Description of a data or hash block to add to a data file.
  */
@@ -276,6 +389,31 @@ struct incfs_fill_blocks {
 	__aligned_u64 fill_blocks;
 };
 
+/*
+ * Description of a range of uncompressed data blocks to add to a data file.
+ *
+ * Argument for INCFS_IOC_FILL_BLOCK_RANGE
+ */
+struct incfs_fill_block_range {
+	/* Index of the first data block. */
+	__u32 block_index;
+
+	/*
+	 * Length of data, at most INCFS_MAX_FILL_RANGE_BLOCKS blocks. All
+	 * blocks but the last one are INCFS_DATA_FILE_BLOCK_SIZE bytes long.
+	 */
+	__u32 data_len;
+
+	/*
+	 * A pointer to the data of the blocks.
+	 *
+	 * Equivalent to: __u8 *data;
+	 */
+	__aligned_u64 data;
+
+	__aligned_u64 reserved;
+};
+
 /*
  * Permit INCFS_IOC_FILL_BLOCKS on the given file descriptor
  * May only be called on .pending_reads file
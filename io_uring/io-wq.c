@@ -14,7 +14,10 @@
 #include <linux/rculist_nulls.h>
 #include <linux/cpu.h>
 #include <linux/tracehook.h>
+#include <linux/seq_file.h>
+#include <linux/sched/topology.h>
 #include <uapi/linux/io_uring.h>
+#include <trace/hooks/sched.h>
 
 #include "io-wq.h"
 
@@ -69,6 +72,12 @@ struct io_worker {
 
 #define IO_WQ_NR_HASH_BUCKETS	(1u << IO_WQ_HASH_ORDER)
 
+/*
+ * log2 buckets of queue wait and run times, in io_wq_clock() units. Bucket
+ * 0 counts times under 1us, the last one everything from 4s up.
+ */
+#define IO_WQ_HIST_BUCKETS	24
+
 struct io_wqe_acct {
 	unsigned nr_workers;
 	unsigned max_workers;
@@ -76,6 +85,8 @@ struct io_wqe_acct {
 	atomic_t nr_running;
 	struct io_wq_work_list work_list;
 	unsigned long flags;
+	atomic_long_t wait_hist[IO_WQ_HIST_BUCKETS];
+	atomic_long_t run_hist[IO_WQ_HIST_BUCKETS];
 };
 
 enum {
@@ -170,6 +181,17 @@ static inline struct io_wqe_acct *io_wqe_get_acct(struct io_worker *worker)
 	return io_get_acct(worker->wqe, worker->flags & IO_WORKER_F_BOUND);
 }
 
+/* roughly microseconds, wraps after a bit more than an hour */
+static inline u32 io_wq_clock(void)
+{
+	return ktime_get_ns() >> 10;
+}
+
+static void io_wq_hist_add(atomic_long_t *hist, u32 delta)
+{
+	atomic_long_inc(&hist[min_t(int, fls(delta), IO_WQ_HIST_BUCKETS - 1)]);
+}
+
 static void io_worker_ref_put(struct io_wq *wq)
 {
 	if (atomic_dec_and_test(&wq->worker_refs))
@@ -568,18 +590,24 @@ static void io_worker_handle_work(struct io_worker *worker)
 		do {
 			struct io_wq_work *next_hashed, *linked;
 			unsigned int hash = io_get_work_hash(work);
+			u32 start;
 
 			next_hashed = wq_next_work(work);
 
 			if (unlikely(do_kill) && (work->flags & IO_WQ_WORK_UNBOUND))
 				work->flags |= IO_WQ_WORK_CANCEL;
+			start = io_wq_clock();
+			io_wq_hist_add(acct->wait_hist, start - work->queued);
 			wq->do_work(work);
+			io_wq_hist_add(acct->run_hist, io_wq_clock() - start);
 			io_assign_current_work(worker, NULL);
 
 			linked = wq->free_work(work);
 			work = next_hashed;
 			if (!work && linked && !io_wq_is_hashed(linked)) {
 				work = linked;
+				/* runs right away, it never waited in the queue */
+				work->queued = io_wq_clock();
 				linked = NULL;
 			}
 			io_assign_current_work(worker, work);
@@ -701,12 +729,72 @@ void io_wq_worker_sleeping(struct task_struct *tsk)
 	raw_spin_unlock(&worker->wqe->lock);
 }
 
+/*
+ * Workers inherit the uclamp settings of the task owning the io-wq, but they
+ * are free to run on any CPU of the node. On asymmetric systems, keep them on
+ * the CPUs whose capacity fits the owner's effective clamps, including those
+ * of its cgroup: offloaded work of a boosted task shouldn't be left on a little
+ * core, and background work shouldn't wake up a big one. Vendor modules may
+ * refine the mask, e.g. from the group of the owner. Changes of the clamps
+ * apply to the workers created afterwards, idle workers exit after
+ * WORKER_IDLE_TIMEOUT.
+ */
+static void io_wqe_worker_cpus(struct io_wqe *wqe, struct cpumask *mask)
+{
+	unsigned long min_cap = 0, max_cap = SCHED_CAPACITY_SCALE;
+	unsigned long fit_cap = ULONG_MAX;
+	struct task_struct *owner = wqe->wq->task;
+	int cpu;
+
+#ifdef CONFIG_UCLAMP_TASK
+	/* effective clamps, so that cgroup cpu.uclamp boosts apply too */
+	rcu_read_lock();
+	min_cap = uclamp_eff_value(owner, UCLAMP_MIN);
+	max_cap = uclamp_eff_value(owner, UCLAMP_MAX);
+	rcu_read_unlock();
+#endif
+	/* the smallest capacity fitting min_cap, or the biggest one */
+	for_each_cpu(cpu, wqe->cpu_mask) {
+		unsigned long cap = arch_scale_cpu_capacity(cpu);
+
+		if (cap >= min_cap)
+			fit_cap = min(fit_cap, cap);
+	}
+	if (fit_cap == ULONG_MAX) {
+		fit_cap = 0;
+		for_each_cpu(cpu, wqe->cpu_mask)
+			fit_cap = max(fit_cap, arch_scale_cpu_capacity(cpu));
+	}
+	min_cap = min(min_cap, fit_cap);
+	max_cap = max(max_cap, fit_cap);
+
+	cpumask_clear(mask);
+	for_each_cpu(cpu, wqe->cpu_mask) {
+		unsigned long cap = arch_scale_cpu_capacity(cpu);
+
+		if (cap >= min_cap && cap <= max_cap)
+			__cpumask_set_cpu(cpu, mask);
+	}
+
+	trace_android_vh_io_wq_worker_cpus(owner, mask);
+	if (!cpumask_intersects(mask, cpu_online_mask))
+		cpumask_copy(mask, wqe->cpu_mask);
+}
+
 static void io_init_new_worker(struct io_wqe *wqe, struct io_worker *worker,
 			       struct task_struct *tsk)
 {
+	cpumask_var_t mask;
+
 	tsk->pf_io_worker = worker;
 	worker->task = tsk;
-	set_cpus_allowed_ptr(tsk, wqe->cpu_mask);
+	if (alloc_cpumask_var(&mask, GFP_KERNEL)) {
+		io_wqe_worker_cpus(wqe, mask);
+		set_cpus_allowed_ptr(tsk, mask);
+		free_cpumask_var(mask);
+	} else {
+		set_cpus_allowed_ptr(tsk, wqe->cpu_mask);
+	}
 	tsk->flags |= PF_NO_SETAFFINITY;
 
 	raw_spin_lock(&wqe->lock);
@@ -881,6 +969,7 @@ static void io_wqe_insert_work(struct io_wqe *wqe, struct io_wq_work *work)
 	unsigned int hash;
 	struct io_wq_work *tail;
 
+	work->queued = io_wq_clock();
 	if (!io_wq_is_hashed(work)) {
 append:
 		wq_list_add_tail(&work->list, &acct->work_list);
@@ -1390,6 +1479,57 @@ int io_wq_max_workers(struct io_wq *wq, int *new_count)
 	return 0;
 }
 
+static void io_wq_show_hist(struct seq_file *m, const char *name,
+			    unsigned long *hist)
+{
+	int i;
+
+	seq_printf(m, "%s:\t", name);
+	for (i = 0; i < IO_WQ_HIST_BUCKETS; i++)
+		seq_put_decimal_ull(m, i ? " " : "", hist[i]);
+	seq_putc(m, '\n');
+}
+
+/*
+ * Worker counts and log2 histograms of the queue wait and run times of the
+ * work, summed over all nodes, for the fdinfo of the rings using @wq.
+ */
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m)
+{
+	static const char * const names[IO_WQ_ACCT_NR] = { "Bound", "Unbound" };
+	unsigned long wait[IO_WQ_HIST_BUCKETS], run[IO_WQ_HIST_BUCKETS];
+	char buf[32];
+	int i, b, node;
+
+	seq_printf(m, "IoWq:\t%d\n", task_pid_nr(wq->task));
+	for (i = 0; i < IO_WQ_ACCT_NR; i++) {
+		unsigned int nr_workers = 0, max_workers = 0;
+		int nr_running = 0;
+
+		memset(wait, 0, sizeof(wait));
+		memset(run, 0, sizeof(run));
+		for_each_node(node) {
+			struct io_wqe_acct *acct = &wq->wqes[node]->acct[i];
+
+			raw_spin_lock(&wq->wqes[node]->lock);
+			nr_workers += acct->nr_workers;
+			max_workers = max(max_workers, acct->max_workers);
+			raw_spin_unlock(&wq->wqes[node]->lock);
+			nr_running += atomic_read(&acct->nr_running);
+			for (b = 0; b < IO_WQ_HIST_BUCKETS; b++) {
+				wait[b] += atomic_long_read(&acct->wait_hist[b]);
+				run[b] += atomic_long_read(&acct->run_hist[b]);
+			}
+		}
+		seq_printf(m, "IoWq%sWorkers:\t%u/%u running %d\n", names[i],
+			   nr_workers, max_workers, nr_running);
+		snprintf(buf, sizeof(buf), "IoWq%sWait", names[i]);
+		io_wq_show_hist(m, buf, wait);
+		snprintf(buf, sizeof(buf), "IoWq%sRun", names[i]);
+		io_wq_show_hist(m, buf, run);
+	}
+}
+
 static __init int io_wq_init(void)
 {
 	int ret;
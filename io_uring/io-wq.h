@@ -15,6 +15,7 @@
 #include <linux/refcount.h>
 
 struct io_wq;
+struct seq_file;
 
 enum {
 	IO_WQ_WORK_CANCEL	= 1,
@@ -99,6 +100,7 @@ static inline void wq_list_del(struct io_wq_work_list *list,
 struct io_wq_work {
 	struct io_wq_work_node list;
 	unsigned flags;
+	u32 queued;	/* io-wq clock at enqueue, for the stats */
 };
 
 static inline struct io_wq_work *wq_next_work(struct io_wq_work *work)
@@ -140,6 +142,7 @@ void io_wq_hash_work(struct io_wq_work *work, void *val);
 
 int io_wq_cpu_affinity(struct io_wq *wq, cpumask_var_t mask);
 int io_wq_max_workers(struct io_wq *wq, int *new_count);
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m);
 
 static inline bool io_wq_is_hashed(struct io_wq_work *work)
 {
@@ -10192,8 +10192,17 @@ static void __io_uring_show_fdinfo(struct io_ring_ctx *ctx, struct seq_file *m)
 					req->task->task_works != NULL);
 	}
 	spin_unlock(&ctx->completion_lock);
-	if (has_lock)
+	if (has_lock) {
+		struct io_tctx_node *node;
+
+		list_for_each_entry(node, &ctx->tctx_list, ctx_node) {
+			struct io_uring_task *tctx = node->task->io_uring;
+
+			if (tctx->io_wq)
+				io_wq_show_fdinfo(tctx->io_wq, m);
+		}
 		mutex_unlock(&ctx->uring_lock);
+	}
 }
 
 static void io_uring_show_fdinfo(struct seq_file *m, struct file *f)
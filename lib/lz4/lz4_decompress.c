@@ -39,6 +39,12 @@
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <asm/unaligned.h>
+#if defined(CONFIG_LZ4_DECOMPRESS_NEON) && !defined(STATIC)
+#include <linux/jump_label.h>
+#include <asm/cpufeature.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+#endif
 
 /*-*****************************
  *	Decompression functions
@@ -50,6 +56,16 @@
 #define assert(condition) ((void)0)
 #endif
 
+/*
+ * Architecture specific instantiations of LZ4_decompress_generic() (see
+ * lz4_decompress_neon.c) may provide wider copy loops for literals and for
+ * matches which don't overlap with the output within @offset bytes.
+ */
+#ifndef LZ4_wildCopyLiterals
+#define LZ4_wildCopyLiterals(d, s, e)		LZ4_wildCopy(d, s, e)
+#define LZ4_wildCopyMatch(d, s, e, offset)	LZ4_wildCopy(d, s, e)
+#endif
+
 /*
  * LZ4_decompress_generic() :
  * This generic decompression function covers all use cases.
@@ -280,7 +296,7 @@ static FORCE_INLINE int LZ4_decompress_generic(
 				break;
 		} else {
 			/* may overwrite up to WILDCOPYLENGTH beyond cpy */
-			LZ4_wildCopy(op, ip, cpy);
+			LZ4_wildCopyLiterals(op, ip, cpy);
 			ip += length;
 			op = cpy;
 		}
@@ -438,7 +454,7 @@ static FORCE_INLINE int LZ4_decompress_generic(
 		} else {
 			LZ4_copy8(op, match);
 			if (length > 16)
-				LZ4_wildCopy(op + 8, match + 8, cpy);
+				LZ4_wildCopyMatch(op + 8, match + 8, cpy, offset);
 		}
 		op = cpy; /* wildcopy correction */
 	}
@@ -457,7 +473,40 @@ static FORCE_INLINE int LZ4_decompress_generic(
 	return (int) (-(((const char *)ip) - src)) - 1;
 }
 
-int LZ4_decompress_safe(const char *source, char *dest,
+/* files including this one may only want their own LZ4_decompress_generic() */
+#ifndef LZ4_DECOMPRESS_GENERIC_ONLY
+
+#if defined(CONFIG_LZ4_DECOMPRESS_NEON) && !defined(STATIC)
+/*
+ * Upper bound of the output decoded in one go with NEON, which runs with
+ * preemption disabled. Larger blocks are left to the generic decoder.
+ */
+#define LZ4_NEON_MAX_OUTPUT	(256 * KB)
+
+static DEFINE_STATIC_KEY_FALSE(lz4_use_neon);
+
+static bool lz4_neon = true;
+module_param_named(neon, lz4_neon, bool, 0444);
+MODULE_PARM_DESC(neon, "Use the NEON decompressor if the CPU supports it");
+
+static bool LZ4_neon_usable(int outputSize)
+{
+	return static_branch_likely(&lz4_use_neon) &&
+		outputSize <= LZ4_NEON_MAX_OUTPUT && may_use_simd();
+}
+#else
+static bool LZ4_neon_usable(int outputSize)
+{
+	return false;
+}
+#define LZ4_decompress_safe_neon(src, dst, srcSize, dstCapacity) (-1)
+#define LZ4_decompress_safe_partial_neon(src, dst, srcSize, \
+					 targetOutputSize, dstCapacity) (-1)
+#define kernel_neon_begin()	do { } while (0)
+#define kernel_neon_end()	do { } while (0)
+#endif
+
+int LZ4_decompress_safe_generic(const char *source, char *dest,
 	int compressedSize, int maxDecompressedSize)
 {
 	return LZ4_decompress_generic(source, dest,
@@ -466,7 +515,23 @@ int LZ4_decompress_safe(const char *source, char *dest,
 				      noDict, (BYTE *)dest, NULL, 0);
 }
 
-int LZ4_decompress_safe_partial(const char *src, char *dst,
+int LZ4_decompress_safe(const char *source, char *dest,
+	int compressedSize, int maxDecompressedSize)
+{
+	int ret;
+
+	if (!LZ4_neon_usable(maxDecompressedSize))
+		return LZ4_decompress_safe_generic(source, dest,
+				compressedSize, maxDecompressedSize);
+
+	kernel_neon_begin();
+	ret = LZ4_decompress_safe_neon(source, dest,
+				       compressedSize, maxDecompressedSize);
+	kernel_neon_end();
+	return ret;
+}
+
+int LZ4_decompress_safe_partial_generic(const char *src, char *dst,
 	int compressedSize, int targetOutputSize, int dstCapacity)
 {
 	dstCapacity = min(targetOutputSize, dstCapacity);
@@ -475,6 +540,22 @@ int LZ4_decompress_safe_partial(const char *src, char *dst,
 				      noDict, (BYTE *)dst, NULL, 0);
 }
 
+int LZ4_decompress_safe_partial(const char *src, char *dst,
+	int compressedSize, int targetOutputSize, int dstCapacity)
+{
+	int ret;
+
+	if (!LZ4_neon_usable(min(targetOutputSize, dstCapacity)))
+		return LZ4_decompress_safe_partial_generic(src, dst,
+				compressedSize, targetOutputSize, dstCapacity);
+
+	kernel_neon_begin();
+	ret = LZ4_decompress_safe_partial_neon(src, dst, compressedSize,
+					       targetOutputSize, dstCapacity);
+	kernel_neon_end();
+	return ret;
+}
+
 int LZ4_decompress_fast(const char *source, char *dest, int originalSize)
 {
 	return LZ4_decompress_generic(source, dest, 0, originalSize,
@@ -705,6 +786,63 @@ int LZ4_decompress_fast_usingDict(const char *source, char *dest,
 		dictStart, dictSize);
 }
 
+#if defined(CONFIG_LZ4_DECOMPRESS_NEON) && !defined(STATIC)
+/*
+ * A small block with long literal runs and long matches at both short and
+ * long offsets, i.e. going through all of the NEON copy loops.
+ */
+static bool __init LZ4_neon_selftest(void)
+{
+	static const char pattern[] __initconst =
+		"0123456789abcdefghijklmnopqrstuv";
+	static BYTE src[64] __initdata, dst[256] __initdata, ref[256] __initdata;
+	unsigned int i, n = 0, len = 0;
+	int ret;
+
+	/* 32 literals, then a 100-byte match at offset 32 */
+	src[n++] = (RUN_MASK << ML_BITS) | ML_MASK;
+	src[n++] = 32 - RUN_MASK;
+	for (i = 0; i < 32; ++i)
+		src[n++] = ref[len++] = pattern[i];
+	src[n++] = 32;
+	src[n++] = 0;
+	src[n++] = 100 - MINMATCH - ML_MASK;
+	for (i = 0; i < 100; ++i, ++len)
+		ref[len] = ref[len - 32];
+	/* no literals, then a 40-byte match at offset 10 */
+	src[n++] = ML_MASK;
+	src[n++] = 10;
+	src[n++] = 0;
+	src[n++] = 40 - MINMATCH - ML_MASK;
+	for (i = 0; i < 40; ++i, ++len)
+		ref[len] = ref[len - 10];
+	/* 16 trailing literals */
+	src[n++] = RUN_MASK << ML_BITS;
+	src[n++] = 16 - RUN_MASK;
+	for (i = 0; i < 16; ++i)
+		src[n++] = ref[len++] = pattern[31 - i];
+
+	kernel_neon_begin();
+	ret = LZ4_decompress_safe_neon((char *)src, (char *)dst, n, len);
+	kernel_neon_end();
+	return ret == (int)len && !memcmp(dst, ref, len);
+}
+
+static int __init LZ4_decompress_init(void)
+{
+	if (!lz4_neon || !cpu_have_named_feature(ASIMD))
+		return 0;
+
+	if (!LZ4_neon_selftest()) {
+		pr_warn("lz4: NEON decompressor self-test failed, using the generic one\n");
+		return 0;
+	}
+	static_branch_enable(&lz4_use_neon);
+	return 0;
+}
+module_init(LZ4_decompress_init);
+#endif
+
 #ifndef STATIC
 EXPORT_SYMBOL(LZ4_decompress_safe);
 EXPORT_SYMBOL(LZ4_decompress_safe_partial);
@@ -715,6 +853,11 @@ EXPORT_SYMBOL(LZ4_decompress_fast_continue);
 EXPORT_SYMBOL(LZ4_decompress_safe_usingDict);
 EXPORT_SYMBOL(LZ4_decompress_fast_usingDict);
 
+EXPORT_SYMBOL(LZ4_decompress_safe_generic);
+EXPORT_SYMBOL(LZ4_decompress_safe_partial_generic);
+
 MODULE_LICENSE("Dual BSD/GPL");
 MODULE_DESCRIPTION("LZ4 decompressor");
 #endif
+
+#endif	/* !LZ4_DECOMPRESS_GENERIC_ONLY */
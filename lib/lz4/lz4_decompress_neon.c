@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * LZ4 decompressor using NEON for the literal and match copy loops
+ *
+ * This is LZ4_decompress_generic() instantiated with 16-byte copies instead
+ * of the 8-byte ones of LZ4_wildCopy(). The copies never go further beyond
+ * the end of the output than the generic ones do, so the parsing
+ * restrictions of the block format still cover them. Matches closer than
+ * 16 bytes overlap with their own output and keep using LZ4_wildCopy().
+ *
+ * The callers in lz4_decompress.c must wrap these in
+ * kernel_neon_begin()/kernel_neon_end().
+ */
+#include <linux/lz4.h>
+#include <asm/neon-intrinsics.h>
+#include "lz4defs.h"
+
+static FORCE_INLINE void LZ4_wildCopy16(void *dstPtr,
+	const void *srcPtr, void *dstEnd)
+{
+	BYTE *d = (BYTE *)dstPtr;
+	const BYTE *s = (const BYTE *)srcPtr;
+	BYTE *const e = (BYTE *)dstEnd;
+
+	while (d + 16 <= e) {
+		vst1q_u8(d, vld1q_u8(s));
+		d += 16;
+		s += 16;
+	}
+	if (d < e)
+		LZ4_wildCopy(d, s, e);
+}
+
+#define LZ4_wildCopyLiterals(d, s, e)	LZ4_wildCopy16(d, s, e)
+#define LZ4_wildCopyMatch(d, s, e, offset)			\
+	((offset) >= 16 ? LZ4_wildCopy16(d, s, e) : LZ4_wildCopy(d, s, e))
+
+#define LZ4_DECOMPRESS_GENERIC_ONLY
+#include "lz4_decompress.c"
+
+int LZ4_decompress_safe_neon(const char *source, char *dest,
+	int compressedSize, int maxDecompressedSize)
+{
+	return LZ4_decompress_generic(source, dest,
+				      compressedSize, maxDecompressedSize,
+				      endOnInputSize, decode_full_block,
+				      noDict, (BYTE *)dest, NULL, 0);
+}
+EXPORT_SYMBOL(LZ4_decompress_safe_neon);
+
+int LZ4_decompress_safe_partial_neon(const char *src, char *dst,
+	int compressedSize, int targetOutputSize, int dstCapacity)
+{
+	dstCapacity = min(targetOutputSize, dstCapacity);
+	return LZ4_decompress_generic(src, dst, compressedSize, dstCapacity,
+				      endOnInputSize, partial_decode,
+				      noDict, (BYTE *)dst, NULL, 0);
+}
+EXPORT_SYMBOL(LZ4_decompress_safe_partial_neon);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 decompressor (NEON accelerated)");
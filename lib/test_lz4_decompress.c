@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Benchmark of the NEON LZ4 decompressor against the generic one
+ *
+ * The compressed input is taken from an image file (typically an EROFS
+ * image) which is split into pclusters of "pclustersize" bytes. Compressed
+ * data in those is right-aligned with leading zeroes, so every pcluster
+ * that decodes to more than its own size once the zeroes are skipped is
+ * taken as an LZ4 block. Metadata and uncompressed blocks don't decode and
+ * are ignored.
+ *
+ * e.g. modprobe test_lz4_decompress image=/data/local/tmp/system.img
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/kernel_read_file.h>
+#include <linux/ktime.h>
+#include <linux/lz4.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <asm/neon.h>
+
+static char *image;
+module_param(image, charp, 0444);
+MODULE_PARM_DESC(image, "Path of the image to take compressed blocks from");
+
+static unsigned int pclustersize = 4096;
+module_param(pclustersize, uint, 0444);
+MODULE_PARM_DESC(pclustersize, "Physical cluster size of the image in bytes");
+
+static unsigned int iterations = 8;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Number of passes over all blocks");
+
+/* upper bound of the decompressed size of a pcluster */
+#define LZ4_BENCH_MAX_RATIO	16
+
+struct lz4_bench_block {
+	const char *src;
+	int srcsize;
+	int dstsize;
+};
+
+static int lz4_bench_decompress(const struct lz4_bench_block *blk,
+				char *dst, bool neon)
+{
+	int ret;
+
+	if (!neon)
+		return LZ4_decompress_safe_partial_generic(blk->src, dst,
+				blk->srcsize, blk->dstsize, blk->dstsize);
+
+	kernel_neon_begin();
+	ret = LZ4_decompress_safe_partial_neon(blk->src, dst, blk->srcsize,
+					       blk->dstsize, blk->dstsize);
+	kernel_neon_end();
+	return ret;
+}
+
+static u64 lz4_bench_run(const struct lz4_bench_block *blks,
+			 unsigned int nr, char *dst, bool neon)
+{
+	unsigned int i, j;
+	u64 start = ktime_get_ns();
+
+	for (i = 0; i < iterations; ++i) {
+		for (j = 0; j < nr; ++j)
+			lz4_bench_decompress(&blks[j], dst, neon);
+		cond_resched();
+	}
+	return ktime_get_ns() - start;
+}
+
+static int __init test_lz4_decompress_init(void)
+{
+	unsigned int maxout, nr = 0, mismatches = 0, i;
+	struct lz4_bench_block *blks;
+	u64 total = 0, generic_ns, neon_ns;
+	char *dst, *ref;
+	size_t size;
+	void *buf = NULL;
+	int ret;
+
+	if (!image || !pclustersize || !iterations)
+		return -EINVAL;
+
+	ret = kernel_read_file_from_path(image, 0, &buf, INT_MAX, &size,
+					 READING_UNKNOWN);
+	if (ret < 0) {
+		pr_err("failed to read %s: %d\n", image, ret);
+		return ret;
+	}
+
+	maxout = pclustersize * LZ4_BENCH_MAX_RATIO;
+	ret = -ENOMEM;
+	blks = kvmalloc_array(size / pclustersize + 1, sizeof(*blks),
+			      GFP_KERNEL);
+	dst = kvmalloc(maxout, GFP_KERNEL);
+	ref = kvmalloc(maxout, GFP_KERNEL);
+	if (!blks || !dst || !ref)
+		goto out;
+
+	for (i = 0; i + pclustersize <= size; i += pclustersize) {
+		const char *src = buf + i;
+		struct lz4_bench_block *blk = &blks[nr];
+		int skip = 0;
+
+		while (skip < pclustersize && !src[skip])
+			++skip;
+		if (skip == pclustersize)
+			continue;
+
+		blk->src = src + skip;
+		blk->srcsize = pclustersize - skip;
+		blk->dstsize = maxout;
+		ret = LZ4_decompress_safe_partial_generic(blk->src, ref,
+				blk->srcsize, maxout, maxout);
+		if (ret <= (int)pclustersize)
+			continue;
+		blk->dstsize = ret;
+
+		ret = lz4_bench_decompress(blk, dst, true);
+		if (ret != blk->dstsize || memcmp(dst, ref, ret))
+			++mismatches;
+		total += blk->dstsize;
+		++nr;
+	}
+	ret = 0;
+	if (!nr) {
+		pr_info("no LZ4 blocks found in %s\n", image);
+		goto out;
+	}
+
+	generic_ns = lz4_bench_run(blks, nr, dst, false);
+	neon_ns = lz4_bench_run(blks, nr, dst, true);
+	total *= iterations;
+
+	pr_info("%u blocks, %llu bytes decompressed %u times, %u mismatches\n",
+		nr, total / iterations, iterations, mismatches);
+	pr_info("generic: %llu ns, %llu MB/s\n", generic_ns,
+		div64_u64(total * 1000, generic_ns ?: 1));
+	pr_info("neon:    %llu ns, %llu MB/s\n", neon_ns,
+		div64_u64(total * 1000, neon_ns ?: 1));
+	if (mismatches)
+		ret = -EINVAL;
+out:
+	kvfree(ref);
+	kvfree(dst);
+	kvfree(blks);
+	vfree(buf);
+	return ret;
+}
+
+static void __exit test_lz4_decompress_exit(void)
+{
+}
+
+module_init(test_lz4_decompress_init);
+module_exit(test_lz4_decompress_exit);
+
+MODULE_DESCRIPTION("Benchmark of the NEON LZ4 decompressor");
+MODULE_LICENSE("GPL");
@@ -1978,6 +1978,57 @@ static int bpf_test_lookup_postfilter(const char *mount_dir)
 	return result;
 }
 
+static int bpf_test_backing_cache(const char *mount_dir)
+{
+	const char *test_name = "cached";
+	const char *test_data = "Weebles wobble but they don't fall down";
+	int result = TEST_FAILURE;
+	int bpf_fd = -1;
+	int src_fd = -1;
+	int fuse_dev = -1;
+	char *filename = NULL;
+	int fd = -1;
+	struct stat st;
+
+	TEST(src_fd = open(ft_src, O_DIRECTORY | O_RDONLY | O_CLOEXEC),
+	     src_fd != -1);
+	TESTEQUAL(install_elf_bpf("test_bpf.bpf", "test_simple",
+				  &bpf_fd, NULL, NULL), 0);
+	TESTEQUAL(mount_fuse(mount_dir, bpf_fd, src_fd, &fuse_dev), 0);
+	TEST(filename = concat_file_name(mount_dir, test_name), filename);
+
+	/* Negative entries are cached until the backing directory changes */
+	TESTEQUAL(stat(filename, &st), -1);
+	TESTEQUAL(errno, ENOENT);
+	TESTEQUAL(bpf_test_trace("prefilter opcode: 1\n"), 0);
+	TESTEQUAL(stat(filename, &st), -1);
+	TESTEQUAL(errno, ENOENT);
+	TESTEQUAL(bpf_test_no_trace("prefilter opcode: 1\n"), 0);
+
+	TEST(fd = openat(src_fd, test_name, O_CREAT | O_RDWR | O_CLOEXEC, 0777),
+	     fd != -1);
+	TESTSYSCALL(stat(filename, &st));
+	TESTEQUAL(st.st_size, 0);
+	TESTEQUAL(bpf_test_trace("prefilter opcode: 3\n"), 0);
+
+	/* Attributes are cached until the backing inode changes */
+	TESTSYSCALL(stat(filename, &st));
+	TESTEQUAL(bpf_test_no_trace("prefilter opcode: 3\n"), 0);
+	TESTEQUAL(write(fd, test_data, strlen(test_data)), strlen(test_data));
+	TESTSYSCALL(stat(filename, &st));
+	TESTEQUAL(st.st_size, strlen(test_data));
+
+	result = TEST_SUCCESS;
+out:
+	close(fd);
+	close(fuse_dev);
+	free(filename);
+	umount(mount_dir);
+	close(src_fd);
+	close(bpf_fd);
+	return result;
+}
+
 static void parse_range(const char *ranges, bool *run_test, size_t tests)
 {
 	size_t i;
@@ -2104,6 +2155,7 @@ int main(int argc, char *argv[])
 		MAKE_TEST(bpf_test_no_readdirplus_without_nodeid),
 		MAKE_TEST(bpf_test_revalidate_handle_backing_fd),
 		MAKE_TEST(bpf_test_lookup_postfilter),
+		MAKE_TEST(bpf_test_backing_cache),
 	};
 #undef MAKE_TEST
 
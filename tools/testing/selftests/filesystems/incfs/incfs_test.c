@@ -23,6 +23,7 @@
 #include <sys/mman.h>
 #include <sys/mount.h>
 #include <sys/stat.h>
+#include <sys/sysinfo.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/xattr.h>
@@ -2356,6 +2357,123 @@ static int read_log_test(const char *mount_dir)
 	return result;
 }
 
+/* Count the records for file @id in the mapped read log rings */
+static int count_ring_records(void *rings, size_t stride, int cpus,
+			      incfs_uuid_t *id)
+{
+	int count = 0;
+	int cpu;
+
+	for (cpu = 0; cpu < cpus; cpu++) {
+		struct incfs_log_ring_header *hdr = rings + cpu * stride;
+		uint8_t *data = (uint8_t *)hdr + hdr->header_size;
+		uint64_t mask = hdr->data_size - 1;
+		uint64_t head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+		uint64_t tail = hdr->tail;
+		bool same_file = false;
+
+		while (tail < head) {
+			uint8_t *record = data + (tail & mask);
+			struct incfs_log_ring_full full;
+
+			switch (*record) {
+			case INCFS_LOG_RING_PAD:
+				tail += hdr->data_size - (tail & mask);
+				continue;
+			case INCFS_LOG_RING_FULL:
+				memcpy(&full, record, sizeof(full));
+				same_file = !memcmp(full.file_id, id,
+						    sizeof(full.file_id));
+				tail += sizeof(full);
+				break;
+			case INCFS_LOG_RING_DELTA:
+				tail += sizeof(struct incfs_log_ring_delta);
+				break;
+			case INCFS_LOG_RING_NEXT:
+				tail += sizeof(struct incfs_log_ring_next);
+				break;
+			default:
+				return -1;
+			}
+			if (same_file)
+				count++;
+		}
+		__atomic_store_n(&hdr->tail, tail, __ATOMIC_RELEASE);
+	}
+
+	return count;
+}
+
+static int read_log_ring_test(const char *mount_dir)
+{
+	int result = TEST_FAILURE;
+	char *backing_dir = NULL;
+	char *filename = NULL;
+	int cmd_fd = -1, log_fd = -1, fd = -1;
+	const int block_count = 10;
+	struct test_file file = {
+		.name = "file",
+		.size = block_count * INCFS_DATA_FILE_BLOCK_SIZE,
+	};
+	struct incfs_log_ring_header *hdr = MAP_FAILED;
+	void *rings = MAP_FAILED;
+	size_t stride = 0;
+	int cpus = get_nprocs_conf();
+	uint8_t buf[INCFS_DATA_FILE_BLOCK_SIZE];
+	int i;
+
+	TEST(backing_dir = create_backing_dir(mount_dir), backing_dir);
+	TESTEQUAL(mount_fs_opt(mount_dir, backing_dir,
+		"readahead=0,rlog_pages=0,rlog_ring_pages=1,read_timeout_ms=0",
+			       false), 0);
+	TEST(cmd_fd = open_commands_file(mount_dir), cmd_fd != -1);
+	TESTEQUAL(emit_file(cmd_fd, NULL, file.name, &file.id, file.size,
+			    NULL), 0);
+
+	TEST(filename = concat_file_name(mount_dir, INCFS_LOG_FILENAME),
+	     filename);
+	TEST(log_fd = open(filename, O_RDWR | O_CLOEXEC), log_fd != -1);
+	free(filename);
+	filename = NULL;
+
+	/* A private mapping can't publish the tail */
+	TEST(hdr = mmap(NULL, getpagesize(), PROT_READ, MAP_PRIVATE, log_fd, 0),
+	     hdr == MAP_FAILED);
+	TEST(hdr = mmap(NULL, getpagesize(), PROT_READ, MAP_SHARED, log_fd, 0),
+	     hdr != MAP_FAILED);
+	TESTEQUAL(hdr->head, 0);
+	TESTCOND(hdr->data_size >= getpagesize());
+	stride = hdr->header_size + hdr->data_size;
+	TEST(rings = mmap(NULL, stride * cpus, PROT_READ | PROT_WRITE,
+			  MAP_SHARED, log_fd, 0),
+	     rings != MAP_FAILED);
+
+	/* Nothing was filled, so every read times out and is logged */
+	TEST(filename = concat_file_name(mount_dir, file.name), filename);
+	TEST(fd = open(filename, O_RDONLY | O_CLOEXEC), fd != -1);
+	for (i = 0; i < block_count; i++)
+		TESTEQUAL(pread(fd, buf, sizeof(buf),
+				i * INCFS_DATA_FILE_BLOCK_SIZE), -1);
+
+	TESTCOND(count_ring_records(rings, stride, cpus, &file.id) >=
+		 block_count);
+	TESTEQUAL(count_ring_records(rings, stride, cpus, &file.id), 0);
+
+	result = TEST_SUCCESS;
+out:
+	if (rings != MAP_FAILED)
+		munmap(rings, stride * cpus);
+	if (hdr != MAP_FAILED)
+		munmap(hdr, getpagesize());
+	close(fd);
+	close(log_fd);
+	close(cmd_fd);
+	free(filename);
+	umount(mount_dir);
+	free(backing_dir);
+	return result;
+}
+
 static int emit_partial_test_file_data(const char *mount_dir,
 				       struct test_file *file)
 {
@@ -4308,6 +4426,98 @@ static int truncate_test(const char *mount_dir)
 	return result;
 }
 
+static int fill_block_range_test(const char *mount_dir)
+{
+	int result = TEST_FAILURE;
+	char *backing_dir = NULL;
+	int cmd_fd = -1;
+	const int block_count = 37;
+	struct test_file file = {
+		  .name = "file",
+		  .size = (block_count - 1) * INCFS_DATA_FILE_BLOCK_SIZE + 123,
+	};
+	char *filename = NULL;
+	int fd = -1;
+	uint8_t *data = NULL;
+	uint8_t *read_back = NULL;
+	struct incfs_fill_block fill_block = {
+		.block_index = 5,
+		.data_len = INCFS_DATA_FILE_BLOCK_SIZE,
+	};
+	struct incfs_fill_blocks fill_blocks = {
+		.count = 1,
+		.fill_blocks = ptr_to_u64(&fill_block),
+	};
+	struct incfs_fill_block_range range = {
+		.block_index = 0,
+		.data_len = file.size,
+	};
+	struct incfs_filled_range ranges[4];
+	struct incfs_get_filled_blocks_args fba = {
+		.range_buffer = ptr_to_u64(ranges),
+		.range_buffer_size = sizeof(ranges),
+	};
+
+	TEST(data = malloc(file.size), data);
+	TEST(read_back = malloc(file.size), read_back);
+	rnd_buf(data, file.size, 0);
+	fill_block.data = ptr_to_u64(data + 5 * INCFS_DATA_FILE_BLOCK_SIZE);
+	range.data = ptr_to_u64(data);
+
+	TEST(backing_dir = create_backing_dir(mount_dir), backing_dir);
+	TESTEQUAL(mount_fs_opt(mount_dir, backing_dir, "readahead=0", false),
+		  0);
+	TEST(cmd_fd = open_commands_file(mount_dir), cmd_fd != -1);
+	TESTEQUAL(emit_file(cmd_fd, NULL, file.name, &file.id, file.size,
+			    NULL),
+		  0);
+	TEST(fd = open_file_by_id(mount_dir, file.id, true), fd >= 0);
+
+	/* A block that is already present must be skipped */
+	TESTEQUAL(ioctl(fd, INCFS_IOC_FILL_BLOCKS, &fill_blocks), 1);
+
+	range.reserved = 1;
+	TESTEQUAL(ioctl(fd, INCFS_IOC_FILL_BLOCK_RANGE, &range), -1);
+	TESTEQUAL(errno, EINVAL);
+	range.reserved = 0;
+
+	range.data_len = (INCFS_MAX_FILL_RANGE_BLOCKS + 1) *
+			 INCFS_DATA_FILE_BLOCK_SIZE;
+	TESTEQUAL(ioctl(fd, INCFS_IOC_FILL_BLOCK_RANGE, &range), -1);
+	TESTEQUAL(errno, E2BIG);
+	range.data_len = file.size;
+
+	range.block_index = 1;
+	TESTEQUAL(ioctl(fd, INCFS_IOC_FILL_BLOCK_RANGE, &range), -1);
+	TESTEQUAL(errno, ERANGE);
+	range.block_index = 0;
+
+	TESTEQUAL(ioctl(fd, INCFS_IOC_FILL_BLOCK_RANGE, &range), 0);
+
+	TESTEQUAL(ioctl(fd, INCFS_IOC_GET_FILLED_BLOCKS, &fba), 0);
+	TESTEQUAL(fba.range_buffer_size_out, sizeof(ranges[0]));
+	TESTEQUAL(ranges[0].begin, 0);
+	TESTEQUAL(ranges[0].end, block_count);
+	TESTSYSCALL(close(fd));
+	fd = -1;
+
+	TEST(filename = concat_file_name(mount_dir, file.name), filename);
+	TEST(fd = open(filename, O_RDONLY | O_CLOEXEC), fd != -1);
+	TESTEQUAL(pread(fd, read_back, file.size, 0), file.size);
+	TESTEQUAL(memcmp(data, read_back, file.size), 0);
+
+	result = TEST_SUCCESS;
+out:
+	close(fd);
+	free(filename);
+	close(cmd_fd);
+	umount(mount_dir);
+	free(backing_dir);
+	free(read_back);
+	free(data);
+	return result;
+}
+
 static int stat_file_test(const char *mount_dir, int cmd_fd,
 			  struct test_file *file)
 {
@@ -4765,6 +4975,7 @@ int main(int argc, char *argv[])
 		MAKE_TEST(multiple_providers_test),
 		MAKE_TEST(hash_tree_test),
 		MAKE_TEST(read_log_test),
+		MAKE_TEST(read_log_ring_test),
 		MAKE_TEST(get_blocks_test),
 		MAKE_TEST(get_hash_blocks_test),
 		MAKE_TEST(large_file_test),
@@ -4778,6 +4989,7 @@ int main(int argc, char *argv[])
 		MAKE_TEST(enable_verity_test),
 		MAKE_TEST(mmap_test),
 		MAKE_TEST(truncate_test),
+		MAKE_TEST(fill_block_range_test),
 		MAKE_TEST(stat_test),
 		MAKE_TEST(sysfs_test),
 		MAKE_TEST(sysfs_rename_test),